@@ -0,0 +1,168 @@
+/**
+ * @file export_decoder.h
+ * @author Riccardo Iacob
+ * @brief Host decoder of the compressed history export (see export.h)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Chunks are independent, they can be decoded in any order and a missing one leaves a gap of
+ * known position. decodeChunk() validates the header, the bit stream and the record count, a
+ * damaged chunk is rejected as a whole.
+ */
+#ifndef EXPORT_DECODER_H
+#define EXPORT_DECODER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "history.h"
+#include "export.h"
+
+namespace ExportDecoder
+{
+    struct Chunk_s
+    {
+        // History index of the first record
+        uint32_t first;
+        std::vector<History::Record_s> records;
+    };
+
+    class BitReader
+    {
+    private:
+        const uint8_t *_data;
+        size_t _bits;
+        size_t _position = 0;
+
+    public:
+        BitReader(const uint8_t *data, size_t length) : _data(data), _bits(length * 8) {}
+
+        size_t left()
+        {
+            return _bits - _position;
+        }
+        uint16_t read(uint8_t count)
+        {
+            uint16_t value = 0;
+            while (count-- > 0)
+            {
+                value = (value << 1) | ((_data[_position / 8] >> (7 - _position % 8)) & 1);
+                _position++;
+            }
+            return value;
+        }
+    };
+
+    // Undoes the LZSS stage, false on a truncated token or a copy from before the start of the chunk
+    bool inflate(const uint8_t *data, size_t length, std::vector<uint8_t> &out)
+    {
+        BitReader reader(data, length);
+        // The padding is shorter than a literal
+        while (reader.left() >= 9)
+        {
+            if (reader.read(1) == 1)
+            {
+                out.push_back(reader.read(8));
+                continue;
+            }
+            if (reader.left() < Export::WINDOW_BITS + Export::LENGTH_BITS)
+            {
+                return false;
+            }
+            size_t distance = reader.read(Export::WINDOW_BITS) + 1;
+            size_t count = reader.read(Export::LENGTH_BITS) + Export::MIN_MATCH;
+            if (distance > out.size())
+            {
+                return false;
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                out.push_back(out[out.size() - distance]);
+            }
+        }
+        return true;
+    }
+
+    bool readVarint(const std::vector<uint8_t> &raw, size_t &at, uint32_t &value)
+    {
+        value = 0;
+        for (uint8_t shift = 0; shift < 35; shift += 7)
+        {
+            if (at >= raw.size())
+            {
+                return false;
+            }
+            uint8_t byte = raw[at++];
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Decodes one chunk as handed to the sink of Export
+     *
+     * @return false if the chunk is malformed, chunk is then left empty
+     */
+    bool decodeChunk(const uint8_t *data, size_t length, Chunk_s &chunk)
+    {
+        chunk.records.clear();
+        if (length < Export::HEADER)
+        {
+            return false;
+        }
+        uint16_t count;
+        memcpy(&chunk.first, data, 4);
+        memcpy(&count, data + 4, 2);
+        std::vector<uint8_t> raw;
+        if (!inflate(data + Export::HEADER, length - Export::HEADER, raw))
+        {
+            return false;
+        }
+        History::Record_s record;
+        memset(&record, 0, sizeof(record));
+        size_t at = 0;
+        for (uint16_t n = 0; n < count; n++)
+        {
+            uint32_t value;
+            if (!readVarint(raw, at, value))
+            {
+                chunk.records.clear();
+                return false;
+            }
+            record.time += value;
+            for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+            {
+                if (!readVarint(raw, at, value))
+                {
+                    chunk.records.clear();
+                    return false;
+                }
+                int32_t delta = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+                record.values[i] = record.values[i] + delta;
+            }
+            if (at + Greenhouse::CHANNEL_COUNT > raw.size())
+            {
+                chunk.records.clear();
+                return false;
+            }
+            memcpy(record.quality, raw.data() + at, Greenhouse::CHANNEL_COUNT);
+            at += Greenhouse::CHANNEL_COUNT;
+            chunk.records.push_back(record);
+        }
+        // Nothing may be left over
+        if (at != raw.size())
+        {
+            chunk.records.clear();
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * @file ota_sender.h
+ * @author Riccardo Iacob
+ * @brief Host side of the firmware update (see ota.h), sends an image over the serial link
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Stop and wait: one MSG_OTA_CHUNK in flight, the next one goes out when its MSG_OTA_STATUS comes
+ * back. The device tells where to start from, so the same sender resumes an interrupted transfer.
+ * A chunk refused with a bad CRC is sent again, up to MAX_RETRIES times. Feed every frame from
+ * the client to handle(), the transfer is over once done() is true.
+ */
+#ifndef OTA_SENDER_H
+#define OTA_SENDER_H
+
+#include <stdint.h>
+#include <vector>
+#include <esp32/rom/crc.h>
+#include <mbedtls/sha256.h>
+#include "ota.h"
+#include "seriallink_client.h"
+
+namespace OtaSender
+{
+    const uint8_t MAX_RETRIES = 3;
+
+    enum Phases : uint8_t
+    {
+        IDLE,
+        BEGIN,
+        CHUNKS,
+        END,
+        VERIFY,
+        DONE,
+        FAILED
+    };
+
+    class Sender
+    {
+    private:
+        LinkClient::Client &_client;
+        std::vector<uint8_t> _image;
+        uint8_t _sha256[32];
+        uint8_t _tries = 0;
+
+        void sendChunk(uint32_t index)
+        {
+            uint32_t offset = index * Ota::CHUNK;
+            uint16_t length = _image.size() - offset < Ota::CHUNK ? _image.size() - offset : Ota::CHUNK;
+            std::vector<uint8_t> body(8 + length);
+            uint32_t crc = crc32_le(0, _image.data() + offset, length);
+            memcpy(body.data(), &index, 4);
+            memcpy(body.data() + 4, &crc, 4);
+            memcpy(body.data() + 8, _image.data() + offset, length);
+            if (corruptChunk == index)
+            {
+                // Damaged after the CRC was taken, the link CRC still matches
+                body[8 + length / 2] ^= 0x10;
+                corruptChunk = 0xFFFFFFFF;
+            }
+            _client.send(SerialLink::MSG_OTA_CHUNK, body.data(), body.size());
+            chunksSent++;
+        }
+
+    public:
+        Phases phase = IDLE;
+        uint32_t next = 0;
+        // First chunk the device asked for
+        uint32_t resumedFrom = 0;
+        uint32_t chunksSent = 0;
+        uint32_t retries = 0;
+        uint8_t lastStatus = Ota::STATUS_OK;
+        // Test hooks: damage one chunk, or stop sending after a number of chunks (link lost)
+        uint32_t corruptChunk = 0xFFFFFFFF;
+        uint32_t stopAfter = 0xFFFFFFFF;
+
+        explicit Sender(LinkClient::Client &client) : _client(client) {}
+
+        uint32_t chunkCount()
+        {
+            return (_image.size() + Ota::CHUNK - 1) / Ota::CHUNK;
+        }
+
+        /**
+         * @brief Starts sending an image
+         *
+         * @param sha256: Hash announced to the device, nullptr to compute it from the image
+         */
+        void begin(const std::vector<uint8_t> &image, const uint8_t *sha256 = nullptr)
+        {
+            _image = image;
+            if (sha256 != nullptr)
+            {
+                memcpy(_sha256, sha256, sizeof(_sha256));
+            }
+            else
+            {
+                mbedtls_sha256_context sha;
+                mbedtls_sha256_init(&sha);
+                mbedtls_sha256_starts(&sha, 0);
+                mbedtls_sha256_update(&sha, _image.data(), _image.size());
+                mbedtls_sha256_finish(&sha, _sha256);
+                mbedtls_sha256_free(&sha);
+            }
+            uint8_t body[4 + 32];
+            uint32_t size = _image.size();
+            memcpy(body, &size, 4);
+            memcpy(body + 4, _sha256, 32);
+            _client.send(SerialLink::MSG_OTA_BEGIN, body, sizeof(body));
+            phase = BEGIN;
+            chunksSent = 0;
+            retries = 0;
+        }
+
+        // Reboots the device into the new image once the transfer is DONE
+        void reboot()
+        {
+            _client.send(SerialLink::MSG_OTA_REBOOT, nullptr, 0);
+        }
+
+        bool done()
+        {
+            return phase == DONE || phase == FAILED;
+        }
+
+        // Advances the transfer with a frame from the device, other frames are ignored
+        void handle(const LinkClient::Frame_s &frame)
+        {
+            if (frame.type != SerialLink::MSG_OTA_STATUS || frame.body.size() != 6)
+            {
+                return;
+            }
+            uint8_t state = frame.body[0];
+            lastStatus = frame.body[1];
+            uint32_t reported;
+            memcpy(&reported, frame.body.data() + 2, 4);
+            switch (phase)
+            {
+            case BEGIN:
+                if (lastStatus != Ota::STATUS_OK)
+                {
+                    phase = FAILED;
+                    break;
+                }
+                resumedFrom = next = reported;
+                phase = CHUNKS;
+                _tries = 0;
+                sendChunk(next);
+                break;
+            case CHUNKS:
+                if (lastStatus == Ota::STATUS_BAD_CRC && _tries < MAX_RETRIES)
+                {
+                    _tries++;
+                    retries++;
+                    sendChunk(next);
+                    break;
+                }
+                // The device knows best where we are
+                if (lastStatus != Ota::STATUS_OK && lastStatus != Ota::STATUS_OUT_OF_ORDER)
+                {
+                    phase = FAILED;
+                    break;
+                }
+                next = reported;
+                _tries = 0;
+                if (next == chunkCount())
+                {
+                    _client.send(SerialLink::MSG_OTA_END, nullptr, 0);
+                    phase = END;
+                }
+                else if (chunksSent < stopAfter)
+                {
+                    sendChunk(next);
+                }
+                break;
+            case END:
+                phase = lastStatus == Ota::STATUS_OK ? VERIFY : FAILED;
+                break;
+            case VERIFY:
+                phase = state == Ota::READY ? DONE : FAILED;
+                break;
+            default:
+                break;
+            }
+        }
+    };
+};
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * @file rulesim.h
+ * @author Riccardo Iacob
+ * @brief Host simulator running climate rules against a recorded trace (see trace.h)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Frames take the same path as on the master, Sensors::ingest() and then Rules::run(), on the
+ * clock of the recording. Clock marks only refresh the stale flags, so a slave that stops
+ * answering looks the same as on the device. Touches are ignored. Builds with the stand-ins in
+ * test/stubs, see [env:native].
+ */
+#ifndef RULESIM_H
+#define RULESIM_H
+
+#include <chrono>
+#include "greenhouse.h"
+#include "sensors.h"
+#include "rules.h"
+#include "trace.h"
+
+namespace RuleSim
+{
+    // State after a frame or a clock mark
+    struct Step_s
+    {
+        uint32_t ms;
+        bool frame;
+        // An actuator changed
+        bool changed;
+        const Greenhouse::Data_s *data;
+        const Greenhouse::Config_s *config;
+    };
+
+    struct Result_s
+    {
+        uint32_t frames;
+        uint32_t changes;
+        // Wall time of Rules::run() on the host
+        double totalEvalNs;
+        double maxEvalNs;
+    };
+
+    typedef void (*Observer)(const Step_s &step);
+
+    /**
+     * @brief Replays a trace through the sensor filters and the rules
+     *
+     * @param trace: Binary trace, from its header
+     * @param rules: Rules source, see rules.h
+     * @param observer: Called after every frame and clock mark, may be nullptr
+     * @return false if the rules don't compile or the stream is not a trace
+     */
+    bool run(Stream &trace, const char *rules, Observer observer, Result_s &result)
+    {
+        memset(&result, 0, sizeof(result));
+        if (!Rules::compile(rules))
+        {
+            return false;
+        }
+        Trace::Reader reader;
+        if (!reader.begin(trace))
+        {
+            return false;
+        }
+        for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+        {
+            Sensors::states[i] = Sensors::State_s();
+        }
+        Greenhouse::Data_s data = {};
+        Greenhouse::Config_s config = {};
+        Trace::Record_s record;
+        while (reader.next(record))
+        {
+            Step_s step = {record.ms, false, false, &data, &config};
+            if (record.type == Trace::RECORD_FRAME)
+            {
+                Sensors::ingest(record.frame, record.ms, data);
+                auto start = std::chrono::steady_clock::now();
+                step.changed = Rules::run(data, config, record.ms);
+                double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                step.frame = true;
+                result.frames++;
+                result.changes += step.changed;
+                result.totalEvalNs += ns;
+                result.maxEvalNs = ns > result.maxEvalNs ? ns : result.maxEvalNs;
+            }
+            else if (record.type == Trace::RECORD_TICK)
+            {
+                Sensors::checkStale(record.ms, data);
+            }
+            else
+            {
+                continue;
+            }
+            if (observer != nullptr)
+            {
+                observer(step);
+            }
+        }
+        return true;
+    }
+};
+
+#endif
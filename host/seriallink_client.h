@@ -0,0 +1,341 @@
+/**
+ * @file seriallink_client.h
+ * @author Riccardo Iacob
+ * @brief Host side of the serial link protocol (see seriallink.h), for bench rigs and logging PCs
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * The client frames requests and parses replies, the bytes move through a Port. PosixPort opens a
+ * tty in raw mode at the link speed, tests use a loopback on the stand-in Serial. Structs are
+ * read as laid out on the ESP32, which matches little endian hosts built with GCC or Clang.
+ * Nothing blocks: receive() returns the frames completed by the bytes available so far.
+ */
+#ifndef SERIALLINK_CLIENT_H
+#define SERIALLINK_CLIENT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "greenhouse.h"
+#include "history.h"
+#include "seriallink.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace LinkClient
+{
+    // Byte transport to the device
+    class Port
+    {
+    public:
+        virtual ~Port() {}
+        virtual size_t write(const uint8_t *data, size_t length) = 0;
+        // Next received byte, -1 if none is available right now
+        virtual int read() = 0;
+    };
+
+#if defined(__unix__) || defined(__APPLE__)
+    // Serial device such as /dev/ttyUSB0, raw 8N1
+    class PosixPort : public Port
+    {
+    private:
+        int _fd = -1;
+
+    public:
+        bool open(const char *path, speed_t speed)
+        {
+            _fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+            if (_fd < 0)
+            {
+                return false;
+            }
+            termios tty;
+            if (tcgetattr(_fd, &tty) != 0)
+            {
+                close();
+                return false;
+            }
+            cfmakeraw(&tty);
+            cfsetispeed(&tty, speed);
+            cfsetospeed(&tty, speed);
+            tty.c_cflag |= CLOCAL | CREAD;
+            tty.c_cflag &= ~CRTSCTS;
+            return tcsetattr(_fd, TCSANOW, &tty) == 0;
+        }
+        void close()
+        {
+            if (_fd >= 0)
+            {
+                ::close(_fd);
+                _fd = -1;
+            }
+        }
+        ~PosixPort()
+        {
+            close();
+        }
+        size_t write(const uint8_t *data, size_t length) override
+        {
+            size_t done = 0;
+            while (done < length)
+            {
+                ssize_t n = ::write(_fd, data + done, length - done);
+                if (n < 0)
+                {
+                    break;
+                }
+                done += n;
+            }
+            return done;
+        }
+        int read() override
+        {
+            uint8_t byte;
+            return ::read(_fd, &byte, 1) == 1 ? byte : -1;
+        }
+    };
+#endif
+
+    struct Frame_s
+    {
+        uint8_t type;
+        uint8_t seq;
+        std::vector<uint8_t> body;
+    };
+
+    // Reply to a request, see MSG_ACK
+    struct Ack_s
+    {
+        uint8_t type;
+        uint8_t seq;
+        uint8_t status;
+    };
+
+    struct HistoryPage_s
+    {
+        uint32_t first;
+        uint32_t total;
+        std::vector<History::Record_s> records;
+    };
+
+    class Client
+    {
+    private:
+        Port &_port;
+        uint8_t _seq = 0;
+        std::vector<uint8_t> _rx;
+
+    public:
+        uint32_t rxFrames = 0;
+        uint32_t rxErrors = 0;
+        uint32_t txFrames = 0;
+
+        explicit Client(Port &port) : _port(port) {}
+
+        // Frames and sends a request, returns its sequence number
+        uint8_t send(uint8_t type, const void *body, uint16_t length)
+        {
+            uint8_t seq = _seq++;
+            std::vector<uint8_t> frame = {type, seq};
+            frame.insert(frame.end(), (const uint8_t *)body, (const uint8_t *)body + length);
+            uint16_t crc = 0xFFFF;
+            for (uint8_t byte : frame)
+            {
+                crc = SerialLink::crc16(crc, byte);
+            }
+            frame.push_back(crc & 0xFF);
+            frame.push_back(crc >> 8);
+            std::vector<uint8_t> encoded = encode(frame);
+            _port.write(encoded.data(), encoded.size());
+            txFrames++;
+            return seq;
+        }
+
+        /**
+         * @brief Reads what the port has and returns the next complete frame
+         *
+         * @return false if no valid frame is complete yet (bad frames are counted in rxErrors)
+         */
+        bool receive(Frame_s &frame)
+        {
+            int c;
+            while ((c = _port.read()) >= 0)
+            {
+                if (c != 0)
+                {
+                    _rx.push_back(c);
+                    continue;
+                }
+                std::vector<uint8_t> decoded;
+                bool valid = decode(_rx, decoded) && decoded.size() >= 4;
+                _rx.clear();
+                if (valid)
+                {
+                    uint16_t crc = 0xFFFF;
+                    for (size_t i = 0; i < decoded.size() - 2; i++)
+                    {
+                        crc = SerialLink::crc16(crc, decoded[i]);
+                    }
+                    valid = crc == (decoded[decoded.size() - 2] | (decoded[decoded.size() - 1] << 8));
+                }
+                if (!valid)
+                {
+                    rxErrors++;
+                    continue;
+                }
+                frame.type = decoded[0];
+                frame.seq = decoded[1];
+                frame.body.assign(decoded.begin() + 2, decoded.end() - 2);
+                rxFrames++;
+                return true;
+            }
+            return false;
+        }
+
+        uint8_t ping()
+        {
+            return send(SerialLink::MSG_PING, nullptr, 0);
+        }
+        uint8_t subscribe(bool enable)
+        {
+            uint8_t body = enable;
+            return send(SerialLink::MSG_SUBSCRIBE, &body, 1);
+        }
+        uint8_t getHistory(uint32_t first, uint32_t count)
+        {
+            uint32_t body[2] = {first, count};
+            return send(SerialLink::MSG_GET_HISTORY, body, sizeof(body));
+        }
+        uint8_t getConfig()
+        {
+            return send(SerialLink::MSG_GET_CONFIG, nullptr, 0);
+        }
+        uint8_t setConfig(const Greenhouse::Config_s &config)
+        {
+            uint8_t body[4] = {config.test, config.vent, config.fan, config.mister};
+            return send(SerialLink::MSG_SET_CONFIG, body, sizeof(body));
+        }
+        uint8_t setScreen(uint8_t state)
+        {
+            return send(SerialLink::MSG_SET_SCREEN, &state, 1);
+        }
+        uint8_t getCounters()
+        {
+            return send(SerialLink::MSG_GET_COUNTERS, nullptr, 0);
+        }
+        uint8_t setRules(const char *source)
+        {
+            return send(SerialLink::MSG_SET_RULES, source, strlen(source));
+        }
+
+        static std::vector<uint8_t> encode(const std::vector<uint8_t> &data)
+        {
+            std::vector<uint8_t> out = {0};
+            size_t codeAt = 0;
+            uint8_t code = 1;
+            for (uint8_t byte : data)
+            {
+                if (byte != 0)
+                {
+                    out.push_back(byte);
+                    code++;
+                }
+                if (byte == 0 || code == 0xFF)
+                {
+                    out[codeAt] = code;
+                    codeAt = out.size();
+                    out.push_back(0);
+                    code = 1;
+                }
+            }
+            out[codeAt] = code;
+            out.push_back(0);
+            return out;
+        }
+
+        static bool decode(const std::vector<uint8_t> &data, std::vector<uint8_t> &out)
+        {
+            size_t read = 0;
+            while (read < data.size())
+            {
+                uint8_t code = data[read++];
+                if (code == 0 || read + code - 1 > data.size())
+                {
+                    return false;
+                }
+                out.insert(out.end(), data.begin() + read, data.begin() + read + code - 1);
+                read += code - 1;
+                if (code < 0xFF && read < data.size())
+                {
+                    out.push_back(0);
+                }
+            }
+            return true;
+        }
+    };
+
+    bool parseAck(const Frame_s &frame, Ack_s &ack)
+    {
+        if (frame.type != SerialLink::MSG_ACK || frame.body.size() != 3)
+        {
+            return false;
+        }
+        ack = {frame.body[0], frame.body[1], frame.body[2]};
+        return true;
+    }
+
+    bool parseConfig(const Frame_s &frame, Greenhouse::Config_s &config)
+    {
+        if (frame.type != SerialLink::MSG_CONFIG || frame.body.size() != sizeof(config))
+        {
+            return false;
+        }
+        config.test = frame.body[0] != 0;
+        config.vent = frame.body[1];
+        config.fan = frame.body[2];
+        config.mister = frame.body[3];
+        return true;
+    }
+
+    bool parseLive(const Frame_s &frame, Greenhouse::Data_s &data)
+    {
+        if (frame.type != SerialLink::MSG_LIVE || frame.body.size() != sizeof(data))
+        {
+            return false;
+        }
+        memcpy(&data, frame.body.data(), sizeof(data));
+        return true;
+    }
+
+    bool parseCounters(const Frame_s &frame, SerialLink::Counters_s &counters)
+    {
+        if (frame.type != SerialLink::MSG_COUNTERS || frame.body.size() != sizeof(counters))
+        {
+            return false;
+        }
+        memcpy(&counters, frame.body.data(), sizeof(counters));
+        return true;
+    }
+
+    bool parseHistory(const Frame_s &frame, HistoryPage_s &page)
+    {
+        size_t size = frame.body.size();
+        if (frame.type != SerialLink::MSG_HISTORY || size < 8 || (size - 8) % sizeof(History::Record_s) != 0)
+        {
+            return false;
+        }
+        memcpy(&page.first, frame.body.data(), 4);
+        memcpy(&page.total, frame.body.data() + 4, 4);
+        page.records.resize((size - 8) / sizeof(History::Record_s));
+        memcpy(page.records.data(), frame.body.data() + 8, size - 8);
+        return true;
+    }
+};
+
+#endif
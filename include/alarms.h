@@ -0,0 +1,251 @@
+/**
+ * @file alarms.h
+ * @author Riccardo Iacob
+ * @brief Streaming per-channel statistics and threshold alarms
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef ALARMS_H
+#define ALARMS_H
+
+#include <Arduino.h>
+#include "debug.h"
+#include "greenhouse.h"
+
+namespace Alarms
+{
+    // Number of samples covered by the rolling min/max
+    constexpr uint8_t WINDOW = 32;
+    // Weight of the newest sample in the moving average, in 1/256 (51/256 ~ 0.2)
+    constexpr int32_t EWMA_ALPHA = 51;
+    // Fractional bits of the moving average
+    constexpr uint8_t EWMA_SHIFT = 8;
+
+    /**
+     * @brief Monotonic deque over the last WINDOW samples, keeps the rolling max (or min) in amortized O(1)
+     *
+     */
+    struct MonoDeque
+    {
+        int16_t values[WINDOW];
+        uint32_t seqs[WINDOW];
+        uint8_t head = 0;
+        uint8_t count = 0;
+
+        // Adds sample number seq; keepMax selects max (true) or min (false)
+        void push(uint32_t seq, int16_t value, bool keepMax)
+        {
+            // Expire samples that left the window first, so the new one always has a free slot
+            while (count > 0 && seq - seqs[head] >= WINDOW)
+            {
+                head = (head + 1) % WINDOW;
+                count--;
+            }
+            // Drop samples that can never be the extreme again
+            while (count > 0)
+            {
+                int16_t back = values[(head + count - 1) % WINDOW];
+                if (keepMax ? back > value : back < value)
+                {
+                    break;
+                }
+                count--;
+            }
+            uint8_t tail = (head + count) % WINDOW;
+            values[tail] = value;
+            seqs[tail] = seq;
+            count++;
+        }
+
+        int16_t front()
+        {
+            return values[head];
+        }
+    };
+
+    // Running statistics of a channel, in the fixed point unit of the readings (Greenhouse::SCALE)
+    struct Stats
+    {
+        int16_t last = 0;
+        // Moving average with EWMA_SHIFT fractional bits
+        int32_t ewma = 0;
+        int16_t min = 0;
+        int16_t max = 0;
+        // Hundredths of a unit per second
+        int32_t rate = 0;
+        uint32_t lastMs = 0;
+        uint32_t seq = 0;
+        MonoDeque minq;
+        MonoDeque maxq;
+    };
+
+    // Alarm condition of a channel
+    enum class Levels : uint8_t
+    {
+        NONE,
+        BELOW,
+        ABOVE,
+        RATE
+    };
+
+    /**
+     * @brief Alarm thresholds of a channel
+     *
+     * An alarm is raised on the first sample crossing a limit and cleared once the value is back
+     * inside the limits by more than hysteresis. After clearing, the same channel cannot raise
+     * again for holdoffMs, which keeps a value hovering around a limit from flooding the UI.
+     */
+    struct Threshold
+    {
+        bool enabled;
+        // Limits in hundredths of the unit, like the readings
+        int16_t low;
+        int16_t high;
+        int16_t hysteresis;
+        // Maximum absolute rate of change in hundredths per second, 0 to disable
+        int32_t maxRate;
+        uint32_t holdoffMs;
+    };
+
+    struct Alarm
+    {
+        Levels level = Levels::NONE;
+        uint32_t clearedMs = 0;
+        bool everCleared = false;
+    };
+
+    Stats stats[Greenhouse::CHANNEL_COUNT];
+    Alarm alarms[Greenhouse::CHANNEL_COUNT];
+    Threshold thresholds[Greenhouse::CHANNEL_COUNT] = {
+        {true, 500, 3500, 50, 0, 60000},
+        {true, 500, 3500, 50, 0, 60000},
+        {true, 500, 3500, 50, 0, 60000},
+        {true, 4000, 9000, 200, 0, 60000},
+        {true, 4000, 9000, 200, 0, 60000},
+        {true, 4000, 9000, 200, 0, 60000},
+    };
+    // Set when an alarm was raised or cleared, reset by the consumer (TFT)
+    bool changed = false;
+
+    void update(Stats &s, int16_t value, uint32_t ms);
+    bool evaluate(const Threshold &t, const Stats &s, Alarm &a, uint32_t ms);
+    void feed(uint8_t channel, int16_t value, uint32_t ms);
+    void feedAll(const Greenhouse::Data_s &data, uint32_t ms);
+    bool isActive(uint8_t channel);
+
+    // Adds a sample to the statistics, integer only
+    void update(Stats &s, int16_t value, uint32_t ms)
+    {
+        if (s.seq == 0)
+        {
+            s.ewma = (int32_t)value << EWMA_SHIFT;
+            s.rate = 0;
+        }
+        else
+        {
+            s.ewma += (((int32_t)value << EWMA_SHIFT) - s.ewma) * EWMA_ALPHA >> 8;
+            uint32_t dt = ms - s.lastMs;
+            s.rate = dt > 0 ? ((int32_t)value - s.last) * 1000 / (int32_t)dt : 0;
+        }
+        s.minq.push(s.seq, value, false);
+        s.maxq.push(s.seq, value, true);
+        s.min = s.minq.front();
+        s.max = s.maxq.front();
+        s.last = value;
+        s.lastMs = ms;
+        s.seq++;
+    }
+
+    /**
+     * @brief Updates the alarm state of a channel after a new sample
+     *
+     * @return true if the alarm was raised, cleared or changed level
+     */
+    bool evaluate(const Threshold &t, const Stats &s, Alarm &a, uint32_t ms)
+    {
+        if (!t.enabled)
+        {
+            bool active = a.level != Levels::NONE;
+            a.level = Levels::NONE;
+            return active;
+        }
+        int16_t value = s.last;
+        Levels level = Levels::NONE;
+        if (value > t.high)
+        {
+            level = Levels::ABOVE;
+        }
+        else if (value < t.low)
+        {
+            level = Levels::BELOW;
+        }
+        else if (t.maxRate > 0 && abs(s.rate) > t.maxRate)
+        {
+            level = Levels::RATE;
+        }
+        if (a.level == Levels::NONE)
+        {
+            if (level != Levels::NONE && (!a.everCleared || ms - a.clearedMs >= t.holdoffMs))
+            {
+                a.level = level;
+                return true;
+            }
+        }
+        else if (level == Levels::NONE)
+        {
+            // Only clear once the value is clearly back inside the limits
+            if (value <= t.high - t.hysteresis && value >= t.low + t.hysteresis)
+            {
+                a.level = Levels::NONE;
+                a.clearedMs = ms;
+                a.everCleared = true;
+                return true;
+            }
+        }
+        else if (level != a.level)
+        {
+            a.level = level;
+            return true;
+        }
+        return false;
+    }
+
+    // Updates statistics and alarm state of a channel with a new sample
+    void feed(uint8_t channel, int16_t value, uint32_t ms)
+    {
+        update(stats[channel], value, ms);
+        if (!evaluate(thresholds[channel], stats[channel], alarms[channel], ms))
+        {
+            return;
+        }
+        changed = true;
+        debug("[alarms.h] alarm ");
+        debug(isActive(channel) ? "raised" : "cleared");
+        debug(" on channel ");
+        debugln(channel);
+    }
+
+    // Feeds a whole reading from the greenhouse, untrusted channels leave statistics and alarm as they are
+    void feedAll(const Greenhouse::Data_s &data, uint32_t ms)
+    {
+        for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+        {
+            // A stale or rejected channel holds its last good value, see Sensors::ingest
+            if (data.quality[i] != Greenhouse::QUALITY_OK)
+            {
+                continue;
+            }
+            feed(i, data.values[i], ms);
+        }
+    }
+
+    bool isActive(uint8_t channel)
+    {
+        return channel < Greenhouse::CHANNEL_COUNT && alarms[channel].level != Levels::NONE;
+    }
+};
+
+#endif
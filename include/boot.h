@@ -0,0 +1,234 @@
+/**
+ * @file boot.h
+ * @author Riccardo Iacob
+ * @brief Boot sequence as a dependency graph of init phases, run concurrently on both cores
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/event_groups.h>
+#include "debug.h"
+#include "greenhouse.h"
+#include "clock.h"
+#include "tfthelper.h"
+#include "radiohelper.h"
+#include "rtchelper.h"
+#include "power.h"
+#include "trace.h"
+#include "replay.h"
+#include "history.h"
+#include "ota.h"
+
+namespace Boot
+{
+    // Last known readings, shown on the first screen until live data arrives
+    const char *CACHE_FILE = "/lastdata.bin";
+    // Minimum time between cache writes, limits flash wear
+    const uint32_t CACHE_INTERVAL = 600000;
+    const uint32_t PHASE_STACK = 8192;
+
+    // Phase indices, also the bit of the phase in the event group
+    enum Phases : uint8_t
+    {
+        FS,
+        CACHE,
+        DISPLAY,
+        FIRST_FRAME,
+        RTC_READ,
+        RADIO,
+        POWER,
+        TRACE,
+        HISTORY,
+        OTA,
+        PHASE_COUNT
+    };
+
+    struct Phase_s
+    {
+        const char *name;
+        void (*run)();
+        // Bits of the phases that must complete first
+        EventBits_t deps;
+        uint8_t core;
+        uint32_t startUs;
+        uint32_t endUs;
+    };
+
+    void mountFS();
+    void loadCache();
+    void drawFirstFrame();
+    void startTrace();
+    void loadHistory();
+    void loadOta();
+
+    // The display stays on core 1 (Arduino core) so the touch ISR is registered there
+    // Radio setup marks Greenhouse::data stale, so it waits until the first frame has read the cached values
+    Phase_s phases[PHASE_COUNT] = {
+        {"fs", mountFS, 0, 0, 0, 0},
+        {"cache", loadCache, 1 << FS, 0, 0, 0},
+        {"display", TFT::doSetup, 0, 1, 0, 0},
+        {"first frame", drawFirstFrame, (1 << DISPLAY) | (1 << CACHE), 1, 0, 0},
+        {"rtc", RTC::doSetup, 0, 0, 0, 0},
+        {"radio", Radio::doSetup, (1 << CACHE) | (1 << RTC_READ) | (1 << FIRST_FRAME), 0, 0, 0},
+        {"power", Power::doSetup, 1 << DISPLAY, 1, 0, 0},
+        {"trace", startTrace, (1 << FS) | (1 << RADIO) | (1 << FIRST_FRAME), 0, 0, 0},
+        {"history", loadHistory, 1 << FS, 0, 0, 0},
+        // After the first frame, an update that got this far is confirmed as working
+        {"ota", loadOta, (1 << FS) | (1 << FIRST_FRAME), 0, 0, 0},
+    };
+
+    EventGroupHandle_t done;
+    bool fsMounted = false;
+    uint32_t bootUs = 0;
+    bool firstSampleLogged = false;
+    uint32_t lastCacheMs = 0;
+    uint32_t cachedFrames = 0;
+
+    void run();
+    void doTick();
+
+    void mountFS()
+    {
+        fsMounted = LittleFS.begin(true);
+        Snapshot::persist = fsMounted;
+        if (!fsMounted)
+        {
+            debugln("[boot.h] LittleFS mount failed");
+        }
+    }
+
+    // Loads the last known readings, flagged stale
+    void loadCache()
+    {
+        if (!fsMounted || !LittleFS.exists(CACHE_FILE))
+        {
+            return;
+        }
+        File file = LittleFS.open(CACHE_FILE, FILE_READ);
+        Greenhouse::Data_s cached;
+        if (file.read((uint8_t *)&cached, sizeof(cached)) == sizeof(cached))
+        {
+            Greenhouse::data = cached;
+            for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+            {
+                Greenhouse::data.quality[i] |= Greenhouse::QUALITY_STALE;
+            }
+        }
+        file.close();
+    }
+
+    void saveCache()
+    {
+        if (!fsMounted)
+        {
+            return;
+        }
+        File file = LittleFS.open(CACHE_FILE, FILE_WRITE);
+        file.write((const uint8_t *)&Greenhouse::data, sizeof(Greenhouse::data));
+        file.close();
+    }
+
+    void drawFirstFrame()
+    {
+        TFT::setState(TFT::TFTStates::IDLE);
+        TFT::render();
+    }
+
+    void startTrace()
+    {
+#if TRACE_REPLAY == true
+        Replay::begin(TRACE_FILE);
+#elif TRACE_RECORD == true
+        Trace::beginFile(TRACE_FILE);
+#endif
+    }
+
+    void loadHistory()
+    {
+        if (fsMounted)
+        {
+            History::doSetup();
+        }
+    }
+
+    // The image is confirmed even without LittleFS, only the resume of a transfer needs it
+    void loadOta()
+    {
+        Ota::confirmImage();
+        if (fsMounted)
+        {
+            Ota::doSetup();
+        }
+    }
+
+    void phaseTask(void *arg)
+    {
+        Phase_s &phase = phases[(uintptr_t)arg];
+        if (phase.deps != 0)
+        {
+            xEventGroupWaitBits(done, phase.deps, pdFALSE, pdTRUE, portMAX_DELAY);
+        }
+        phase.startUs = micros();
+        phase.run();
+        phase.endUs = micros();
+        xEventGroupSetBits(done, 1 << (uintptr_t)arg);
+        vTaskDelete(NULL);
+    }
+
+    /**
+     * @brief Runs all init phases, each as soon as its dependencies are done, and returns when all completed
+     *
+     */
+    void run()
+    {
+        bootUs = micros();
+        done = xEventGroupCreate();
+        for (uintptr_t i = 0; i < PHASE_COUNT; i++)
+        {
+            xTaskCreatePinnedToCore(phaseTask, phases[i].name, PHASE_STACK, (void *)i, 1, NULL, phases[i].core);
+        }
+        xEventGroupWaitBits(done, (1 << PHASE_COUNT) - 1, pdFALSE, pdTRUE, portMAX_DELAY);
+        vEventGroupDelete(done);
+        for (uint8_t i = 0; i < PHASE_COUNT; i++)
+        {
+            debug("[boot.h] ");
+            debug(phases[i].name);
+            debug(": ");
+            debug(phases[i].startUs - bootUs);
+            debug(" -> ");
+            debug(phases[i].endUs - bootUs);
+            debugln(" us");
+        }
+        debug("[boot.h] time to first frame: ");
+        debug(phases[FIRST_FRAME].endUs - bootUs);
+        debugln(" us");
+        lastCacheMs = Clock::now();
+    }
+
+    // logs the first live sample and keeps the cache of last known readings up to date
+    void doTick()
+    {
+        if (!firstSampleLogged && Radio::frames > 0)
+        {
+            firstSampleLogged = true;
+            debug("[boot.h] time to first live sample: ");
+            debug(micros() - bootUs);
+            debugln(" us");
+        }
+        if (Radio::frames != cachedFrames && Clock::now() - lastCacheMs >= CACHE_INTERVAL)
+        {
+            saveCache();
+            cachedFrames = Radio::frames;
+            lastCacheMs = Clock::now();
+        }
+    }
+};
+
+#endif
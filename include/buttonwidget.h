@@ -14,6 +14,7 @@
 #include <Arduino.h>
 #include <TFT_eSPI.h>
 #include "debug.h"
+#include "spritecache.h"
 
 class ButtonWidget
 {
@@ -37,6 +38,45 @@ public:
         RIGHT
     };
 
+    // Marks a precomputed coordinate that depends on glyph widths and must be resolved at draw time
+    static constexpr uint16_t AUTO = 0xFFFF;
+
+    /**
+     * @brief Constant description of a button, meant to live in flash (see layout.h)
+     *
+     */
+    struct Spec
+    {
+        uint8_t id;
+        uint16_t startx;
+        uint16_t starty;
+        uint16_t sizex;
+        uint16_t sizey;
+        ButtonStyles style;
+        uint16_t bgcolor;
+        uint16_t fgcolor;
+        uint16_t cornerradius;
+        const uint8_t *icon;
+        const char *text;
+        uint8_t font;
+        uint8_t fontSize;
+        const char *tooltip;
+        uint8_t tooltipFont;
+        uint8_t tooltipFontSize;
+        TooltipPositions tooltipPosition;
+        uint16_t tooltipPadding;
+        uint16_t tooltipFgColor;
+        // Derived coordinates, filled in at compile time by Layout::resolve
+        uint16_t endx;
+        uint16_t endy;
+        uint16_t textx;
+        uint16_t texty;
+        uint16_t tooltipx;
+        uint16_t tooltipy;
+        // Greenhouse channel shown by the widget, 0xFF if none
+        uint8_t channel;
+    };
+
 private:
     // X touch position
     uint16_t *_touchx;
@@ -53,9 +93,9 @@ private:
     // Y size of the button
     uint16_t _sizey;
     // Button icon
-    uint8_t *_icon = {0};
+    const uint8_t *_icon = nullptr;
     // Button text
-    char *_text = "";
+    const char *_text = "";
     // Button style
     ButtonStyles _style = ButtonStyles::RECT;
     // Background color
@@ -73,13 +113,150 @@ private:
     uint8_t _font = 2;
 
     bool _tooltipPresent = false;
-    char *_tooltip = "";
+    const char *_tooltip = "";
     uint8_t _tooltipFont = 2;
     uint8_t _tooltipFontSize = 1;
     TooltipPositions _tooltipPosition = TooltipPositions::RIGHT;
     uint16_t _tooltipPadding = 10;
     uint16_t _tooltipFgColor = TFT_BLACK;
 
+    // Precomputed text and tooltip cursor positions (AUTO = compute while drawing)
+    uint16_t _textx = AUTO;
+    uint16_t _texty = AUTO;
+    uint16_t _tooltipx = AUTO;
+    uint16_t _tooltipy = AUTO;
+
+    // Static layers are cached in a sprite on a _canvasColor background
+    bool _cached = false;
+    uint16_t _canvasColor = TFT_WHITE;
+
+    // Identifies the static look of the button in the sprite cache
+    uint32_t cacheKey()
+    {
+        // FNV-1a over everything that changes the rendering
+        uint32_t hash = 2166136261u;
+        uintptr_t fields[] = {_startx, _starty, _sizex, _sizey, (uintptr_t)_style, _bgcolor, _fgcolor, _cornerradius,
+                              _hasIcon, (uintptr_t)_icon, (uintptr_t)_text, _font, _fontSize, _tooltipPresent, (uintptr_t)_tooltip,
+                              _tooltipFont, _tooltipFontSize, (uintptr_t)_tooltipPosition, _tooltipPadding, _tooltipFgColor, _canvasColor};
+        for (uintptr_t field : fields)
+        {
+            for (uint8_t i = 0; i < sizeof(field); i++)
+            {
+                hash = (hash ^ ((field >> (8 * i)) & 0xFF)) * 16777619u;
+            }
+        }
+        return hash;
+    }
+
+    // Computes where the tooltip goes, leaves the tooltip font selected on target
+    void tooltipPosition(TFT_eSPI *target, int16_t &startX, int16_t &startY)
+    {
+        target->setTextSize(_tooltipFontSize);
+        target->setTextFont(_tooltipFont);
+        startX = _tooltipx;
+        startY = _tooltipy;
+        if (_tooltipx != AUTO && _tooltipy != AUTO)
+        {
+            return;
+        }
+        uint16_t fontSizeX = target->textWidth(_tooltip, _tooltipFont);
+        uint16_t fontSizeY = target->fontHeight();
+        switch (_tooltipPosition)
+        {
+        case TooltipPositions::RIGHT:
+        {
+            // Center the text on the right
+            startX = _startx + _sizex + _tooltipPadding;
+            startY = _starty + ((_sizey - fontSizeY) / 2);
+            break;
+        }
+        case TooltipPositions::LEFT:
+        {
+            // Center the text on the left
+            startX = _startx - fontSizeX - _tooltipPadding;
+            startY = _starty + ((_sizey - fontSizeY) / 2);
+            break;
+        }
+        case TooltipPositions::UP:
+        {
+            // Center the text up
+            startX = _startx + ((_sizex - fontSizeX) / 2);
+            startY = _starty - _tooltipPadding;
+            break;
+        }
+        case TooltipPositions::DOWN:
+        {
+            // Center the text down
+            startX = _startx + ((_sizex - fontSizeX) / 2);
+            startY = _starty + _sizey + _tooltipPadding;
+            break;
+        }
+        }
+    }
+
+    // Draws the button on a target whose top left corner is at (originx, originy) on the screen
+    void render(TFT_eSPI *target, int16_t originx, int16_t originy)
+    {
+        int16_t x = _startx - originx;
+        int16_t y = _starty - originy;
+        // Draw background
+        switch (_style)
+        {
+        case ButtonStyles::ROUND_RECT:
+        {
+            target->fillRoundRect(x, y, _sizex, _sizey, _cornerradius, _bgcolor);
+            break;
+        }
+        case ButtonStyles::RECT:
+        {
+            target->fillRect(x, y, _sizex, _sizey, _bgcolor);
+            break;
+        }
+        case ButtonStyles::ELLIPSE:
+        {
+            target->fillEllipse(x + (_sizex / 2), y + (_sizey / 2), _sizex / 2, _sizey / 2, _bgcolor);
+            break;
+        }
+        }
+        // Draw foreground (icon or text)
+        if (_hasIcon)
+        {
+            target->drawXBitmap(x, y, _icon, _sizex, _sizey, _fgcolor);
+        }
+        else
+        {
+            target->setTextSize(_fontSize);
+            target->setTextFont(_font);
+            target->setTextColor(_fgcolor);
+            // Center the text (todo check if text is longer than button?)
+            int16_t startX = _textx;
+            int16_t startY = _texty;
+            if (_textx == AUTO)
+            {
+                uint16_t fontSizeX = target->textWidth(_text, _font);
+                startX = _startx + ((_sizex - fontSizeX) / 2);
+            }
+            if (_texty == AUTO)
+            {
+                uint16_t fontSizeY = target->fontHeight();
+                startY = _starty + ((_sizey - fontSizeY) / 2);
+            }
+            // Print the text
+            target->setCursor(startX - originx, startY - originy);
+            target->print(_text);
+        }
+        // Draw tooltip
+        if (_tooltipPresent)
+        {
+            int16_t startX, startY;
+            tooltipPosition(target, startX, startY);
+            // Print the text
+            target->setTextColor(_tooltipFgColor);
+            target->setCursor(startX - originx, startY - originy);
+            target->print(_tooltip);
+        }
+    }
+
 public:
     /**
      * @brief Constructs a new Touch Button object
@@ -103,6 +280,36 @@ public:
         _sizey = sizey;
     }
 
+    /**
+     * @brief Constructs a new Touch Button object from a constant description
+     *
+     * @param touchx: Pointer to the current touch X position
+     * @param touchy: Pointer to the current touch Y position
+     * @param tft: Pointer to the TFT screen object
+     * @param spec: Button description, usually one entry of a Layout table
+     */
+    ButtonWidget(uint16_t *touchx, uint16_t *touchy, TFT_eSPI *tft, const Spec &spec)
+        : ButtonWidget(touchx, touchy, tft, spec.startx, spec.starty, spec.sizex, spec.sizey)
+    {
+        setStyle(spec.bgcolor, spec.fgcolor, spec.style, spec.cornerradius);
+        if (spec.icon != nullptr)
+        {
+            setIcon(spec.icon);
+        }
+        else
+        {
+            setText(spec.text, spec.font, spec.fontSize);
+        }
+        if (spec.tooltip != nullptr)
+        {
+            setTooltip(spec.tooltip, spec.tooltipFont, spec.tooltipFontSize, spec.tooltipPosition, spec.tooltipPadding, spec.tooltipFgColor);
+        }
+        _textx = spec.textx;
+        _texty = spec.texty;
+        _tooltipx = spec.tooltipx;
+        _tooltipy = spec.tooltipy;
+    }
+
     /**
      * @brief Sets the style of the button
      *
@@ -120,95 +327,73 @@ public:
     }
 
     /**
-     * @brief Draws a button according to the set style parameters
+     * @brief Draws a button according to the set style parameters. If a canvas color was set,
+     * the static layers are cached in a sprite and later draws are a single push.
      *
      */
     void draw()
     {
-        // Draw background
-        switch (_style)
+        if (!_cached)
         {
-        case ButtonStyles::ROUND_RECT:
-        {
-            _tft->fillRoundRect(_startx, _starty, _sizex, _sizey, _cornerradius, _bgcolor);
-            break;
+            render(_tft, 0, 0);
+            return;
         }
-        case ButtonStyles::RECT:
+        uint32_t key = cacheKey();
+        SpriteCache::Entry_s *entry = SpriteCache::get(key);
+        if (entry == nullptr)
         {
-            _tft->fillRect(_startx, _starty, _sizex, _sizey, _bgcolor);
-            break;
-        }
-        case ButtonStyles::ELLIPSE:
-        {
-            _tft->fillEllipse(_startx + (_sizex / 2), _starty + (_sizey / 2), _sizex / 2, _sizey / 2, _bgcolor);
-            break;
-        }
-        }
-        // Draw foreground (icon or text)
-        if (_hasIcon)
-        {
-            _tft->drawXBitmap(_startx, _starty, _icon, _sizex, _sizey, _fgcolor);
-        }
-        else
-        {
-            _tft->setTextSize(_fontSize);
-            _tft->setTextFont(_font);
-            _tft->setTextColor(_fgcolor);
-            // Center the text (todo check if text is longer than button?)
-            uint8_t fontSizeY = _tft->fontHeight();
-            uint8_t fontSizeX = _tft->textWidth(_text, _font);
-            uint16_t startX = _startx + ((_sizex - fontSizeX) / 2);
-            uint16_t startY = _starty + ((_sizey - fontSizeY) / 2);
-            // Print the text
-            debugln(startX);
-            debugln(startY);
-            _tft->setCursor(startX, startY);
-            _tft->print(_text);
-        }
-        // Draw tooltip
-        if (_tooltipPresent)
-        {
-            _tft->setTextSize(_tooltipFontSize);
-            _tft->setTextFont(_tooltipFont);
-            uint8_t fontSizeX = _tft->textWidth(_text, _font);
-            uint8_t fontSizeY = fontSizeY = _tft->fontHeight();
-            uint8_t startX, startY;
-            switch (_tooltipPosition)
-            {
-            case TooltipPositions::RIGHT:
-            {
-                // Center the text on the right
-                startX = _startx + _sizex + _tooltipPadding;
-                startY = _starty + ((_sizey - fontSizeY) / 2);
-                break;
-            }
-            case TooltipPositions::LEFT:
-            {
-                // Center the text on the left
-                startX = _startx - fontSizeX - _tooltipPadding;
-                startY = _starty + ((_sizey - fontSizeY) / 2);
-                break;
-            }
-            case TooltipPositions::UP:
+            // Bounding box of the button and its tooltip
+            int16_t boxx = _startx;
+            int16_t boxy = _starty;
+            int16_t boxex = _startx + _sizex;
+            int16_t boxey = _starty + _sizey;
+            if (_tooltipPresent)
             {
-                // Center the text up
-                startX = _startx + ((_sizex - fontSizeX) / 2);
-                startY = _starty - _tooltipPadding;
-                break;
+                int16_t tx, ty;
+                tooltipPosition(_tft, tx, ty);
+                _tft->setTextFont(_tooltipFont);
+                _tft->setTextSize(_tooltipFontSize);
+                boxx = min(boxx, tx);
+                boxy = min(boxy, ty);
+                boxex = max(boxex, (int16_t)(tx + _tft->textWidth(_tooltip, _tooltipFont)));
+                boxey = max(boxey, (int16_t)(ty + _tft->fontHeight()));
             }
-            case TooltipPositions::DOWN:
+            entry = SpriteCache::create(_tft, key, boxx, boxy, boxex - boxx, boxey - boxy);
+            if (entry == nullptr)
             {
-                // Center the text down
-                startX = _startx + ((_sizex - fontSizeX) / 2);
-                startY = _starty + _sizey + _tooltipPadding;
-                break;
+                // Over budget or out of memory, draw straight to the screen
+                render(_tft, 0, 0);
+                return;
             }
-            }
-            // Print the text
-            _tft->setTextColor(_tooltipFgColor);
-            _tft->setCursor(startX, startY);
-            _tft->print(_tooltip);
+            uint32_t start = micros();
+            entry->sprite->fillSprite(_canvasColor);
+            render(entry->sprite, entry->x, entry->y);
+            entry->renderUs = micros() - start;
         }
+        SpriteCache::push(entry);
+    }
+
+    /**
+     * @brief Draws the button on another target, e.g. a band of a screen snapshot
+     *
+     * @param target: Sprite or screen to draw on
+     * @param originx: Screen X cordinate of the top left corner of target
+     * @param originy: Screen Y cordinate of the top left corner of target
+     */
+    void drawTo(TFT_eSPI *target, int16_t originx, int16_t originy)
+    {
+        render(target, originx, originy);
+    }
+
+    /**
+     * @brief Caches the static layers of the button in a sprite from now on
+     *
+     * @param color: Screen color around the button (and under its tooltip)
+     */
+    void setCanvasColor(uint16_t color)
+    {
+        _cached = true;
+        _canvasColor = color;
     }
 
     /**
@@ -237,9 +422,11 @@ public:
      * @param font: Font of the text
      * @param fontSize: Font size of the text
      */
-    void setText(char *text, uint8_t font, uint8_t fontSize)
+    void setText(const char *text, uint8_t font, uint8_t fontSize)
     {
         _hasIcon = false;
+        _textx = AUTO;
+        _texty = AUTO;
         _text = text;
         _font = font;
         _fontSize = fontSize;
@@ -250,7 +437,7 @@ public:
      *
      * @param icon: Path to the icon to be displayed
      */
-    void setIcon(uint8_t *icon)
+    void setIcon(const uint8_t *icon)
     {
         _hasIcon = true;
         _icon = icon;
@@ -325,9 +512,11 @@ public:
      * @param position: Placement of the tooltip
      * @param padding: Tooltip padding (distance from buttonwidget)
      */
-    void setTooltip(char *tooltip, uint8_t font, uint8_t fontSize, TooltipPositions position, uint16_t padding = 0, uint16_t fgcolor = TFT_BLACK)
+    void setTooltip(const char *tooltip, uint8_t font, uint8_t fontSize, TooltipPositions position, uint16_t padding = 0, uint16_t fgcolor = TFT_BLACK)
     {
         _tooltipPresent = true;
+        _tooltipx = AUTO;
+        _tooltipy = AUTO;
         _tooltip = tooltip;
         _tooltipFont = font;
         _tooltipFontSize = fontSize;
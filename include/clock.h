@@ -0,0 +1,41 @@
+/**
+ * @file clock.h
+ * @author Riccardo Iacob
+ * @brief Time source of the modules, either millis() or a virtual clock driven by a trace replay
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <Arduino.h>
+
+namespace Clock
+{
+    // When true, now() returns virtualMs instead of millis()
+    bool isVirtual = false;
+    uint32_t virtualMs = 0;
+
+    // milliseconds since boot (or since the start of the replayed trace)
+    uint32_t now()
+    {
+        return isVirtual ? virtualMs : millis();
+    }
+
+    // switches to the virtual clock, starting at ms
+    void setVirtual(uint32_t ms)
+    {
+        isVirtual = true;
+        virtualMs = ms;
+    }
+
+    void advance(uint32_t ms)
+    {
+        virtualMs += ms;
+    }
+};
+
+#endif
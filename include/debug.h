@@ -16,8 +16,13 @@
 #define DEBUG true
 
 #if DEBUG == true
-#define debug(x) Serial.print(x)
-#define debugln(x) Serial.println(x)
+namespace Debug
+{
+    // Destination of debug text, the serial link swaps it for a framed log while a host is connected
+    Print *out = &Serial;
+};
+#define debug(x) Debug::out->print(x)
+#define debugln(x) Debug::out->println(x)
 #else
 #define debug(x)
 #define debugln(x)
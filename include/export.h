@@ -0,0 +1,328 @@
+/**
+ * @file export.h
+ * @author Riccardo Iacob
+ * @brief Streaming compressed export of the sensor history
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Records are read from History a page at a time and handed to the sink in chunks of at most
+ * CHUNK bytes, so nothing but a page, the window and a chunk is ever in RAM. Every chunk decodes
+ * on its own, a lost chunk only loses its records:
+ *   index of the first record in the history (u32, little endian), record count (u16)
+ *   LZSS compressed records
+ * Records are encoded as:
+ *   time delta from the previous record (varint)
+ *   one zigzag varint per channel, value delta from the previous record
+ *   quality bits, one byte per channel
+ * The first record of a chunk is a delta from zero, the window starts empty in every chunk. A chunk
+ * the sink doesn't take is encoded again from its first record on the next step.
+ *
+ * LZSS bit stream, most significant bit first:
+ *   1, byte (8 bits)                                          literal
+ *   0, distance - 1 (WINDOW_BITS), length - MIN_MATCH (LENGTH_BITS)  copy from the output
+ * The last byte is padded with zeros, the decoder stops when fewer bits than a whole token are left.
+ * host/export_decoder.h decodes chunks on the host.
+ */
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <Arduino.h>
+#include "debug.h"
+#include "greenhouse.h"
+#include "history.h"
+
+namespace Export
+{
+    const uint8_t WINDOW_BITS = 9;
+    const uint8_t LENGTH_BITS = 4;
+    const uint16_t WINDOW = 1 << WINDOW_BITS;
+    const uint8_t MIN_MATCH = 2;
+    const uint8_t MAX_MATCH = MIN_MATCH + (1 << LENGTH_BITS) - 1;
+    // Window plus lookahead, power of two
+    const uint16_t RING = 2 * WINDOW;
+    const uint16_t CHUNK = 1024;
+    const uint8_t HEADER = 6;
+    const uint8_t PAGE = 8;
+    // Longest encoded record: time varint, 17 bit zigzag deltas, quality bytes
+    const uint8_t RECORD_MAX = 5 + Greenhouse::CHANNEL_COUNT * 3 + Greenhouse::CHANNEL_COUNT;
+    // Worst case output of a page (a full chunk and the page as literals), for callers reserving output space
+    const uint16_t PAGE_BOUND = CHUNK + PAGE * RECORD_MAX * 9 / 8 + MAX_MATCH * 9 / 8 + HEADER + 2;
+
+    // Returns false if the chunk was not taken
+    typedef bool (*Sink)(const uint8_t *chunk, uint16_t length);
+
+    // Encoder and compressor state
+    uint8_t ring[RING];
+    // Absolute positions: bytes written to the ring, start of the lookahead
+    uint32_t filled = 0;
+    uint32_t head = 0;
+    uint8_t bits = 0;
+    uint8_t bitCount = 0;
+    uint8_t chunk[CHUNK];
+    uint16_t chunkLength = 0;
+    uint32_t chunkFirst = 0;
+    uint16_t chunkRecords = 0;
+    // rawBytes when the chunk was started
+    uint32_t chunkRaw = 0;
+    History::Record_s previous;
+    Sink sink = nullptr;
+
+    // Transfer state
+    bool active = false;
+    uint32_t next = 0;
+    uint32_t remaining = 0;
+    uint32_t records = 0;
+    uint32_t rawBytes = 0;
+    uint32_t compressedBytes = 0;
+    uint32_t retries = 0;
+    uint32_t startUs = 0;
+
+    bool begin(uint32_t first, uint32_t count, Sink output);
+    bool doStep();
+
+    // Room in the chunk is checked before each record, see encode()
+    void putByte(uint8_t byte)
+    {
+        chunk[chunkLength++] = byte;
+    }
+
+    void putBits(uint16_t value, uint8_t count)
+    {
+        while (count-- > 0)
+        {
+            bits = (bits << 1) | ((value >> count) & 1);
+            if (++bitCount == 8)
+            {
+                putByte(bits);
+                bits = 0;
+                bitCount = 0;
+            }
+        }
+    }
+
+    // Emits one token for the start of the lookahead
+    void emit()
+    {
+        uint32_t lookahead = filled - head;
+        uint16_t history = head < WINDOW ? head : WINDOW;
+        uint8_t bestLength = 0;
+        uint16_t bestDistance = 0;
+        uint8_t limit = lookahead < MAX_MATCH ? lookahead : MAX_MATCH;
+        for (uint16_t distance = 1; distance <= history; distance++)
+        {
+            uint8_t length = 0;
+            // Overlapping copies are fine, the decoder copies byte by byte
+            while (length < limit && ring[(head - distance + length) & (RING - 1)] == ring[(head + length) & (RING - 1)])
+            {
+                length++;
+            }
+            if (length > bestLength)
+            {
+                bestLength = length;
+                bestDistance = distance;
+                if (length == limit)
+                {
+                    break;
+                }
+            }
+        }
+        if (bestLength >= MIN_MATCH)
+        {
+            putBits(0, 1);
+            putBits(bestDistance - 1, WINDOW_BITS);
+            putBits(bestLength - MIN_MATCH, LENGTH_BITS);
+            head += bestLength;
+        }
+        else
+        {
+            putBits(1, 1);
+            putBits(ring[head & (RING - 1)], 8);
+            head++;
+        }
+    }
+
+    void compress(uint8_t byte)
+    {
+        ring[filled++ & (RING - 1)] = byte;
+        rawBytes++;
+        if (filled - head == MAX_MATCH)
+        {
+            emit();
+        }
+    }
+
+    void writeVarint(uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            compress((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        compress((uint8_t)value);
+    }
+
+    // Starts a chunk with an empty window, at the record with the given history index
+    void startChunk(uint32_t index)
+    {
+        memset(&previous, 0, sizeof(previous));
+        filled = 0;
+        head = 0;
+        bits = 0;
+        bitCount = 0;
+        chunkLength = HEADER;
+        chunkFirst = index;
+        chunkRecords = 0;
+        chunkRaw = rawBytes;
+    }
+
+    // Compresses what's left in the lookahead and hands out the chunk, false if the sink didn't take it
+    bool endChunk()
+    {
+        while (head != filled)
+        {
+            emit();
+        }
+        if (bitCount > 0)
+        {
+            putBits(0, 8 - bitCount);
+        }
+        if (chunkRecords > 0)
+        {
+            memcpy(chunk, &chunkFirst, 4);
+            memcpy(chunk + 4, &chunkRecords, 2);
+            if (!sink(chunk, chunkLength))
+            {
+                return false;
+            }
+            compressedBytes += chunkLength;
+        }
+        return true;
+    }
+
+    // Adds a record to the chunk, false if the chunk it had to close was not taken
+    bool encode(const History::Record_s &record, uint32_t index)
+    {
+        // Close the chunk unless the pending lookahead and this record fit even as literals
+        uint16_t bound = chunkLength + (bitCount > 0) + ((filled - head) + RECORD_MAX) * 9 / 8 + 1;
+        if (bound > CHUNK)
+        {
+            if (!endChunk())
+            {
+                return false;
+            }
+            startChunk(index);
+        }
+        writeVarint(record.time - previous.time);
+        for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+        {
+            int32_t delta = (int32_t)record.values[i] - previous.values[i];
+            writeVarint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        }
+        for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+        {
+            compress(record.quality[i]);
+        }
+        previous = record;
+        chunkRecords++;
+        records++;
+        return true;
+    }
+
+    // Goes back to the first record of the chunk the sink didn't take, the next step encodes it again
+    void retry()
+    {
+        remaining += next - chunkFirst;
+        next = chunkFirst;
+        records -= chunkRecords;
+        rawBytes = chunkRaw;
+        startChunk(chunkFirst);
+        retries++;
+    }
+
+    void finish()
+    {
+        active = false;
+        uint32_t elapsedUs = micros() - startUs;
+        debug("[export.h] ");
+        debug(records);
+        debug(" records, ");
+        debug(rawBytes);
+        debug(" -> ");
+        debug(compressedBytes);
+        debug(" bytes (");
+        debug(records > 0 ? compressedBytes * 100 / (records * sizeof(History::Record_s)) : 0);
+        debug("% of the stored records) in ");
+        debug(elapsedUs / 1000);
+        debug(" ms, chunks resent: ");
+        debugln(retries);
+    }
+
+    /**
+     * @brief Starts exporting count records from first (0 being the oldest)
+     *
+     * @param output: Receives the compressed stream in chunks of at most CHUNK bytes
+     * @return false if an export is already running
+     */
+    bool begin(uint32_t first, uint32_t count, Sink output)
+    {
+        if (active)
+        {
+            return false;
+        }
+        sink = output;
+        next = first;
+        remaining = count;
+        records = 0;
+        rawBytes = 0;
+        compressedBytes = 0;
+        retries = 0;
+        startChunk(first);
+        startUs = micros();
+        active = true;
+        return true;
+    }
+
+    /**
+     * @brief Exports one page, at most PAGE_BOUND bytes go to the sink
+     *
+     * @return true once the export is complete and the sink took every chunk
+     */
+    bool doStep()
+    {
+        if (!active)
+        {
+            return true;
+        }
+        History::Record_s page[PAGE];
+        uint32_t n = History::read(next, page, remaining < PAGE ? remaining : PAGE);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (!encode(page[i], next))
+            {
+                retry();
+                return false;
+            }
+            next++;
+            remaining--;
+        }
+        if (n == 0)
+        {
+            remaining = 0;
+        }
+        if (remaining == 0)
+        {
+            if (!endChunk())
+            {
+                retry();
+                return false;
+            }
+            finish();
+            return true;
+        }
+        return false;
+    }
+};
+
+#endif
@@ -15,7 +15,18 @@
 
 namespace Globals {
     long pollDelay = 5000;
-    uint32_t baudrate = 115200;
+    uint32_t baudrate = 921600;
+    // inactivity before the backlight is dimmed and then turned off (ms)
+    long dimDelay = 30000;
+    long blankDelay = 120000;
+    // pins
+    uint8_t touchIrqPin = 22;
+    uint8_t radioGdo0Pin = 4;
+    // LEDC capable and not shared with anything else
+    uint8_t backlightPin = 32;
+    // DS3231 bus, the default pins 21/22 would collide with the touch interrupt
+    uint8_t i2cSdaPin = 25;
+    uint8_t i2cSclPin = 26;
 };
 
 #endif
\ No newline at end of file
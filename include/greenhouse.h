@@ -15,28 +15,122 @@
 
 namespace Greenhouse
 {
-    // data received from greenhouse
+    // indices of the readings in Data_s, used by modules working on every channel
+    enum Channels : uint8_t
+    {
+        TEMP1,
+        TEMP2,
+        TEMP3,
+        HUM1,
+        HUM2,
+        HUM3,
+        CHANNEL_COUNT
+    };
+    // readings are fixed point, in hundredths of their unit
+    constexpr int16_t SCALE = 100;
+    // raw value of a channel missing from a frame
+    constexpr int16_t MISSING = INT16_MIN;
+    // quality flags of a reading
+    enum Quality : uint8_t
+    {
+        QUALITY_OK = 0,
+        // no fresh value for longer than the channel timeout
+        QUALITY_STALE = 1,
+        // last raw value was outside the plausible range and was discarded
+        QUALITY_RANGE = 2
+    };
+    // timeError of a reading taken before its slave was synchronised
+    constexpr uint16_t TIME_UNKNOWN = 0xFFFF;
+    // data received from greenhouse, after filtering (see sensors.h)
     struct Data_s {
-        float temp1;
-        float temp2;
-        float temp3;
-        float hum1;
-        float hum2;
-        float hum3;
+        // acquisition time on the master timeline (seconds since epoch, see rtchelper.h)
+        uint32_t time;
+        uint16_t timeMs;
+        // bound of the timestamp error (ms)
+        uint16_t timeError;
+        int16_t values[CHANNEL_COUNT];
+        uint8_t quality[CHANNEL_COUNT];
+    };
+    // timing of a slave reply to a master beacon, all in ms of the slave clock except beacon (see timesync.h)
+    struct Stamp_s {
+        uint8_t slave;
+        // master time carried by the beacon being answered
+        uint32_t beacon;
+        uint32_t received;
+        uint32_t sent;
+        // acquisition of the readings in the reply
+        uint32_t sampled;
+    };
+    // actuators driven on the greenhouse, see Config_s
+    enum Outputs : uint8_t
+    {
+        VENT,
+        FAN,
+        MISTER,
+        OUTPUT_COUNT
     };
     // data to be sent to greenhouse
     struct Config_s {
         bool test;
+        // actuator levels, 0 (closed/off) to 100 (open/full power)
+        uint8_t vent;
+        uint8_t fan;
+        uint8_t mister;
     };
     Data_s data;
     Config_s config;
-    void loadDummyData() {
-        data.temp1 = random(2200,2400)/100.0;
-        data.temp2 = random(2200,2400)/100.0;
-        data.temp3 = random(2200,2400)/100.0;
-        data.hum1 = random(7400,7600)/100.0;
-        data.hum2 = random(7400,7600)/100.0;
-        data.hum3 = random(7400,7600)/100.0;
+    // fills a raw frame with fake readings
+    void loadDummyData(int16_t *frame) {
+        frame[TEMP1] = random(2200,2400);
+        frame[TEMP2] = random(2200,2400);
+        frame[TEMP3] = random(2200,2400);
+        frame[HUM1] = random(7400,7600);
+        frame[HUM2] = random(7400,7600);
+        frame[HUM3] = random(7400,7600);
+    }
+    // fills the stamp of a fake slave whose clock is 5 s ahead and runs 40 ppm fast
+    void loadDummyStamp(Stamp_s &stamp, uint32_t beacon) {
+        uint32_t slaveMs = beacon + 5000 + (uint32_t)((uint64_t)beacon * 40 / 1000000);
+        stamp.slave = 0;
+        stamp.beacon = beacon;
+        stamp.received = slaveMs;
+        stamp.sent = slaveMs;
+        stamp.sampled = slaveMs - random(0, 500);
+    }
+    // returns the reading of a channel in its unit
+    float getChannel(const Data_s &d, uint8_t channel) {
+        if (channel >= CHANNEL_COUNT) {
+            return 0;
+        }
+        return d.values[channel] / (float)SCALE;
+    }
+    // returns the level of an actuator
+    uint8_t getOutput(const Config_s &c, uint8_t output) {
+        switch (output) {
+        case VENT: return c.vent;
+        case FAN: return c.fan;
+        case MISTER: return c.mister;
+        default: return 0;
+        }
+    }
+    // sets the level of an actuator, returns true if it changed
+    bool setOutput(Config_s &c, uint8_t output, uint8_t level) {
+        uint8_t *target;
+        switch (output) {
+        case VENT: target = &c.vent; break;
+        case FAN: target = &c.fan; break;
+        case MISTER: target = &c.mister; break;
+        default: return false;
+        }
+        if (*target == level) {
+            return false;
+        }
+        *target = level;
+        return true;
+    }
+    // returns the unit of measure of a channel
+    const char *getUnit(uint8_t channel) {
+        return channel <= TEMP3 ? "C" : "%";
     }
 };
 
@@ -0,0 +1,207 @@
+/**
+ * @file history.h
+ * @author Riccardo Iacob
+ * @brief Persistent ring buffer of past readings on LittleFS
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "debug.h"
+#include "clock.h"
+#include "greenhouse.h"
+
+namespace History
+{
+    const char *DATA_FILE = "/history.bin";
+    const char *META_FILE = "/history.meta";
+    // One record per interval, 4 weeks of records
+    const uint32_t INTERVAL = 60000;
+    const uint32_t MAX_RECORDS = 28UL * 24 * 60;
+    // Records between writes of META_FILE, limits flash wear like Boot::CACHE_INTERVAL
+    const uint32_t META_RECORDS = 10;
+
+    struct Record_s
+    {
+        // Seconds, see Greenhouse data timestamps
+        uint32_t time;
+        int16_t values[Greenhouse::CHANNEL_COUNT];
+        uint8_t quality[Greenhouse::CHANNEL_COUNT];
+    };
+
+    // Ring position, persisted in META_FILE every META_RECORDS records, the rest found again by doSetup
+    struct Meta_s
+    {
+        uint32_t head;
+        uint32_t count;
+    };
+
+    Meta_s meta = {0, 0};
+    bool ready = false;
+    uint32_t lastAppendMs = 0;
+    bool appended = false;
+    // Records appended since META_FILE was written
+    uint32_t unsaved = 0;
+
+    bool doSetup();
+    bool readRecord(File &file, uint32_t index, Record_s &record);
+    void saveMeta();
+    void append(const Greenhouse::Data_s &data, uint32_t time);
+    uint32_t read(uint32_t first, Record_s *out, uint32_t n);
+
+    // Reads the record at a ring index, false if the file doesn't reach it
+    bool readRecord(File &file, uint32_t index, Record_s &record)
+    {
+        return file.seek(index * sizeof(Record_s)) && file.read((uint8_t *)&record, sizeof(record)) == sizeof(record);
+    }
+
+    /**
+     * @brief Loads the ring position, LittleFS must be mounted
+     *
+     * META_FILE can be up to META_RECORDS records behind the data file. Records written after it are
+     * newer than the one before them: the head is moved over them while the time keeps increasing.
+     */
+    bool doSetup()
+    {
+        meta = {0, 0};
+        unsaved = 0;
+        bool valid = true;
+        if (LittleFS.exists(META_FILE))
+        {
+            File file = LittleFS.open(META_FILE, FILE_READ);
+            if (file.read((uint8_t *)&meta, sizeof(meta)) != sizeof(meta) || meta.head >= MAX_RECORDS || meta.count > MAX_RECORDS)
+            {
+                debugln("[history.h] invalid meta file, history reset");
+                meta = {0, 0};
+                valid = false;
+            }
+            file.close();
+        }
+        if (!valid || !LittleFS.exists(DATA_FILE))
+        {
+            File file = LittleFS.open(DATA_FILE, FILE_WRITE);
+            file.close();
+            meta = {0, 0};
+        }
+        File file = LittleFS.open(DATA_FILE, FILE_READ);
+        Record_s previous;
+        Record_s record;
+        bool hasPrevious = meta.count > 0 && readRecord(file, (meta.head + MAX_RECORDS - 1) % MAX_RECORDS, previous);
+        uint32_t recovered = 0;
+        while (recovered < META_RECORDS && readRecord(file, meta.head, record) && (!hasPrevious || record.time > previous.time))
+        {
+            previous = record;
+            hasPrevious = true;
+            meta.head = (meta.head + 1) % MAX_RECORDS;
+            if (meta.count < MAX_RECORDS)
+            {
+                meta.count++;
+            }
+            recovered++;
+        }
+        file.close();
+        if (recovered > 0)
+        {
+            debug("[history.h] records recovered past the meta file: ");
+            debugln(recovered);
+            saveMeta();
+        }
+        ready = true;
+        return true;
+    }
+
+    // Writes the ring position to META_FILE
+    void saveMeta()
+    {
+        File file = LittleFS.open(META_FILE, FILE_WRITE);
+        file.write((const uint8_t *)&meta, sizeof(meta));
+        file.close();
+        unsaved = 0;
+    }
+
+    // Number of stored records
+    uint32_t size()
+    {
+        return meta.count;
+    }
+
+    /**
+     * @brief Stores a reading, at most one per INTERVAL, overwriting the oldest when full
+     *
+     * @param data: Filtered reading
+     * @param time: Timestamp of the reading in seconds
+     */
+    void append(const Greenhouse::Data_s &data, uint32_t time)
+    {
+        if (!ready || (appended && Clock::now() - lastAppendMs < INTERVAL))
+        {
+            return;
+        }
+        appended = true;
+        lastAppendMs = Clock::now();
+        Record_s record;
+        memset(&record, 0, sizeof(record));
+        record.time = time;
+        memcpy(record.values, data.values, sizeof(record.values));
+        memcpy(record.quality, data.quality, sizeof(record.quality));
+        File file = LittleFS.open(DATA_FILE, "r+");
+        if (!file)
+        {
+            return;
+        }
+        file.seek(meta.head * sizeof(Record_s));
+        file.write((const uint8_t *)&record, sizeof(record));
+        file.close();
+        meta.head = (meta.head + 1) % MAX_RECORDS;
+        if (meta.count < MAX_RECORDS)
+        {
+            meta.count++;
+        }
+        if (++unsaved >= META_RECORDS)
+        {
+            saveMeta();
+        }
+    }
+
+    /**
+     * @brief Reads consecutive records, 0 being the oldest
+     *
+     * @return uint32_t: Number of records read
+     */
+    uint32_t read(uint32_t first, Record_s *out, uint32_t n)
+    {
+        if (!ready || first >= meta.count)
+        {
+            return 0;
+        }
+        if (n > meta.count - first)
+        {
+            n = meta.count - first;
+        }
+        File file = LittleFS.open(DATA_FILE, FILE_READ);
+        uint32_t oldest = (meta.head + MAX_RECORDS - meta.count) % MAX_RECORDS;
+        uint32_t done = 0;
+        while (done < n)
+        {
+            uint32_t index = (oldest + first + done) % MAX_RECORDS;
+            // Read up to the end of the file in one go, then wrap
+            uint32_t chunk = min(n - done, MAX_RECORDS - index);
+            file.seek(index * sizeof(Record_s));
+            if (file.read((uint8_t *)&out[done], chunk * sizeof(Record_s)) != chunk * sizeof(Record_s))
+            {
+                break;
+            }
+            done += chunk;
+        }
+        file.close();
+        return done;
+    }
+};
+
+#endif
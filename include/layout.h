@@ -0,0 +1,364 @@
+/**
+ * @file layout.h
+ * @author Riccardo Iacob
+ * @brief Declarative screen layouts, resolved and validated at compile time
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "buttonwidget.h"
+#include "icons.h"
+#include "greenhouse.h"
+
+namespace Layout
+{
+    // Panel size in rotation 0
+    constexpr uint16_t SCREEN_WIDTH = 320;
+    constexpr uint16_t SCREEN_HEIGHT = 480;
+    // Bump when screens change look without their tables changing (e.g. ButtonWidget drawing), drops screen snapshots
+    constexpr uint16_t VERSION = 1;
+    // Strip at the bottom of every screen kept free for the progress bar (see TFT::setProgress)
+    constexpr uint16_t PROGRESS_HEIGHT = 8;
+    constexpr uint16_t PROGRESS_Y = SCREEN_HEIGHT - PROGRESS_HEIGHT;
+
+    // Returned by hitTest when no widget was touched
+    constexpr uint8_t NONE = 0xFF;
+    // Width cleared behind the value of a bound widget, so a shorter value doesn't leave pixels behind
+    constexpr uint16_t VALUE_WIDTH = 70;
+
+    // Widget identifiers, unique across all screens
+    enum Ids : uint8_t
+    {
+        IDLE_CONFIG,
+        IDLE_TEMP1,
+        IDLE_TEMP2,
+        IDLE_TEMP3,
+        IDLE_HUM1,
+        IDLE_HUM2,
+        IDLE_HUM3,
+        CONFIG_BACK,
+        CONFIG_SPINBOX
+    };
+
+    // Height in pixels of the TFT_eSPI built-in fonts at size 1
+    constexpr uint16_t fontHeight(uint8_t font)
+    {
+        switch (font)
+        {
+        case 1:
+            return 8;
+        case 2:
+            return 16;
+        case 4:
+            return 26;
+        case 6:
+        case 7:
+            return 48;
+        case 8:
+            return 75;
+        default:
+            return 0;
+        }
+    }
+
+    // Widest glyph of the TFT_eSPI built-in fonts at size 1, bounds text widths only known at draw time
+    constexpr uint16_t fontWidth(uint8_t font)
+    {
+        switch (font)
+        {
+        case 1:
+            return 6;
+        case 2:
+            return 13;
+        case 4:
+            return 26;
+        case 6:
+        case 7:
+            return 48;
+        case 8:
+            return 75;
+        default:
+            return 0;
+        }
+    }
+
+    constexpr uint16_t textLength(const char *text)
+    {
+        uint16_t length = 0;
+        while (text[length] != '\0')
+        {
+            length++;
+        }
+        return length;
+    }
+
+    // Fills in the derived coordinates of a spec, mirroring the placement done by ButtonWidget::draw
+    constexpr ButtonWidget::Spec resolve(ButtonWidget::Spec s)
+    {
+        s.endx = s.startx + s.sizex;
+        s.endy = s.starty + s.sizey;
+        // Text width needs the font glyph tables, so only the vertical centering is precomputed
+        s.textx = ButtonWidget::AUTO;
+        s.texty = ButtonWidget::AUTO;
+        if (s.icon == nullptr)
+        {
+            s.texty = s.starty + (s.sizey - fontHeight(s.font) * s.fontSize) / 2;
+        }
+        s.tooltipx = ButtonWidget::AUTO;
+        s.tooltipy = ButtonWidget::AUTO;
+        if (s.tooltip != nullptr)
+        {
+            uint16_t height = fontHeight(s.tooltipFont) * s.tooltipFontSize;
+            switch (s.tooltipPosition)
+            {
+            case ButtonWidget::TooltipPositions::RIGHT:
+                s.tooltipx = s.endx + s.tooltipPadding;
+                s.tooltipy = s.starty + (s.sizey - height) / 2;
+                break;
+            case ButtonWidget::TooltipPositions::LEFT:
+                s.tooltipy = s.starty + (s.sizey - height) / 2;
+                break;
+            case ButtonWidget::TooltipPositions::UP:
+                s.tooltipy = s.starty - s.tooltipPadding;
+                break;
+            case ButtonWidget::TooltipPositions::DOWN:
+                s.tooltipy = s.endy + s.tooltipPadding;
+                break;
+            }
+        }
+        return s;
+    }
+
+    // Describes a button showing an XBM icon of the same size as the button
+    constexpr ButtonWidget::Spec icon(uint8_t id, uint16_t x, uint16_t y, uint16_t w, uint16_t h, ButtonWidget::ButtonStyles style, uint16_t bgcolor, uint16_t fgcolor, const uint8_t *bitmap, uint16_t cornerradius = 5)
+    {
+        ButtonWidget::Spec s{id, x, y, w, h, style, bgcolor, fgcolor, cornerradius, bitmap, nullptr, 2, 1,
+                             nullptr, 2, 1, ButtonWidget::TooltipPositions::RIGHT, 0, TFT_BLACK,
+                             0, 0, ButtonWidget::AUTO, ButtonWidget::AUTO, ButtonWidget::AUTO, ButtonWidget::AUTO, NONE};
+        return resolve(s);
+    }
+
+    // Describes a button showing centered text
+    constexpr ButtonWidget::Spec text(uint8_t id, uint16_t x, uint16_t y, uint16_t w, uint16_t h, ButtonWidget::ButtonStyles style, uint16_t bgcolor, uint16_t fgcolor, const char *label, uint8_t font, uint8_t fontSize, uint16_t cornerradius = 5)
+    {
+        ButtonWidget::Spec s{id, x, y, w, h, style, bgcolor, fgcolor, cornerradius, nullptr, label, font, fontSize,
+                             nullptr, 2, 1, ButtonWidget::TooltipPositions::RIGHT, 0, TFT_BLACK,
+                             0, 0, ButtonWidget::AUTO, ButtonWidget::AUTO, ButtonWidget::AUTO, ButtonWidget::AUTO, NONE};
+        return resolve(s);
+    }
+
+    // Binds a button to a greenhouse channel, whose value is printed under the tooltip
+    constexpr ButtonWidget::Spec bind(ButtonWidget::Spec s, uint8_t channel)
+    {
+        s.channel = channel;
+        return s;
+    }
+
+    // Position of the value of a bound widget, right under its tooltip
+    constexpr uint16_t valueX(const ButtonWidget::Spec &s)
+    {
+        return s.tooltipx;
+    }
+
+    constexpr uint16_t valueY(const ButtonWidget::Spec &s)
+    {
+        return s.tooltipy + fontHeight(s.tooltipFont) * s.tooltipFontSize;
+    }
+
+    // Adds a tooltip to a button description
+    constexpr ButtonWidget::Spec tooltip(ButtonWidget::Spec s, const char *label, uint8_t font, uint8_t fontSize, ButtonWidget::TooltipPositions position, uint16_t padding = 0, uint16_t fgcolor = TFT_BLACK)
+    {
+        s.tooltip = label;
+        s.tooltipFont = font;
+        s.tooltipFontSize = fontSize;
+        s.tooltipPosition = position;
+        s.tooltipPadding = padding;
+        s.tooltipFgColor = fgcolor;
+        return resolve(s);
+    }
+
+    // Screen area, signed as a LEFT or UP tooltip can start before the panel edge. Empty if x0 == x1
+    struct Rect_s
+    {
+        int32_t x0;
+        int32_t y0;
+        int32_t x1;
+        int32_t y1;
+    };
+
+    // Areas a widget draws to: the button, its tooltip and its value
+    constexpr uint8_t AREAS = 3;
+
+    /**
+     * @brief Bounding box of one of the areas of a widget, mirroring ButtonWidget::tooltipPosition and TFT::drawValue
+     *
+     * Tooltip widths depend on the glyph widths, so they are bounded with the widest glyph of the font.
+     */
+    constexpr Rect_s area(const ButtonWidget::Spec &s, uint8_t which)
+    {
+        if (which == 0)
+        {
+            return Rect_s{s.startx, s.starty, s.endx, s.endy};
+        }
+        if (s.tooltip == nullptr)
+        {
+            return Rect_s{0, 0, 0, 0};
+        }
+        int32_t width = fontWidth(s.tooltipFont) * s.tooltipFontSize * textLength(s.tooltip);
+        int32_t height = fontHeight(s.tooltipFont) * s.tooltipFontSize;
+        int32_t x = 0;
+        int32_t y = 0;
+        switch (s.tooltipPosition)
+        {
+        case ButtonWidget::TooltipPositions::RIGHT:
+            x = s.endx + s.tooltipPadding;
+            y = s.starty + (s.sizey - height) / 2;
+            break;
+        case ButtonWidget::TooltipPositions::LEFT:
+            x = (int32_t)s.startx - width - s.tooltipPadding;
+            y = s.starty + (s.sizey - height) / 2;
+            break;
+        case ButtonWidget::TooltipPositions::UP:
+            // Centered on the button, at most as wide as the bound on either side
+            x = s.startx + (s.sizex - width) / 2;
+            y = s.starty - s.tooltipPadding;
+            break;
+        case ButtonWidget::TooltipPositions::DOWN:
+            x = s.startx + (s.sizex - width) / 2;
+            y = s.endy + s.tooltipPadding;
+            break;
+        }
+        if (which == 1)
+        {
+            return Rect_s{x, y, x + width, y + height};
+        }
+        if (s.channel == NONE)
+        {
+            return Rect_s{0, 0, 0, 0};
+        }
+        // The value is printed from the tooltip start, one line below
+        return Rect_s{x, y + height, x + VALUE_WIDTH, y + 2 * height};
+    }
+
+    constexpr bool empty(const Rect_s &r)
+    {
+        return r.x0 == r.x1;
+    }
+
+    constexpr bool overlaps(const Rect_s &a, const Rect_s &b)
+    {
+        return !empty(a) && !empty(b) && a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1;
+    }
+
+    // Checks that every area of every widget of a table lies inside the panel
+    template <size_t N>
+    constexpr bool onScreen(const ButtonWidget::Spec (&table)[N])
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            for (uint8_t a = 0; a < AREAS; a++)
+            {
+                Rect_s r = area(table[i], a);
+                if (!empty(r) && (r.x0 < 0 || r.y0 < 0 || r.x1 > SCREEN_WIDTH || r.y1 > SCREEN_HEIGHT))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Checks that no two areas of a table (buttons, tooltips, values) share a pixel
+    template <size_t N>
+    constexpr bool disjoint(const ButtonWidget::Spec (&table)[N])
+    {
+        for (size_t i = 0; i < N * AREAS; i++)
+        {
+            for (size_t j = i + 1; j < N * AREAS; j++)
+            {
+                if (overlaps(area(table[i / AREAS], i % AREAS), area(table[j / AREAS], j % AREAS)))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Checks that no area of a table reaches into the progress bar strip
+    template <size_t N>
+    constexpr bool clearOfProgress(const ButtonWidget::Spec (&table)[N])
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            for (uint8_t a = 0; a < AREAS; a++)
+            {
+                Rect_s r = area(table[i], a);
+                if (!empty(r) && r.y1 > PROGRESS_Y)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Returns the id of the widget containing the touch, or NONE (same bounds as ButtonWidget::isPressed)
+    uint8_t hitTest(const ButtonWidget::Spec *table, size_t count, uint16_t x, uint16_t y)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (x > table[i].startx && x < table[i].endx && y > table[i].starty && y < table[i].endy)
+            {
+                return table[i].id;
+            }
+        }
+        return NONE;
+    }
+
+    // IDLE screen (homepage)
+    constexpr uint16_t IDLE_BACKGROUND = TFT_WHITE;
+    constexpr ButtonWidget::Spec IDLE[] = {
+        icon(IDLE_CONFIG, 200, 350, 63, 63, ButtonWidget::ButtonStyles::ELLIPSE, TFT_CYAN, TFT_BLACK, ICONS_63X63::cog),
+        bind(tooltip(icon(IDLE_TEMP1, 20, 0, 63, 63, ButtonWidget::ButtonStyles::ROUND_RECT, TFT_WHITE, TFT_RED, ICONS_63X63::thermometer),
+                     "Temp1", 2, 1, ButtonWidget::TooltipPositions::RIGHT, 63 / 4, TFT_PURPLE),
+             Greenhouse::TEMP1),
+        bind(tooltip(icon(IDLE_TEMP2, 20, 70, 63, 63, ButtonWidget::ButtonStyles::ROUND_RECT, TFT_WHITE, TFT_RED, ICONS_63X63::thermometer),
+                     "Temp2", 2, 1, ButtonWidget::TooltipPositions::RIGHT, 63 / 4, TFT_PURPLE),
+             Greenhouse::TEMP2),
+        bind(tooltip(icon(IDLE_TEMP3, 20, 135, 63, 63, ButtonWidget::ButtonStyles::ROUND_RECT, TFT_WHITE, TFT_RED, ICONS_63X63::thermometer),
+                     "Temp3", 2, 1, ButtonWidget::TooltipPositions::RIGHT, 63 / 4, TFT_PURPLE),
+             Greenhouse::TEMP3),
+        bind(tooltip(icon(IDLE_HUM1, 170, 0, 63, 63, ButtonWidget::ButtonStyles::ROUND_RECT, TFT_WHITE, TFT_BLUE, ICONS_63X63::humidity),
+                     "Hum1", 2, 1, ButtonWidget::TooltipPositions::RIGHT, 63 / 4, TFT_PURPLE),
+             Greenhouse::HUM1),
+        bind(tooltip(icon(IDLE_HUM2, 170, 70, 63, 63, ButtonWidget::ButtonStyles::ROUND_RECT, TFT_WHITE, TFT_BLUE, ICONS_63X63::humidity),
+                     "Hum2", 2, 1, ButtonWidget::TooltipPositions::RIGHT, 63 / 4, TFT_PURPLE),
+             Greenhouse::HUM2),
+        bind(tooltip(icon(IDLE_HUM3, 170, 135, 63, 63, ButtonWidget::ButtonStyles::ROUND_RECT, TFT_WHITE, TFT_BLUE, ICONS_63X63::humidity),
+                     "Hum3", 2, 1, ButtonWidget::TooltipPositions::RIGHT, 63 / 4, TFT_PURPLE),
+             Greenhouse::HUM3),
+    };
+    static_assert(onScreen(IDLE), "IDLE layout: widget outside of the screen");
+    static_assert(disjoint(IDLE), "IDLE layout: overlapping widgets");
+    static_assert(clearOfProgress(IDLE), "IDLE layout: widget over the progress bar");
+
+    // CONFIG screen
+    constexpr uint16_t CONFIG_BACKGROUND = TFT_BLACK;
+    constexpr ButtonWidget::Spec CONFIG[] = {
+        text(CONFIG_BACK, 200, 350, 100, 100, ButtonWidget::ButtonStyles::ROUND_RECT, TFT_PURPLE, TFT_WHITE, "Back", 2, 1, 15),
+        text(CONFIG_SPINBOX, 100, 350, 100, 100, ButtonWidget::ButtonStyles::RECT, TFT_WHITE, TFT_BLACK, "Spinbox", 2, 1),
+    };
+    static_assert(onScreen(CONFIG), "CONFIG layout: widget outside of the screen");
+    static_assert(disjoint(CONFIG), "CONFIG layout: overlapping widgets");
+    static_assert(clearOfProgress(CONFIG), "CONFIG layout: widget over the progress bar");
+};
+
+#endif
@@ -0,0 +1,312 @@
+/**
+ * @file ota.h
+ * @author Riccardo Iacob
+ * @brief Resumable firmware update written chunk by chunk into the inactive app partition
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * The image arrives in CHUNK sized pieces, in order, each with its CRC-32. Chunks go straight to flash,
+ * a sector is erased when its first chunk arrives. Progress is persisted in META_FILE at every sector
+ * boundary, so an interrupted transfer of the same image (same size and SHA-256) resumes from the last
+ * persisted chunk instead of starting over. Once the last chunk is in, the partition is read back and
+ * hashed a sector per tick, and only a matching image is made the boot partition.
+ */
+#ifndef OTA_H
+#define OTA_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp32/rom/crc.h>
+#include <mbedtls/sha256.h>
+#include "debug.h"
+#include "clock.h"
+#include "tfthelper.h"
+
+namespace Ota
+{
+    const char *META_FILE = "/ota.meta";
+    const uint16_t CHUNK = 256;
+    const uint16_t SECTOR = 4096;
+    const uint16_t CHUNKS_PER_SECTOR = SECTOR / CHUNK;
+
+    enum States : uint8_t
+    {
+        IDLE,
+        RECEIVING,
+        VERIFYING,
+        READY,
+        FAILED
+    };
+
+    enum Status : uint8_t
+    {
+        STATUS_OK,
+        STATUS_NOT_ACTIVE,
+        STATUS_OUT_OF_ORDER,
+        STATUS_BAD_CRC,
+        STATUS_BAD_LENGTH,
+        STATUS_TOO_LARGE,
+        STATUS_FLASH_ERROR,
+        STATUS_BAD_HASH
+    };
+
+    // Transfer in progress, persisted in META_FILE
+    struct Meta_s
+    {
+        uint32_t size;
+        uint8_t sha256[32];
+        // Flash address of the target partition, a transfer doesn't resume on the other one
+        uint32_t address;
+        // Chunks durably written
+        uint32_t confirmed;
+    };
+
+    Meta_s meta;
+    States state = IDLE;
+    const esp_partition_t *partition = nullptr;
+    // Chunks written, ahead of meta.confirmed until the next sector boundary
+    uint32_t received = 0;
+    uint32_t verified = 0;
+    mbedtls_sha256_context sha;
+    uint8_t buffer[SECTOR];
+    uint32_t startMs = 0;
+    // Reason of the last failure
+    uint8_t error = STATUS_OK;
+
+    void confirmImage();
+    void doSetup();
+    void doTick();
+    uint32_t begin(uint32_t size, const uint8_t *sha256, uint8_t &status);
+    uint8_t write(uint32_t index, uint32_t crc, const uint8_t *data, uint16_t length);
+    uint8_t finish();
+    uint32_t nextDeadline();
+
+    uint32_t chunkCount()
+    {
+        return (meta.size + CHUNK - 1) / CHUNK;
+    }
+
+    // progress of the transfer and then of the verification, in permille
+    int16_t progress()
+    {
+        if (meta.size == 0)
+        {
+            return 0;
+        }
+        if (state == VERIFYING)
+        {
+            return (uint64_t)verified * 1000 / meta.size;
+        }
+        return (uint64_t)received * 1000 / chunkCount();
+    }
+
+    void saveMeta()
+    {
+        File file = LittleFS.open(META_FILE, FILE_WRITE);
+        file.write((const uint8_t *)&meta, sizeof(meta));
+        file.close();
+    }
+
+    void fail(uint8_t status, const char *reason)
+    {
+        state = FAILED;
+        error = status;
+        // A retry of the same image starts over
+        LittleFS.remove(META_FILE);
+        memset(&meta, 0, sizeof(meta));
+        TFT::setProgress(TFT::PROGRESS_HIDDEN);
+        debug("[ota.h] update failed: ");
+        debugln(reason);
+    }
+
+    // Marks the running image as working, cancels the rollback if it was just installed and the bootloader is watching it
+    void confirmImage()
+    {
+        esp_ota_mark_app_valid_cancel_rollback();
+    }
+
+    // Loads an interrupted transfer, LittleFS must be mounted
+    void doSetup()
+    {
+        partition = esp_ota_get_next_update_partition(nullptr);
+        memset(&meta, 0, sizeof(meta));
+        if (!LittleFS.exists(META_FILE))
+        {
+            return;
+        }
+        File file = LittleFS.open(META_FILE, FILE_READ);
+        if (file.read((uint8_t *)&meta, sizeof(meta)) != sizeof(meta) || partition == nullptr ||
+            meta.address != partition->address || meta.size > partition->size)
+        {
+            memset(&meta, 0, sizeof(meta));
+        }
+        file.close();
+        if (meta.size > 0)
+        {
+            debug("[ota.h] interrupted update found at chunk ");
+            debug(meta.confirmed);
+            debug("/");
+            debugln(chunkCount());
+        }
+    }
+
+    /**
+     * @brief Starts a transfer, or resumes the interrupted one if it is for the same image
+     *
+     * @param size: Image size in bytes
+     * @param sha256: Image hash
+     * @param status: STATUS_OK or the reason the transfer can't start
+     * @return uint32_t: Index of the first chunk to send
+     */
+    uint32_t begin(uint32_t size, const uint8_t *sha256, uint8_t &status)
+    {
+        if (partition == nullptr || size == 0 || size > partition->size)
+        {
+            status = STATUS_TOO_LARGE;
+            return 0;
+        }
+        status = STATUS_OK;
+        if (meta.size != size || memcmp(meta.sha256, sha256, sizeof(meta.sha256)) != 0)
+        {
+            meta.size = size;
+            memcpy(meta.sha256, sha256, sizeof(meta.sha256));
+            meta.address = partition->address;
+            meta.confirmed = 0;
+            saveMeta();
+        }
+        received = meta.confirmed;
+        state = RECEIVING;
+        error = STATUS_OK;
+        startMs = Clock::now();
+        TFT::setProgress(progress());
+        debug("[ota.h] receiving ");
+        debug(size);
+        debug(" bytes from chunk ");
+        debugln(received);
+        return received;
+    }
+
+    /**
+     * @brief Writes the next chunk to flash
+     *
+     * @param length: CHUNK, except for the last chunk of the image
+     */
+    uint8_t write(uint32_t index, uint32_t crc, const uint8_t *data, uint16_t length)
+    {
+        if (state != RECEIVING)
+        {
+            return STATUS_NOT_ACTIVE;
+        }
+        // Past the last chunk, nothing is erased or written beyond the image
+        if (index != received || index >= chunkCount())
+        {
+            return STATUS_OUT_OF_ORDER;
+        }
+        uint32_t offset = index * CHUNK;
+        if (length != (meta.size - offset < CHUNK ? meta.size - offset : CHUNK))
+        {
+            return STATUS_BAD_LENGTH;
+        }
+        if (crc32_le(0, data, length) != crc)
+        {
+            return STATUS_BAD_CRC;
+        }
+        if (offset % SECTOR == 0 && esp_partition_erase_range(partition, offset, SECTOR) != ESP_OK)
+        {
+            fail(STATUS_FLASH_ERROR, "erase");
+            return STATUS_FLASH_ERROR;
+        }
+        if (esp_partition_write(partition, offset, data, length) != ESP_OK)
+        {
+            fail(STATUS_FLASH_ERROR, "write");
+            return STATUS_FLASH_ERROR;
+        }
+        received++;
+        // Persisted at sector boundaries only, a resumed transfer erases the sector again anyway
+        if (received % CHUNKS_PER_SECTOR == 0 || received == chunkCount())
+        {
+            meta.confirmed = received;
+            saveMeta();
+        }
+        TFT::setProgress(progress());
+        return STATUS_OK;
+    }
+
+    // Starts verifying the image once every chunk is written
+    uint8_t finish()
+    {
+        if (state != RECEIVING)
+        {
+            return STATUS_NOT_ACTIVE;
+        }
+        if (received != chunkCount())
+        {
+            return STATUS_OUT_OF_ORDER;
+        }
+        mbedtls_sha256_init(&sha);
+        mbedtls_sha256_starts(&sha, 0);
+        verified = 0;
+        state = VERIFYING;
+        debug("[ota.h] image received in ");
+        debug(Clock::now() - startMs);
+        debugln(" ms, verifying");
+        return STATUS_OK;
+    }
+
+    // hashes one sector of the written image per call, so the UI and radio keep running
+    void doTick()
+    {
+        if (state != VERIFYING)
+        {
+            return;
+        }
+        uint32_t length = meta.size - verified < SECTOR ? meta.size - verified : SECTOR;
+        if (esp_partition_read(partition, verified, buffer, length) != ESP_OK)
+        {
+            mbedtls_sha256_free(&sha);
+            fail(STATUS_FLASH_ERROR, "read back");
+            return;
+        }
+        mbedtls_sha256_update(&sha, buffer, length);
+        verified += length;
+        TFT::setProgress(progress());
+        if (verified < meta.size)
+        {
+            return;
+        }
+        uint8_t digest[32];
+        mbedtls_sha256_finish(&sha, digest);
+        mbedtls_sha256_free(&sha);
+        if (memcmp(digest, meta.sha256, sizeof(digest)) != 0)
+        {
+            fail(STATUS_BAD_HASH, "hash mismatch");
+            return;
+        }
+        // Also checks the image header and its own checksum
+        if (esp_ota_set_boot_partition(partition) != ESP_OK)
+        {
+            fail(STATUS_BAD_HASH, "invalid image");
+            return;
+        }
+        LittleFS.remove(META_FILE);
+        memset(&meta, 0, sizeof(meta));
+        state = READY;
+        debugln("[ota.h] update ready, boots on the next restart");
+    }
+
+    // verification runs every tick
+    uint32_t nextDeadline()
+    {
+        if (state == VERIFYING)
+        {
+            return Clock::now();
+        }
+        return Clock::now() + 0x7FFFFFFF;
+    }
+};
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * @file power.h
+ * @author Riccardo Iacob
+ * @brief Tickless scheduling: light sleep until the next module deadline or an external event
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include "debug.h"
+#include "globals.h"
+#include "clock.h"
+#include "tfthelper.h"
+#include "radiohelper.h"
+#include "trace.h"
+#include "replay.h"
+#include "seriallink.h"
+#include "ota.h"
+
+namespace Power
+{
+    // Shorter idle periods are not worth the sleep entry and exit cost
+    const uint32_t MIN_SLEEP_MS = 3;
+    // Interval between statistics reports
+    const uint32_t STATS_INTERVAL = 60000;
+
+    // Light sleep between deadlines (disable to keep the loop spinning)
+    bool enabled = true;
+    // The touch line stays low for as long as the finger is down
+    bool touchHeld = false;
+
+    // Statistics since the last report
+    uint32_t statsStartUs = 0;
+    uint64_t sleptUs = 0;
+    uint32_t sleeps = 0;
+    uint32_t timerWakes = 0;
+    uint32_t gpioWakes = 0;
+    // How late timer wakeups were compared to the requested deadline
+    uint32_t maxLatencyUs = 0;
+    uint64_t totalLatencyUs = 0;
+
+    void doSetup();
+    void doTick();
+    uint32_t nextDeadline();
+
+    void doSetup()
+    {
+        // Keep the RTC 8MHz clock on so the backlight PWM survives light sleep
+        esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, ESP_PD_OPTION_ON);
+        // A host opening a session wakes us up, the first frame is lost and retried by the host
+        uart_set_wakeup_threshold(UART_NUM_0, 3);
+        pinMode(Globals::radioGdo0Pin, INPUT);
+        statsStartUs = micros();
+        debugln("[power.h] setup completed");
+    }
+
+    // earliest deadline across modules
+    uint32_t nextDeadline()
+    {
+        uint32_t now = Clock::now();
+        uint32_t deadlines[] = {TFT::nextDeadline(), Radio::nextDeadline(), Trace::nextDeadline(),
+                                SerialLink::nextDeadline(), Ota::nextDeadline()};
+        uint32_t next = deadlines[0];
+        for (uint32_t deadline : deadlines)
+        {
+            if ((int32_t)(deadline - next) < 0)
+            {
+                next = deadline;
+            }
+        }
+        // Overdue deadlines are due now
+        if ((int32_t)(next - now) < 0)
+        {
+            return now;
+        }
+        return next;
+    }
+
+    void report()
+    {
+        uint32_t elapsedUs = micros() - statsStartUs;
+        debug("[power.h] sleep residency: ");
+        debug(elapsedUs > 0 ? (uint32_t)(sleptUs * 100 / elapsedUs) : 0);
+        debug("%, sleeps: ");
+        debug(sleeps);
+        debug(" (timer ");
+        debug(timerWakes);
+        debug(", gpio ");
+        debug(gpioWakes);
+        debug("), avg/max wake latency us: ");
+        debug(timerWakes > 0 ? (uint32_t)(totalLatencyUs / timerWakes) : 0);
+        debug("/");
+        debugln(maxLatencyUs);
+        statsStartUs = micros();
+        sleptUs = 0;
+        sleeps = 0;
+        timerWakes = 0;
+        gpioWakes = 0;
+        maxLatencyUs = 0;
+        totalLatencyUs = 0;
+    }
+
+    // Sleeps until the next deadline, or until touch, radio or serial activity
+    void sleepFor(uint32_t ms)
+    {
+        gpio_num_t touch = (gpio_num_t)Globals::touchIrqPin;
+        gpio_num_t radio = (gpio_num_t)Globals::radioGdo0Pin;
+        // Wakeups are level triggered: while a press is held (reported by the ISR or an earlier wake),
+        // wait for the release instead
+        touchHeld = digitalRead(Globals::touchIrqPin) == LOW;
+        // Touch is active low, GDO0 goes high on a received packet
+        gpio_wakeup_enable(touch, touchHeld ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+        gpio_wakeup_enable(radio, GPIO_INTR_HIGH_LEVEL);
+        esp_sleep_enable_gpio_wakeup();
+        esp_sleep_enable_uart_wakeup(UART_NUM_0);
+        esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+        // Let pending serial output go out before the UART clock stops
+        Serial.flush();
+
+        uint32_t startUs = micros();
+        esp_light_sleep_start();
+        uint32_t sleptForUs = micros() - startUs;
+
+        // Level wakeups replace the edge interrupt of the touch pin, restore it
+        gpio_wakeup_disable(touch);
+        gpio_wakeup_disable(radio);
+        gpio_set_intr_type(touch, GPIO_INTR_ANYEDGE);
+
+        sleeps++;
+        sleptUs += sleptForUs;
+        if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER)
+        {
+            timerWakes++;
+            uint32_t requestedUs = ms * 1000;
+            uint32_t latencyUs = sleptForUs > requestedUs ? sleptForUs - requestedUs : 0;
+            totalLatencyUs += latencyUs;
+            if (latencyUs > maxLatencyUs)
+            {
+                maxLatencyUs = latencyUs;
+            }
+        }
+        else
+        {
+            gpioWakes++;
+            // The edge that woke us may not have reached the ISR, report the start of a press once
+            if (!touchHeld && digitalRead(Globals::touchIrqPin) == LOW)
+            {
+                TFT::touchPressed = true;
+            }
+        }
+    }
+
+    // call at the end of loop(), sleeps while no module has work to do
+    void doTick()
+    {
+        if (micros() - statsStartUs >= STATS_INTERVAL * 1000)
+        {
+            report();
+        }
+        // Replays run as fast as possible on the virtual clock
+        if (!enabled || Replay::active || Clock::isVirtual)
+        {
+            return;
+        }
+        uint32_t now = Clock::now();
+        uint32_t idleMs = nextDeadline() - now;
+        if (idleMs < MIN_SLEEP_MS)
+        {
+            return;
+        }
+        sleepFor(idleMs);
+    }
+};
+
+#endif
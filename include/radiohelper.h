@@ -15,6 +15,13 @@
 #include "debug.h"
 #include "globals.h"
 #include "tfthelper.h"
+#include "alarms.h"
+#include "rules.h"
+#include "sensors.h"
+#include "clock.h"
+#include "trace.h"
+#include "history.h"
+#include "timesync.h"
 
 namespace Radio
 {
@@ -22,31 +29,90 @@ namespace Radio
     long last_ms = millis();
     // If the config was modified by the user
     bool configModified = false;
+    // Poll the greenhouse periodically (disabled while frames come from a replay)
+    bool polling = true;
+    // Frames handled since boot
+    uint32_t frames = 0;
+    // Frames between clock model reports
+    const uint32_t SYNC_REPORT_FRAMES = 60;
 
     void doSetup();
     void doTick();
+    void handleFrame(const int16_t *frame, uint32_t sampledMs, uint16_t errorMs);
+    uint32_t nextDeadline();
 
     void doSetup()
     {
+        Rules::compile(Rules::defaultSource);
+        // Nothing received yet
+        Sensors::checkStale(Clock::now(), Greenhouse::data);
+        // Poll right away instead of waiting a full period after boot
+        last_ms = Clock::now() - Globals::pollDelay;
     }
 
     void IRAM_ATTR handleISR() {}
+
+    /**
+     * @brief Processes a raw frame received from the greenhouse
+     *
+     * @param sampledMs: Acquisition time of the readings on the master clock
+     * @param errorMs: Bound of the error of sampledMs
+     */
+    void handleFrame(const int16_t *frame, uint32_t sampledMs, uint16_t errorMs)
+    {
+        uint32_t ms = Clock::now();
+        Trace::recordFrame(frame);
+        Sensors::ingest(frame, ms, Greenhouse::data);
+        TimeSync::stamp(sampledMs, errorMs, Greenhouse::data);
+        Alarms::feedAll(Greenhouse::data, ms);
+        // Run the climate rules inline, actuator changes are posted with the config
+        if (Rules::run(Greenhouse::data, Greenhouse::config, ms))
+        {
+            configModified = true;
+        }
+        History::append(Greenhouse::data, Greenhouse::data.time);
+        TFT::newData = true;
+        frames++;
+    }
+
     // tick function requests data from greenhouse and posts config data to greenhouse
     void doTick()
     {
-        if (millis() - last_ms >= Globals::pollDelay)
+        if (polling && Clock::now() - last_ms >= Globals::pollDelay)
         {
             debugln("[radiohelper.h] polling for new data");
+            // The poll is the time beacon, the reply carries the slave timing
+            uint32_t beacon = Clock::now();
             // debug only, generate fake values
-            Greenhouse::loadDummyData();
-            TFT::newData = true;
-            last_ms= millis();
+            int16_t frame[Greenhouse::CHANNEL_COUNT];
+            Greenhouse::Stamp_s stamp;
+            Greenhouse::loadDummyData(frame);
+            Greenhouse::loadDummyStamp(stamp, beacon);
+            TimeSync::exchange(stamp, Clock::now());
+            uint16_t errorMs;
+            uint32_t sampledMs = TimeSync::toMaster(stamp.slave, stamp.sampled, errorMs);
+            handleFrame(frame, sampledMs, errorMs);
+            if (frames % SYNC_REPORT_FRAMES == 0)
+            {
+                TimeSync::report();
+            }
+            last_ms = Clock::now();
         }
         if (configModified)
         {
             configModified = false;
         }
     }
+
+    // time of the next poll
+    uint32_t nextDeadline()
+    {
+        if (!polling)
+        {
+            return Clock::now() + 0x7FFFFFFF;
+        }
+        return last_ms + Globals::pollDelay;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,162 @@
+/**
+ * @file replay.h
+ * @author Riccardo Iacob
+ * @brief Replays a recorded trace (see trace.h) into the modules under a virtual clock
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "debug.h"
+#include "clock.h"
+#include "trace.h"
+#include "tfthelper.h"
+#include "radiohelper.h"
+
+// Replay TRACE_FILE instead of talking to the greenhouse
+#define TRACE_REPLAY false
+
+namespace Replay
+{
+    bool active = false;
+    File file;
+    Trace::Reader reader;
+    // Next record, held back while a module deadline comes first
+    Trace::Record_s pending;
+    bool hasPending = false;
+    // Loop iteration times, measured in real time
+    uint32_t loops = 0;
+    uint32_t lastUs = 0;
+    uint32_t maxLoopUs = 0;
+    uint64_t totalLoopUs = 0;
+
+    bool begin(const char *path);
+    uint32_t nextDeadline();
+    void apply(const Trace::Record_s &record);
+    void doTick();
+    void end();
+
+    // Opens a trace and switches the modules to its virtual clock
+    bool begin(const char *path)
+    {
+        if (!LittleFS.begin(true))
+        {
+            debugln("[replay.h] LittleFS mount failed");
+            return false;
+        }
+        file = LittleFS.open(path, FILE_READ);
+        if (!file || !reader.begin(file))
+        {
+            debugln("[replay.h] invalid trace file");
+            return false;
+        }
+        Clock::setVirtual(reader.ms);
+        Trace::paused = true;
+        Radio::polling = false;
+        active = true;
+        hasPending = false;
+        loops = 0;
+        maxLoopUs = 0;
+        totalLoopUs = 0;
+        lastUs = micros();
+        debugln("[replay.h] replay started");
+        return true;
+    }
+
+    // Prints the loop statistics and goes back to the real clock
+    void end()
+    {
+        file.close();
+        active = false;
+        Clock::isVirtual = false;
+        Trace::paused = false;
+        Radio::polling = true;
+        debug("[replay.h] replay completed, loops: ");
+        debug(loops);
+        debug(", avg loop us: ");
+        debug(loops > 0 ? (uint32_t)(totalLoopUs / loops) : 0);
+        debug(", max loop us: ");
+        debugln(maxLoopUs);
+    }
+
+    // Earliest deadline of the modules a replay drives, Trace is paused (power.h includes this file)
+    uint32_t nextDeadline()
+    {
+        uint32_t tft = TFT::nextDeadline();
+        uint32_t radio = Radio::nextDeadline();
+        return (int32_t)(radio - tft) < 0 ? radio : tft;
+    }
+
+    // Feeds a record to the module it was recorded from
+    void apply(const Trace::Record_s &record)
+    {
+        switch (record.type)
+        {
+        case Trace::RECORD_FRAME:
+            // Traces hold reception times only, the replay clock is the timeline
+            Radio::handleFrame(record.frame, Clock::now(), 0);
+            break;
+        case Trace::RECORD_TOUCH:
+            TFT::injectTouch(record.x, record.y);
+            break;
+        default:
+            break;
+        }
+    }
+
+    /**
+     * @brief Moves the virtual clock as a live loop waking from sleep would: it stays while the modules
+     * have work due, goes to the next module deadline if that comes before the next record, else to the
+     * record, which is applied together with the others recorded at the same time
+     */
+    void doTick()
+    {
+        if (!active)
+        {
+            return;
+        }
+        uint32_t us = micros();
+        uint32_t loopUs = us - lastUs;
+        lastUs = us;
+        if (loops > 0)
+        {
+            totalLoopUs += loopUs;
+            if (loopUs > maxLoopUs)
+            {
+                maxLoopUs = loopUs;
+            }
+        }
+        loops++;
+        uint32_t deadline = nextDeadline();
+        // Work due now is done by the modules in this loop, as a live loop would without sleeping
+        if ((int32_t)(deadline - Clock::virtualMs) <= 0)
+        {
+            return;
+        }
+        if (!hasPending && !reader.next(pending))
+        {
+            end();
+            return;
+        }
+        hasPending = true;
+        if ((int32_t)(deadline - pending.ms) < 0)
+        {
+            Clock::virtualMs = deadline;
+            return;
+        }
+        Clock::virtualMs = pending.ms;
+        do
+        {
+            apply(pending);
+            hasPending = reader.next(pending);
+        } while (hasPending && pending.ms == Clock::virtualMs);
+    }
+};
+
+#endif
@@ -12,31 +12,148 @@
 #define RTCHELPER_H
 
 #include <Arduino.h>
+#include <Wire.h>
+#include "debug.h"
+#include "globals.h"
+#include "clock.h"
 
 namespace RTC
 {
+    const uint8_t ADDRESS = 0x68;
+    // The DS3231 is good to 2 ppm, the ESP32 crystal to about 50 ppm
+    const uint32_t RESYNC_INTERVAL = 3600000;
+    // Worst drift of the master clock from the DS3231, both crystals
+    const uint32_t DRIFT_PPM = 50 + 2;
+    // Timeline error doTick tolerates before re-anchoring
+    const uint32_t MAX_ERROR_MS = 1000;
+
     tm currentDateTime;
     String currentTimeString;
     String currentDateString;
+    bool present = false;
+    // Master timeline anchor: epoch ms at Clock::now() == syncMs
+    uint64_t syncEpochMs = 0;
+    uint32_t syncMs = 0;
+    uint32_t lastResyncMs = 0;
 
     void doSetup();
     void doTick();
     void readTime();
+    uint64_t epochMs(uint32_t ms);
+    uint32_t driftBoundMs(uint32_t ms);
+
+    uint8_t fromBCD(uint8_t value)
+    {
+        return (value >> 4) * 10 + (value & 0x0F);
+    }
+
+    // Reads date and time from the DS3231 (24h mode)
+    bool read(tm &out)
+    {
+        Wire.beginTransmission(ADDRESS);
+        Wire.write((uint8_t)0);
+        if (Wire.endTransmission() != 0 || Wire.requestFrom(ADDRESS, (uint8_t)7) != 7)
+        {
+            return false;
+        }
+        out.tm_sec = fromBCD(Wire.read() & 0x7F);
+        out.tm_min = fromBCD(Wire.read());
+        out.tm_hour = fromBCD(Wire.read() & 0x3F);
+        out.tm_wday = Wire.read() - 1;
+        out.tm_mday = fromBCD(Wire.read());
+        uint8_t month = Wire.read();
+        out.tm_mon = fromBCD(month & 0x1F) - 1;
+        out.tm_year = fromBCD(Wire.read()) + (month & 0x80 ? 200 : 100);
+        return true;
+    }
 
+    // Seconds since 1970-01-01 of a UTC date, no time zone involved unlike mktime()
+    uint32_t toEpoch(const tm &t)
+    {
+        int32_t year = t.tm_year + 1900 - (t.tm_mon < 2);
+        int32_t era = year / 400;
+        int32_t yoe = year - era * 400;
+        int32_t doy = (153 * (t.tm_mon + (t.tm_mon < 2 ? 10 : -2)) + 2) / 5 + t.tm_mday - 1;
+        int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        int32_t days = era * 146097 + doe - 719468;
+        return (uint32_t)days * 86400 + t.tm_hour * 3600 + t.tm_min * 60 + t.tm_sec;
+    }
+
+    // Anchors the master timeline to the DS3231, without one the timeline starts at 0 on boot
     void doSetup()
     {
-        // initialize ds3231
-        // read data
+        Wire.begin(Globals::i2cSdaPin, Globals::i2cSclPin);
+        tm now;
+        present = read(now);
+        syncMs = Clock::now();
+        lastResyncMs = syncMs;
+        if (!present)
+        {
+            debugln("[rtchelper.h] DS3231 not found, timestamps are relative to boot");
+            return;
+        }
+        // The fraction of the current second is unknown, assume the middle
+        syncEpochMs = (uint64_t)toEpoch(now) * 1000 + 500;
+        readTime();
+        debug("[rtchelper.h] time: ");
+        debug(currentDateString);
+        debug(" ");
+        debugln(currentTimeString);
     }
 
-    // Update time from NTP servers?
+    // keeps the master timeline within a second of the DS3231
     void doTick()
     {
+        if (!present || Clock::now() - lastResyncMs < RESYNC_INTERVAL)
+        {
+            return;
+        }
+        lastResyncMs = Clock::now();
+        tm now;
+        if (!read(now))
+        {
+            return;
+        }
+        int64_t rtcMs = (int64_t)toEpoch(now) * 1000 + 500;
+        int64_t error = rtcMs - (int64_t)epochMs(Clock::now());
+        // Within the DS3231 resolution, re-anchoring would only add jitter
+        if (error > (int64_t)MAX_ERROR_MS || error < -(int64_t)MAX_ERROR_MS)
+        {
+            syncEpochMs = rtcMs;
+            syncMs = Clock::now();
+            debug("[rtchelper.h] timeline corrected by ");
+            debug((int32_t)error);
+            debugln(" ms");
+        }
+    }
+
+    // Epoch ms of a Clock::now() value
+    uint64_t epochMs(uint32_t ms)
+    {
+        return syncEpochMs + (int32_t)(ms - syncMs);
+    }
+
+    /**
+     * @brief Bound of how far the master clock has drifted from the DS3231 at a Clock::now() value
+     *
+     * Grows with the time since the anchor, and stays within MAX_ERROR_MS plus the drift since the last
+     * check of doTick. 0 without a DS3231, the timeline is then the master clock itself.
+     */
+    uint32_t driftBoundMs(uint32_t ms)
+    {
+        if (!present)
+        {
+            return 0;
+        }
+        uint32_t sinceSync = (uint32_t)abs((int32_t)(ms - syncMs)) / 1000 * DRIFT_PPM / 1000;
+        uint32_t sinceCheck = MAX_ERROR_MS + (uint32_t)abs((int32_t)(ms - lastResyncMs)) / 1000 * DRIFT_PPM / 1000;
+        return sinceSync < sinceCheck ? sinceSync : sinceCheck;
     }
 
     void readTime()
     {
-        // read data from ds3231
+        time_t seconds = epochMs(Clock::now()) / 1000;
+        gmtime_r(&seconds, &currentDateTime);
         // prepare formatted date and time strings
         currentTimeString = "";
         currentDateString = "";
@@ -58,18 +175,19 @@ namespace RTC
             currentTimeString.concat("0");
         }
         currentTimeString.concat(currentDateTime.tm_sec);
-        // date dd:mm:yyyy
+        // date dd/mm/yyyy, tm_mon counts from 0
         if (currentDateTime.tm_mday < 10)
         {
             currentDateString.concat("0");
         }
         currentDateString.concat(currentDateTime.tm_mday);
         currentDateString.concat("/");
-        if (currentDateTime.tm_mon < 10)
+        int month = currentDateTime.tm_mon + 1;
+        if (month < 10)
         {
             currentDateString.concat("0");
         }
-        currentDateString.concat(currentDateTime.tm_mon);
+        currentDateString.concat(month);
         currentDateString.concat("/");
         currentDateString.concat(currentDateTime.tm_year + 1900);
     }
@@ -0,0 +1,652 @@
+/**
+ * @file rules.h
+ * @author Riccardo Iacob
+ * @brief Climate control rules, compiled to bytecode at config time and evaluated on every reading
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Rules are separated by ';' or new lines:
+ *   if hum2 > 85 for 2 min then vent=open
+ *   if temp1 >= 30 and hum1 < 60 then fan=100, mister=on
+ *   pid fan = temp1 to 26 kp 20 ki 0.5 kd 0
+ * Channels are temp1..temp3 and hum1..hum3, comparisons are > < >= <=, conditions are combined
+ * left to right with and/or, durations are in s, min or h. Outputs are vent, fan and mister and
+ * take open/close/on/off or a level from 0 to 100. PID outputs grow when the channel is above
+ * the setpoint, use a negative kp for the opposite.
+ *
+ * Only trusted readings drive actuators: a comparison on a channel whose quality is not
+ * QUALITY_OK (stale or out of range, see sensors.h) is false, and a PID block on such a channel
+ * holds its output until the reading recovers.
+ */
+#ifndef RULES_H
+#define RULES_H
+
+#include <Arduino.h>
+#include "debug.h"
+#include "greenhouse.h"
+
+namespace Rules
+{
+    constexpr uint16_t PROGRAM_SIZE = 256;
+    constexpr uint8_t MAX_TIMERS = 16;
+    constexpr uint8_t MAX_PIDS = 4;
+    constexpr uint8_t STACK_SIZE = 8;
+    // Pushed by OP_LOAD for an untrusted reading, every comparison with it is false
+    constexpr int32_t INVALID = INT32_MIN;
+
+    // Bytecode instructions, operands follow the opcode
+    enum Opcodes : uint8_t
+    {
+        OP_END,
+        // channel: push the reading of a channel in hundredths, INVALID unless its quality is OK
+        OP_LOAD,
+        // int16 little endian: push a constant in hundredths
+        OP_CONST,
+        OP_GT,
+        OP_LT,
+        OP_GE,
+        OP_LE,
+        OP_AND,
+        OP_OR,
+        // timer, uint16 seconds: replace the condition with "true for at least that long"
+        OP_FOR,
+        // offset: pop, skip offset bytes if false
+        OP_JF,
+        // output, level: set an actuator
+        OP_SET,
+        // pid block: update a PID controller and set its output
+        OP_PID
+    };
+
+    // Continuous controller, parameters are fixed at compile time
+    struct Pid
+    {
+        uint8_t channel;
+        uint8_t output;
+        float setpoint;
+        float kp;
+        float ki;
+        float kd;
+        float integral;
+        float lastError;
+        uint32_t lastMs;
+        bool primed;
+    };
+
+    uint8_t program[PROGRAM_SIZE] = {OP_END};
+    uint16_t programLength = 1;
+    Pid pids[MAX_PIDS];
+    uint8_t pidCount = 0;
+    // When each FOR condition became true
+    uint32_t timerSince[MAX_TIMERS];
+    bool timerHolding[MAX_TIMERS];
+    uint8_t timerCount = 0;
+
+    const char *defaultSource = "if hum2 > 85 for 2 min then vent=open\n"
+                                "if hum2 < 75 for 2 min then vent=close";
+
+    bool compile(const char *source);
+    bool run(const Greenhouse::Data_s &data, Greenhouse::Config_s &config, uint32_t ms);
+
+    // Compiler state, only used while compiling
+    namespace Compiler
+    {
+        const char *p;
+        uint8_t code[PROGRAM_SIZE];
+        uint16_t length;
+        Pid pids[MAX_PIDS];
+        uint8_t pidCount;
+        uint8_t timerCount;
+        const char *error;
+
+        void fail(const char *message)
+        {
+            if (error == nullptr)
+            {
+                error = message;
+            }
+        }
+
+        void emit(uint8_t byte)
+        {
+            if (length >= PROGRAM_SIZE)
+            {
+                fail("program too long");
+                return;
+            }
+            code[length++] = byte;
+        }
+
+        void emit16(int16_t value)
+        {
+            emit(value & 0xFF);
+            emit((value >> 8) & 0xFF);
+        }
+
+        // Skips blanks, but not new lines which end a rule
+        void skipSpaces()
+        {
+            while (*p == ' ' || *p == '\t' || *p == '\r')
+            {
+                p++;
+            }
+        }
+
+        bool isWordChar(char c)
+        {
+            return isalnum(c) || c == '_';
+        }
+
+        // Consumes a keyword if it is next
+        bool word(const char *w)
+        {
+            skipSpaces();
+            size_t n = strlen(w);
+            if (strncmp(p, w, n) == 0 && !isWordChar(p[n]))
+            {
+                p += n;
+                return true;
+            }
+            return false;
+        }
+
+        // Consumes a symbol if it is next
+        bool symbol(const char *s)
+        {
+            skipSpaces();
+            size_t n = strlen(s);
+            if (strncmp(p, s, n) == 0)
+            {
+                p += n;
+                return true;
+            }
+            return false;
+        }
+
+        bool number(float &value)
+        {
+            skipSpaces();
+            char *end;
+            value = strtof(p, &end);
+            if (end == p)
+            {
+                fail("number expected");
+                return false;
+            }
+            // strtof also takes nan and inf, which no constant, level or gain can be
+            if (!isfinite(value))
+            {
+                fail("finite number expected");
+                return false;
+            }
+            p = end;
+            return true;
+        }
+
+        // Returns the index of the name in the list, or -1
+        int8_t lookup(const char *const *names, uint8_t count)
+        {
+            for (uint8_t i = 0; i < count; i++)
+            {
+                if (word(names[i]))
+                {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        int8_t channel()
+        {
+            static const char *const names[Greenhouse::CHANNEL_COUNT] = {"temp1", "temp2", "temp3", "hum1", "hum2", "hum3"};
+            int8_t index = lookup(names, Greenhouse::CHANNEL_COUNT);
+            if (index < 0)
+            {
+                fail("channel expected");
+            }
+            return index;
+        }
+
+        int8_t output()
+        {
+            static const char *const names[Greenhouse::OUTPUT_COUNT] = {"vent", "fan", "mister"};
+            int8_t index = lookup(names, Greenhouse::OUTPUT_COUNT);
+            if (index < 0)
+            {
+                fail("output expected");
+            }
+            return index;
+        }
+
+        // channel op number
+        void comparison()
+        {
+            int8_t ch = channel();
+            uint8_t op;
+            if (symbol(">="))
+            {
+                op = OP_GE;
+            }
+            else if (symbol("<="))
+            {
+                op = OP_LE;
+            }
+            else if (symbol(">"))
+            {
+                op = OP_GT;
+            }
+            else if (symbol("<"))
+            {
+                op = OP_LT;
+            }
+            else
+            {
+                fail("comparison expected");
+                return;
+            }
+            float value;
+            if (!number(value))
+            {
+                return;
+            }
+            if (value * Greenhouse::SCALE > INT16_MAX || value * Greenhouse::SCALE < INT16_MIN)
+            {
+                fail("constant out of range");
+                return;
+            }
+            emit(OP_LOAD);
+            emit(ch);
+            emit(OP_CONST);
+            emit16(lroundf(value * Greenhouse::SCALE));
+            emit(op);
+        }
+
+        // comparison { and|or comparison }
+        void condition()
+        {
+            comparison();
+            while (error == nullptr)
+            {
+                if (word("and"))
+                {
+                    comparison();
+                    emit(OP_AND);
+                }
+                else if (word("or"))
+                {
+                    comparison();
+                    emit(OP_OR);
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+
+        // output = open|close|on|off|level
+        void assignment()
+        {
+            int8_t out = output();
+            if (!symbol("="))
+            {
+                fail("'=' expected");
+                return;
+            }
+            uint8_t level;
+            if (word("open") || word("on"))
+            {
+                level = 100;
+            }
+            else if (word("close") || word("off"))
+            {
+                level = 0;
+            }
+            else
+            {
+                float value;
+                if (!number(value))
+                {
+                    return;
+                }
+                if (value < 0 || value > 100)
+                {
+                    fail("level must be between 0 and 100");
+                    return;
+                }
+                level = value;
+            }
+            emit(OP_SET);
+            emit(out);
+            emit(level);
+        }
+
+        // if condition [for duration] then assignment {, assignment}
+        void ifRule()
+        {
+            condition();
+            if (word("for"))
+            {
+                float amount;
+                if (!number(amount))
+                {
+                    return;
+                }
+                float seconds;
+                if (word("s"))
+                {
+                    seconds = amount;
+                }
+                else if (word("min"))
+                {
+                    seconds = amount * 60;
+                }
+                else if (word("h"))
+                {
+                    seconds = amount * 3600;
+                }
+                else
+                {
+                    fail("duration unit expected");
+                    return;
+                }
+                if (seconds < 0 || seconds > 65535)
+                {
+                    fail("duration out of range");
+                    return;
+                }
+                if (timerCount >= MAX_TIMERS)
+                {
+                    fail("too many timed conditions");
+                    return;
+                }
+                emit(OP_FOR);
+                emit(timerCount++);
+                emit16((uint16_t)seconds);
+            }
+            if (!word("then"))
+            {
+                fail("'then' expected");
+                return;
+            }
+            emit(OP_JF);
+            uint16_t jump = length;
+            emit(0);
+            do
+            {
+                assignment();
+            } while (error == nullptr && symbol(","));
+            if (length - jump - 1 > 255)
+            {
+                fail("too many assignments");
+                return;
+            }
+            if (error == nullptr)
+            {
+                code[jump] = length - jump - 1;
+            }
+        }
+
+        // pid output = channel to setpoint kp x ki x kd x
+        void pidRule()
+        {
+            if (pidCount >= MAX_PIDS)
+            {
+                fail("too many pid blocks");
+                return;
+            }
+            Pid &pid = pids[pidCount];
+            pid.output = output();
+            if (!symbol("="))
+            {
+                fail("'=' expected");
+                return;
+            }
+            pid.channel = channel();
+            if (!word("to"))
+            {
+                fail("'to' expected");
+                return;
+            }
+            number(pid.setpoint);
+            pid.kp = pid.ki = pid.kd = 0;
+            while (error == nullptr)
+            {
+                if (word("kp"))
+                {
+                    number(pid.kp);
+                }
+                else if (word("ki"))
+                {
+                    number(pid.ki);
+                }
+                else if (word("kd"))
+                {
+                    number(pid.kd);
+                }
+                else
+                {
+                    break;
+                }
+            }
+            pid.integral = 0;
+            pid.lastError = 0;
+            pid.lastMs = 0;
+            pid.primed = false;
+            emit(OP_PID);
+            emit(pidCount++);
+        }
+    };
+
+    /**
+     * @brief Compiles rules into the running program. On error the previous program is kept.
+     *
+     * @param source: Rules text, see the file description
+     * @return true if the rules were compiled and loaded
+     */
+    bool compile(const char *source)
+    {
+        Compiler::p = source;
+        Compiler::length = 0;
+        Compiler::pidCount = 0;
+        Compiler::timerCount = 0;
+        Compiler::error = nullptr;
+        while (Compiler::error == nullptr)
+        {
+            // Skip empty rules
+            while (Compiler::symbol(";") || Compiler::symbol("\n"))
+            {
+            }
+            if (*Compiler::p == '\0')
+            {
+                break;
+            }
+            if (Compiler::word("if"))
+            {
+                Compiler::ifRule();
+            }
+            else if (Compiler::word("pid"))
+            {
+                Compiler::pidRule();
+            }
+            else
+            {
+                Compiler::fail("'if' or 'pid' expected");
+            }
+            Compiler::skipSpaces();
+            if (Compiler::error == nullptr && *Compiler::p != ';' && *Compiler::p != '\n' && *Compiler::p != '\0')
+            {
+                Compiler::fail("end of rule expected");
+            }
+        }
+        Compiler::emit(OP_END);
+        if (Compiler::error != nullptr)
+        {
+            debug("[rules.h] compile error at offset ");
+            debug(Compiler::p - source);
+            debug(": ");
+            debugln(Compiler::error);
+            return false;
+        }
+        memcpy(program, Compiler::code, Compiler::length);
+        programLength = Compiler::length;
+        memcpy(pids, Compiler::pids, sizeof(pids));
+        pidCount = Compiler::pidCount;
+        timerCount = Compiler::timerCount;
+        for (uint8_t i = 0; i < timerCount; i++)
+        {
+            timerHolding[i] = false;
+        }
+        debug("[rules.h] compiled ");
+        debug(programLength);
+        debugln(" bytes");
+        return true;
+    }
+
+    // Evaluates a comparison opcode, false if either side is INVALID
+    int32_t compare(uint8_t op, int32_t a, int32_t b)
+    {
+        if (a == INVALID || b == INVALID)
+        {
+            return 0;
+        }
+        switch (op)
+        {
+        case OP_GT:
+            return a > b;
+        case OP_LT:
+            return a < b;
+        case OP_GE:
+            return a >= b;
+        default:
+            return a <= b;
+        }
+    }
+
+    // Updates a PID block and returns its output level
+    uint8_t runPid(Pid &pid, const Greenhouse::Data_s &data, uint32_t ms)
+    {
+        float error = Greenhouse::getChannel(data, pid.channel) - pid.setpoint;
+        float dt = pid.primed ? (ms - pid.lastMs) / 1000.0f : 0;
+        float derivative = 0;
+        if (dt > 0)
+        {
+            pid.integral += error * dt;
+            derivative = (error - pid.lastError) / dt;
+        }
+        pid.primed = true;
+        pid.lastError = error;
+        pid.lastMs = ms;
+        float out = pid.kp * error + pid.ki * pid.integral + pid.kd * derivative;
+        // Clamp and stop integrating while saturated (anti windup)
+        if (out > 100 || out < 0)
+        {
+            pid.integral -= error * dt;
+            out = out > 100 ? 100 : 0;
+        }
+        return out;
+    }
+
+    /**
+     * @brief Evaluates the program on a reading. Does not allocate.
+     *
+     * @param data: Latest reading
+     * @param config: Config whose actuator levels are updated
+     * @param ms: Current time
+     * @return true if any actuator changed
+     */
+    bool run(const Greenhouse::Data_s &data, Greenhouse::Config_s &config, uint32_t ms)
+    {
+        int32_t stack[STACK_SIZE];
+        uint8_t sp = 0;
+        uint16_t pc = 0;
+        bool changed = false;
+        while (pc < programLength)
+        {
+            uint8_t op = program[pc++];
+            switch (op)
+            {
+            case OP_END:
+                return changed;
+            case OP_LOAD:
+            {
+                uint8_t ch = program[pc++];
+                stack[sp++] = data.quality[ch] == Greenhouse::QUALITY_OK ? data.values[ch] : INVALID;
+                break;
+            }
+            case OP_CONST:
+                stack[sp++] = (int16_t)(program[pc] | (program[pc + 1] << 8));
+                pc += 2;
+                break;
+            case OP_GT:
+            case OP_LT:
+            case OP_GE:
+            case OP_LE:
+                sp--;
+                stack[sp - 1] = compare(op, stack[sp - 1], stack[sp]);
+                break;
+            case OP_AND:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] && stack[sp];
+                break;
+            case OP_OR:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] || stack[sp];
+                break;
+            case OP_FOR:
+            {
+                uint8_t timer = program[pc];
+                uint32_t duration = (program[pc + 1] | (program[pc + 2] << 8)) * 1000UL;
+                pc += 3;
+                if (stack[sp - 1])
+                {
+                    if (!timerHolding[timer])
+                    {
+                        timerHolding[timer] = true;
+                        timerSince[timer] = ms;
+                    }
+                    stack[sp - 1] = ms - timerSince[timer] >= duration;
+                }
+                else
+                {
+                    timerHolding[timer] = false;
+                }
+                break;
+            }
+            case OP_JF:
+            {
+                uint8_t offset = program[pc++];
+                if (!stack[--sp])
+                {
+                    pc += offset;
+                }
+                break;
+            }
+            case OP_SET:
+                changed |= Greenhouse::setOutput(config, program[pc], program[pc + 1]);
+                pc += 2;
+                break;
+            case OP_PID:
+            {
+                Pid &pid = pids[program[pc++]];
+                if (data.quality[pid.channel] != Greenhouse::QUALITY_OK)
+                {
+                    // Hold the output, and restart the derivative and integral timing on recovery
+                    pid.primed = false;
+                    break;
+                }
+                changed |= Greenhouse::setOutput(config, pid.output, runPid(pid, data, ms));
+                break;
+            }
+            default:
+                debugln("[rules.h] invalid opcode");
+                return changed;
+            }
+        }
+        return changed;
+    }
+};
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file sensors.h
+ * @author Riccardo Iacob
+ * @brief Fixed point ingestion of raw greenhouse readings: calibration, spike rejection and smoothing
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <Arduino.h>
+#include "debug.h"
+#include "greenhouse.h"
+
+namespace Sensors
+{
+    // Longest supported median window
+    constexpr uint8_t MAX_MEDIAN = 5;
+    // Fraction bits of the IIR accumulator
+    constexpr uint8_t IIR_FRACTION = 8;
+    // Calibration gain of 1.0
+    constexpr int16_t UNITY_GAIN = 1024;
+
+    /**
+     * @brief Per channel processing, applied in order: calibration, range check, median, IIR
+     *
+     */
+    struct Filter_s
+    {
+        // Calibration, value = raw * gain / UNITY_GAIN + offset (hundredths)
+        int16_t offset;
+        int16_t gain;
+        // Plausible range after calibration (hundredths), values outside are discarded
+        int16_t min;
+        int16_t max;
+        // Median window (1 disables it, odd values up to MAX_MEDIAN)
+        uint8_t median;
+        // IIR smoothing, y += (x - y) / 2^shift (0 disables it)
+        uint8_t iirShift;
+        // Time without valid values after which the channel is flagged stale
+        uint32_t staleMs;
+    };
+
+    // Running state of a channel
+    struct State_s
+    {
+        int16_t window[MAX_MEDIAN];
+        uint8_t next;
+        uint8_t count;
+        int32_t iir;
+        bool primed;
+        uint32_t lastMs;
+    };
+
+    Filter_s filters[Greenhouse::CHANNEL_COUNT] = {
+        {0, UNITY_GAIN, -4000, 8000, 3, 2, 30000},
+        {0, UNITY_GAIN, -4000, 8000, 3, 2, 30000},
+        {0, UNITY_GAIN, -4000, 8000, 3, 2, 30000},
+        {0, UNITY_GAIN, 0, 10000, 3, 2, 30000},
+        {0, UNITY_GAIN, 0, 10000, 3, 2, 30000},
+        {0, UNITY_GAIN, 0, 10000, 3, 2, 30000},
+    };
+    State_s states[Greenhouse::CHANNEL_COUNT];
+
+    void ingest(const int16_t *frame, uint32_t ms, Greenhouse::Data_s &out);
+    void checkStale(uint32_t ms, Greenhouse::Data_s &out);
+
+    // Median of the first n values of a window (n <= MAX_MEDIAN), the mean of the middle two while a window fills up to an even count
+    int16_t median(const int16_t *window, uint8_t n)
+    {
+        int16_t sorted[MAX_MEDIAN];
+        for (uint8_t i = 0; i < n; i++)
+        {
+            int16_t v = window[i];
+            uint8_t j = i;
+            while (j > 0 && sorted[j - 1] > v)
+            {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = v;
+        }
+        if (n % 2 == 0)
+        {
+            return ((int32_t)sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+        }
+        return sorted[n / 2];
+    }
+
+    /**
+     * @brief Runs a raw frame through the filters of every channel. Integer only.
+     *
+     * @param frame: Raw readings in hundredths, indexed by Greenhouse::Channels (MISSING if absent)
+     * @param ms: Reception time
+     * @param out: Filtered data, updated in place
+     */
+    void ingest(const int16_t *frame, uint32_t ms, Greenhouse::Data_s &out)
+    {
+        for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+        {
+            const Filter_s &f = filters[i];
+            State_s &s = states[i];
+            if (frame[i] == Greenhouse::MISSING)
+            {
+                continue;
+            }
+            int32_t value = (int32_t)frame[i] * f.gain / UNITY_GAIN + f.offset;
+            if (value < f.min || value > f.max)
+            {
+                // Keep the last good value, but let the UI know it's not fresh
+                out.quality[i] |= Greenhouse::QUALITY_RANGE;
+                continue;
+            }
+            // Median over the last samples rejects single spikes
+            s.window[s.next] = value;
+            s.next = (s.next + 1) % f.median;
+            if (s.count < f.median)
+            {
+                s.count++;
+            }
+            value = median(s.window, s.count);
+            // First order IIR smoothing, the accumulator keeps extra fraction bits
+            if (!s.primed)
+            {
+                s.iir = value * (1 << IIR_FRACTION);
+                s.primed = true;
+            }
+            else
+            {
+                s.iir += (value * (1 << IIR_FRACTION) - s.iir) >> f.iirShift;
+            }
+            out.values[i] = (s.iir + (1 << (IIR_FRACTION - 1))) >> IIR_FRACTION;
+            out.quality[i] = Greenhouse::QUALITY_OK;
+            s.lastMs = ms;
+        }
+        checkStale(ms, out);
+    }
+
+    // Flags channels which had no valid value for longer than their timeout
+    void checkStale(uint32_t ms, Greenhouse::Data_s &out)
+    {
+        for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+        {
+            if (!states[i].primed || ms - states[i].lastMs > filters[i].staleMs)
+            {
+                out.quality[i] |= Greenhouse::QUALITY_STALE;
+            }
+        }
+    }
+
+    // Changes the filters of a channel and restarts its state
+    void configure(uint8_t channel, const Filter_s &filter)
+    {
+        if (channel >= Greenhouse::CHANNEL_COUNT || filter.median == 0 || filter.median > MAX_MEDIAN || filter.iirShift > 15)
+        {
+            debugln("[sensors.h] invalid filter configuration");
+            return;
+        }
+        filters[channel] = filter;
+        states[channel] = State_s();
+    }
+};
+
+#endif
@@ -0,0 +1,629 @@
+/**
+ * @file seriallink.h
+ * @author Riccardo Iacob
+ * @brief Binary telemetry and remote control protocol on the UART
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Every frame is COBS encoded and terminated by 0x00. Decoded, a frame is:
+ *   type (u8), sequence (u8), body, CRC-16/CCITT-FALSE of type, sequence and body (u16)
+ * Multi-byte fields are little endian, structs are sent as laid out in memory on the ESP32.
+ *
+ * Host to device:
+ *   MSG_PING          -                          -> MSG_ACK
+ *   MSG_SUBSCRIBE     enable (u8)                -> MSG_ACK, then MSG_LIVE on every reading
+ *   MSG_GET_HISTORY   first (u32), count (u32)   -> MSG_HISTORY pages
+ *   MSG_GET_CONFIG    -                          -> MSG_CONFIG
+ *   MSG_SET_CONFIG    test (u8, 0 or 1), vent, fan, mister (u8, 0 to 100)
+ *                                                -> MSG_ACK
+ *   MSG_SET_SCREEN    TFT::TFTStates (u8), IDLE or CONFIG
+ *                                                -> MSG_ACK
+ *   MSG_GET_COUNTERS  -                          -> MSG_COUNTERS
+ *   MSG_SET_RULES     rules text                 -> MSG_ACK
+ *   MSG_EXPORT        first (u32), count (u32)   -> MSG_EXPORT_DATA chunks, then MSG_EXPORT_END
+ *   MSG_OTA_BEGIN     size (u32), SHA-256 (32)   -> MSG_OTA_STATUS, next is the first chunk to send
+ *   MSG_OTA_CHUNK     index (u32), CRC-32 (u32), data (Ota::CHUNK bytes, fewer for the last)
+ *                                                -> MSG_OTA_STATUS
+ *   MSG_OTA_END       -                          -> MSG_OTA_STATUS, again once the image is verified
+ *   MSG_OTA_REBOOT    -                          -> MSG_ACK, restarts if the update is ready
+ * Device to host:
+ *   MSG_ACK           request type (u8), request sequence (u8), Status (u8)
+ *   MSG_LIVE          Greenhouse::Data_s
+ *   MSG_HISTORY       first (u32), total (u32), History::Record_s[]
+ *   MSG_CONFIG        Greenhouse::Config_s
+ *   MSG_COUNTERS      Counters_s
+ *   MSG_LOG           debug text, one line per frame
+ *   MSG_EXPORT_DATA   compressed history, see export.h
+ *   MSG_EXPORT_END    records (u32), encoded bytes (u32), compressed bytes (u32)
+ *   MSG_OTA_STATUS    Ota::States (u8), Ota::Status (u8), next chunk (u32)
+ * Once the host sent a valid frame, debug output goes out as MSG_LOG until the host is silent
+ * for SESSION_TIMEOUT. A client for the host side is in host/seriallink_client.h.
+ */
+#ifndef SERIALLINK_H
+#define SERIALLINK_H
+
+#include <Arduino.h>
+#include "debug.h"
+#include "clock.h"
+#include "greenhouse.h"
+#include "history.h"
+#include "export.h"
+#include "ota.h"
+#include "rules.h"
+#include "spritecache.h"
+#include "tfthelper.h"
+#include "radiohelper.h"
+
+namespace SerialLink
+{
+    // Power of two
+    const uint16_t TX_BUFFER = 4096;
+    // UART driver buffers, the transmit one holds what a 10 ms loop pass sends at 921600 baud
+    const uint16_t UART_RX_BUFFER = 1024;
+    const uint16_t UART_TX_BUFFER = 2048;
+    const uint16_t RX_FRAME = 320;
+    // Largest request is an OTA chunk with its header, CRC and COBS overhead
+    static_assert(RX_FRAME >= Ota::CHUNK + 8 + 4 + Ota::CHUNK / 254 + 1, "RX_FRAME too small for OTA chunks");
+    // Bytes read per tick at most, keeps the UI responsive under a flood
+    const uint16_t RX_BUDGET = 512;
+    const uint8_t HISTORY_PAGE = 8;
+    const uint32_t SESSION_TIMEOUT = 10000;
+
+    enum Messages : uint8_t
+    {
+        MSG_PING = 0x01,
+        MSG_SUBSCRIBE = 0x02,
+        MSG_GET_HISTORY = 0x03,
+        MSG_GET_CONFIG = 0x04,
+        MSG_SET_CONFIG = 0x05,
+        MSG_SET_SCREEN = 0x06,
+        MSG_GET_COUNTERS = 0x07,
+        MSG_SET_RULES = 0x08,
+        MSG_EXPORT = 0x09,
+        MSG_OTA_BEGIN = 0x0A,
+        MSG_OTA_CHUNK = 0x0B,
+        MSG_OTA_END = 0x0C,
+        MSG_OTA_REBOOT = 0x0D,
+        MSG_ACK = 0x80,
+        MSG_LIVE = 0x81,
+        MSG_HISTORY = 0x82,
+        MSG_CONFIG = 0x83,
+        MSG_COUNTERS = 0x84,
+        MSG_LOG = 0x85,
+        MSG_EXPORT_DATA = 0x86,
+        MSG_EXPORT_END = 0x87,
+        MSG_OTA_STATUS = 0x88
+    };
+
+    enum Status : uint8_t
+    {
+        STATUS_OK,
+        STATUS_BAD_LENGTH,
+        STATUS_UNKNOWN,
+        STATUS_REJECTED,
+        STATUS_BAD_VALUE
+    };
+
+    struct Counters_s
+    {
+        uint32_t uptimeMs;
+        uint32_t radioFrames;
+        uint32_t tftFrames;
+        uint32_t tftDropped;
+        uint32_t tftCoalesced;
+        uint32_t spriteHits;
+        uint32_t spriteMisses;
+        uint32_t rxFrames;
+        uint32_t rxErrors;
+        uint32_t txFrames;
+        uint32_t txDrops;
+    };
+
+    // Piece of a frame body, frames are encoded straight from the source data
+    struct Segment_s
+    {
+        const void *data;
+        uint16_t length;
+    };
+
+    uint8_t tx[TX_BUFFER];
+    uint16_t txHead = 0;
+    uint16_t txTail = 0;
+    uint8_t txSeq = 0;
+    uint8_t rx[RX_FRAME];
+    uint16_t rxLength = 0;
+    bool rxOverflow = false;
+    uint32_t lastRxMs = 0;
+    bool connected = false;
+    bool subscribed = false;
+    uint32_t liveFrames = 0;
+    // Pending history transfer
+    uint32_t historyNext = 0;
+    uint32_t historyRemaining = 0;
+    char rulesSource[Rules::PROGRAM_SIZE + 1];
+    uint32_t rxFrames = 0;
+    uint32_t rxErrors = 0;
+    uint32_t txFrames = 0;
+    uint32_t txDrops = 0;
+    // Report the end of the OTA verification to the host
+    bool otaVerifying = false;
+    bool rebootPending = false;
+
+    void doSetup();
+    void doTick();
+    bool send(uint8_t type, const Segment_s *segments, uint8_t count);
+    uint32_t nextDeadline();
+
+    uint16_t crc16(uint16_t crc, uint8_t byte)
+    {
+        crc ^= (uint16_t)byte << 8;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+        return crc;
+    }
+
+    uint16_t txFree()
+    {
+        return TX_BUFFER - (uint16_t)(txHead - txTail);
+    }
+
+    /**
+     * @brief COBS encoder writing straight into the transmit ring, the code byte of each
+     * block is reserved and patched once the block is complete
+     *
+     */
+    struct Encoder
+    {
+        uint16_t codeAt;
+        uint8_t code;
+
+        void begin()
+        {
+            codeAt = txHead++;
+            code = 1;
+        }
+
+        void put(uint8_t byte)
+        {
+            if (byte == 0)
+            {
+                tx[codeAt & (TX_BUFFER - 1)] = code;
+                begin();
+                return;
+            }
+            tx[txHead++ & (TX_BUFFER - 1)] = byte;
+            if (++code == 0xFF)
+            {
+                tx[codeAt & (TX_BUFFER - 1)] = code;
+                begin();
+            }
+        }
+
+        void end()
+        {
+            tx[codeAt & (TX_BUFFER - 1)] = code;
+            tx[txHead++ & (TX_BUFFER - 1)] = 0;
+        }
+    };
+
+    /**
+     * @brief Queues a frame, never blocks
+     *
+     * @return false if the transmit buffer is full (the frame is dropped)
+     */
+    bool send(uint8_t type, const Segment_s *segments, uint8_t count)
+    {
+        uint16_t length = 4;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            length += segments[i].length;
+        }
+        // COBS overhead is one byte per 254, plus the first code and the delimiter
+        if (length + length / 254 + 2 > txFree())
+        {
+            txDrops++;
+            return false;
+        }
+        Encoder encoder;
+        encoder.begin();
+        uint16_t crc = 0xFFFF;
+        uint8_t header[2] = {type, txSeq++};
+        for (uint8_t byte : header)
+        {
+            crc = crc16(crc, byte);
+            encoder.put(byte);
+        }
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const uint8_t *data = (const uint8_t *)segments[i].data;
+            for (uint16_t j = 0; j < segments[i].length; j++)
+            {
+                crc = crc16(crc, data[j]);
+                encoder.put(data[j]);
+            }
+        }
+        encoder.put(crc & 0xFF);
+        encoder.put(crc >> 8);
+        encoder.end();
+        txFrames++;
+        return true;
+    }
+
+    bool send(uint8_t type, const void *data, uint16_t length)
+    {
+        Segment_s segment = {data, length};
+        return send(type, &segment, 1);
+    }
+
+    void ack(uint8_t type, uint8_t seq, uint8_t status)
+    {
+        uint8_t body[3] = {type, seq, status};
+        send(MSG_ACK, body, sizeof(body));
+    }
+
+    /**
+     * @brief Debug output as MSG_LOG frames, one per line
+     *
+     */
+    class LogPrint : public Print
+    {
+    private:
+        char _line[120];
+        uint8_t _length = 0;
+
+    public:
+        size_t write(uint8_t c) override
+        {
+            if (c == '\r')
+            {
+                return 1;
+            }
+            if (c != '\n')
+            {
+                _line[_length++] = c;
+            }
+            if (c == '\n' || _length == sizeof(_line))
+            {
+                send(MSG_LOG, _line, _length);
+                _length = 0;
+            }
+            return 1;
+        }
+    };
+
+    LogPrint log;
+
+    void otaStatus(uint8_t status, uint32_t next)
+    {
+        uint8_t body[6] = {Ota::state, status};
+        memcpy(body + 2, &next, 4);
+        send(MSG_OTA_STATUS, body, sizeof(body));
+    }
+
+    // A chunk that doesn't fit in the transmit buffer is encoded again on the next tick
+    bool exportChunk(const uint8_t *chunk, uint16_t length)
+    {
+        return send(MSG_EXPORT_DATA, chunk, length);
+    }
+
+    // Decodes a COBS frame in place, returns the decoded length (0 if malformed)
+    uint16_t decode(uint8_t *buffer, uint16_t length)
+    {
+        uint16_t read = 0;
+        uint16_t write = 0;
+        while (read < length)
+        {
+            uint8_t code = buffer[read++];
+            if (code == 0)
+            {
+                return 0;
+            }
+            for (uint8_t i = 1; i < code; i++)
+            {
+                if (read >= length)
+                {
+                    return 0;
+                }
+                buffer[write++] = buffer[read++];
+            }
+            if (code < 0xFF && read < length)
+            {
+                buffer[write++] = 0;
+            }
+        }
+        return write;
+    }
+
+    // Converts a MSG_SET_CONFIG body field by field, false if any field is out of range
+    bool parseConfig(const uint8_t *body, Greenhouse::Config_s &config)
+    {
+        if (body[0] > 1 || body[1] > 100 || body[2] > 100 || body[3] > 100)
+        {
+            return false;
+        }
+        config.test = body[0] == 1;
+        config.vent = body[1];
+        config.fan = body[2];
+        config.mister = body[3];
+        return true;
+    }
+
+    // Executes a request from the host
+    void dispatch(uint8_t type, uint8_t seq, const uint8_t *body, uint16_t length)
+    {
+        switch (type)
+        {
+        case MSG_PING:
+            ack(type, seq, STATUS_OK);
+            break;
+        case MSG_SUBSCRIBE:
+            if (length != 1)
+            {
+                ack(type, seq, STATUS_BAD_LENGTH);
+                break;
+            }
+            subscribed = body[0] != 0;
+            liveFrames = Radio::frames;
+            ack(type, seq, STATUS_OK);
+            break;
+        case MSG_GET_HISTORY:
+            if (length != 8)
+            {
+                ack(type, seq, STATUS_BAD_LENGTH);
+                break;
+            }
+            memcpy(&historyNext, body, 4);
+            memcpy(&historyRemaining, body + 4, 4);
+            break;
+        case MSG_GET_CONFIG:
+            send(MSG_CONFIG, &Greenhouse::config, sizeof(Greenhouse::config));
+            break;
+        case MSG_SET_CONFIG:
+        {
+            if (length != 4)
+            {
+                ack(type, seq, STATUS_BAD_LENGTH);
+                break;
+            }
+            Greenhouse::Config_s config;
+            if (!parseConfig(body, config))
+            {
+                ack(type, seq, STATUS_BAD_VALUE);
+                break;
+            }
+            Greenhouse::config = config;
+            Radio::configModified = true;
+            ack(type, seq, STATUS_OK);
+            break;
+        }
+        case MSG_SET_SCREEN:
+            if (length != 1)
+            {
+                ack(type, seq, STATUS_BAD_LENGTH);
+                break;
+            }
+            // Calibration waits for touches on the panel, nobody may be standing there
+            if (body[0] != (uint8_t)TFT::TFTStates::IDLE && body[0] != (uint8_t)TFT::TFTStates::CONFIG)
+            {
+                ack(type, seq, STATUS_REJECTED);
+                break;
+            }
+            TFT::setState((TFT::TFTStates)body[0]);
+            ack(type, seq, STATUS_OK);
+            break;
+        case MSG_GET_COUNTERS:
+        {
+            Counters_s counters = {Clock::now(), Radio::frames, TFT::frames, TFT::droppedFrames, TFT::coalesced,
+                                   SpriteCache::hits, SpriteCache::misses, rxFrames, rxErrors, txFrames, txDrops};
+            send(MSG_COUNTERS, &counters, sizeof(counters));
+            break;
+        }
+        case MSG_SET_RULES:
+            if (length > Rules::PROGRAM_SIZE)
+            {
+                ack(type, seq, STATUS_BAD_LENGTH);
+                break;
+            }
+            memcpy(rulesSource, body, length);
+            rulesSource[length] = '\0';
+            ack(type, seq, Rules::compile(rulesSource) ? STATUS_OK : STATUS_REJECTED);
+            break;
+        case MSG_EXPORT:
+        {
+            if (length != 8)
+            {
+                ack(type, seq, STATUS_BAD_LENGTH);
+                break;
+            }
+            uint32_t first, count;
+            memcpy(&first, body, 4);
+            memcpy(&count, body + 4, 4);
+            ack(type, seq, Export::begin(first, count, exportChunk) ? STATUS_OK : STATUS_REJECTED);
+            break;
+        }
+        case MSG_OTA_BEGIN:
+        {
+            if (length != 4 + 32)
+            {
+                ack(type, seq, STATUS_BAD_LENGTH);
+                break;
+            }
+            uint32_t size;
+            uint8_t status;
+            memcpy(&size, body, 4);
+            uint32_t next = Ota::begin(size, body + 4, status);
+            otaStatus(status, next);
+            break;
+        }
+        case MSG_OTA_CHUNK:
+        {
+            if (length < 8)
+            {
+                ack(type, seq, STATUS_BAD_LENGTH);
+                break;
+            }
+            uint32_t index, crc;
+            memcpy(&index, body, 4);
+            memcpy(&crc, body + 4, 4);
+            uint8_t status = Ota::write(index, crc, body + 8, length - 8);
+            otaStatus(status, Ota::received);
+            break;
+        }
+        case MSG_OTA_END:
+        {
+            uint8_t status = Ota::finish();
+            otaVerifying = status == Ota::STATUS_OK;
+            otaStatus(status, Ota::received);
+            break;
+        }
+        case MSG_OTA_REBOOT:
+            rebootPending = Ota::state == Ota::READY;
+            ack(type, seq, rebootPending ? STATUS_OK : STATUS_REJECTED);
+            break;
+        default:
+            ack(type, seq, STATUS_UNKNOWN);
+            break;
+        }
+    }
+
+    // Checks and executes a complete frame from rx
+    void receive()
+    {
+        uint16_t length = decode(rx, rxLength);
+        if (length < 4)
+        {
+            rxErrors++;
+            return;
+        }
+        uint16_t crc = 0xFFFF;
+        for (uint16_t i = 0; i < length - 2; i++)
+        {
+            crc = crc16(crc, rx[i]);
+        }
+        if (crc != (rx[length - 2] | (rx[length - 1] << 8)))
+        {
+            rxErrors++;
+            return;
+        }
+        rxFrames++;
+        lastRxMs = Clock::now();
+        if (!connected)
+        {
+            connected = true;
+#if DEBUG == true
+            Debug::out = &log;
+#endif
+        }
+        dispatch(rx[0], rx[1], rx + 2, length - 4);
+    }
+
+    // call before Serial.begin(), the default buffers overflow at 921600 baud
+    void doSetup()
+    {
+        Serial.setRxBufferSize(UART_RX_BUFFER);
+        // Without a transmit buffer availableForWrite() is the 128 byte FIFO, a fraction of a loop pass
+        Serial.setTxBufferSize(UART_TX_BUFFER);
+    }
+
+    // moves received bytes and queued frames between the UART and the link, never blocks
+    void doTick()
+    {
+        uint16_t budget = RX_BUDGET;
+        while (budget-- > 0 && Serial.available() > 0)
+        {
+            uint8_t c = Serial.read();
+            if (c == 0)
+            {
+                if (!rxOverflow && rxLength > 0)
+                {
+                    receive();
+                }
+                rxLength = 0;
+                rxOverflow = false;
+            }
+            else if (rxLength < RX_FRAME)
+            {
+                rx[rxLength++] = c;
+            }
+            else
+            {
+                rxOverflow = true;
+                rxErrors++;
+            }
+        }
+        if (connected && Clock::now() - lastRxMs >= SESSION_TIMEOUT)
+        {
+            connected = false;
+            subscribed = false;
+            historyRemaining = 0;
+            Export::active = false;
+#if DEBUG == true
+            Debug::out = &Serial;
+#endif
+        }
+        // Live readings, straight from the filtered data
+        if (subscribed && Radio::frames != liveFrames)
+        {
+            liveFrames = Radio::frames;
+            send(MSG_LIVE, &Greenhouse::data, sizeof(Greenhouse::data));
+        }
+        // One history page per tick while there's room for it
+        if (historyRemaining > 0 && txFree() >= 2 * (HISTORY_PAGE * sizeof(History::Record_s) + 16))
+        {
+            History::Record_s page[HISTORY_PAGE];
+            uint32_t n = History::read(historyNext, page, min(historyRemaining, (uint32_t)HISTORY_PAGE));
+            uint32_t total = History::size();
+            Segment_s segments[3] = {{&historyNext, 4}, {&total, 4}, {page, (uint16_t)(n * sizeof(History::Record_s))}};
+            send(MSG_HISTORY, segments, 3);
+            historyNext += n;
+            historyRemaining = n == 0 ? 0 : historyRemaining - n;
+        }
+        // One export page per tick, the compressor runs only as fast as the link drains
+        if (Export::active && txFree() >= 2 * Export::PAGE_BOUND)
+        {
+            if (Export::doStep())
+            {
+                uint32_t summary[3] = {Export::records, Export::rawBytes, Export::compressedBytes};
+                send(MSG_EXPORT_END, summary, sizeof(summary));
+            }
+        }
+        if (otaVerifying && Ota::state != Ota::VERIFYING)
+        {
+            otaVerifying = false;
+            otaStatus(Ota::error, Ota::received);
+        }
+        // Hand as much as the UART driver takes without waiting
+        int room = Serial.availableForWrite();
+        while (room > 0 && txTail != txHead)
+        {
+            uint16_t start = txTail & (TX_BUFFER - 1);
+            uint16_t contiguous = min((uint16_t)(txHead - txTail), (uint16_t)(TX_BUFFER - start));
+            uint16_t n = room < contiguous ? room : contiguous;
+            Serial.write(tx + start, n);
+            txTail += n;
+            room -= n;
+        }
+        // Restart once the acknowledgement is out
+        if (rebootPending && txTail == txHead)
+        {
+            Serial.flush();
+            esp_restart();
+        }
+    }
+
+    // the link can't sleep while a host is connected or frames are queued
+    uint32_t nextDeadline()
+    {
+        if (connected || txTail != txHead)
+        {
+            return Clock::now();
+        }
+        return Clock::now() + 0x7FFFFFFF;
+    }
+};
+
+#endif
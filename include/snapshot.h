@@ -0,0 +1,551 @@
+/**
+ * @file snapshot.h
+ * @author Riccardo Iacob
+ * @brief Cache of compressed screen images, a page switch streams the image instead of drawing primitives
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * A snapshot holds the static layer of a screen: background and widgets in their normal style, without
+ * values, alarm highlights or the progress bar, which are drawn on top after a restore. It is rendered
+ * off-screen a band of BAND rows at a time, so it doesn't depend on reading back the panel.
+ *
+ * Every row is compressed on its own, as a sequence of:
+ *   c < 128: c + 1 literal pixels follow
+ *   c >= 128: the following pixel repeated c - 126 times (2 to 129)
+ * Pixels are RGB565 in sprite byte order, 2 bytes each.
+ *
+ * Captured snapshots are also written to LittleFS, so they survive a restart and the first frame after
+ * boot is already a restore. A key goes to file slot key % FILE_SLOTS, a collision replaces the older
+ * one. The file starts with a FileHeader_s; a file of another Layout::VERSION or with a bad CRC is
+ * removed when it is found, and the screen is drawn from primitives and captured again.
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <esp_heap_caps.h>
+#include <esp32/rom/crc.h>
+#include <LittleFS.h>
+#include "debug.h"
+#include "buttonwidget.h"
+#include "layout.h"
+
+namespace Snapshot
+{
+    const uint8_t MAX_ENTRIES = 4;
+    const uint16_t BAND = 16;
+    // Growth step of a snapshot while it is being captured
+    const uint32_t GROW = 8192;
+    static_assert(Layout::SCREEN_HEIGHT % BAND == 0, "BAND must divide the screen height");
+    const uint8_t FILE_SLOTS = 8;
+    // "SNAP"
+    const uint32_t FILE_MAGIC = 0x50414E53;
+
+    struct Entry_s
+    {
+        uint32_t key;
+        uint8_t *data;
+        uint32_t size;
+        uint32_t lastUse;
+    };
+
+    struct FileHeader_s
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t key;
+        uint32_t size;
+        // CRC-32 of the compressed data
+        uint32_t crc;
+    };
+
+    // RAM allowed for snapshots, raised in doSetup() when PSRAM is available
+    uint32_t budget = 64 * 1024;
+    uint32_t used = 0;
+    uint32_t caps = MALLOC_CAP_8BIT;
+    Entry_s entries[MAX_ENTRIES];
+    uint8_t count = 0;
+    uint32_t useCounter = 0;
+    // Keys that didn't fit the budget, not captured again
+    uint32_t rejected[MAX_ENTRIES];
+    uint8_t rejectedCount = 0;
+    // Set by Boot::mountFS(), snapshots stay in RAM only without LittleFS
+    bool persist = false;
+
+    // Statistics since the last report
+    uint32_t restores = 0;
+    uint64_t restoreUs = 0;
+    uint32_t captures = 0;
+    uint64_t captureUs = 0;
+    uint32_t loads = 0;
+    uint64_t loadUs = 0;
+
+    void doSetup();
+    uint32_t key(const ButtonWidget::Spec *widgets, uint8_t n, uint16_t background);
+    bool capture(TFT_eSPI *tft, uint32_t key, const ButtonWidget::Spec *widgets, uint8_t n, uint16_t background);
+    bool restore(TFT_eSPI *tft, uint32_t key);
+
+    void doSetup()
+    {
+        if (psramFound())
+        {
+            caps = MALLOC_CAP_SPIRAM;
+            budget = 1024 * 1024;
+        }
+    }
+
+    /**
+     * @brief Identifies the look of a screen: its widgets, background and Layout::VERSION
+     *
+     * Strings and icons are hashed by contents, not address, so the key of a screen stays the same
+     * across builds and a snapshot on LittleFS is found again.
+     */
+    uint32_t key(const ButtonWidget::Spec *widgets, uint8_t n, uint16_t background)
+    {
+        // FNV-1a, like ButtonWidget::cacheKey
+        uint32_t hash = 2166136261u;
+        auto mix = [&hash](uintptr_t field)
+        {
+            for (uint8_t i = 0; i < sizeof(field); i++)
+            {
+                hash = (hash ^ ((field >> (8 * i)) & 0xFF)) * 16777619u;
+            }
+        };
+        auto mixBytes = [&hash](const uint8_t *bytes, uint32_t length)
+        {
+            for (uint32_t i = 0; i < length; i++)
+            {
+                hash = (hash ^ bytes[i]) * 16777619u;
+            }
+        };
+        // Length first, so a missing string differs from an empty one
+        auto mixString = [&](const char *text)
+        {
+            mix(text != nullptr ? strlen(text) + 1 : 0);
+            if (text != nullptr)
+            {
+                mixBytes((const uint8_t *)text, strlen(text));
+            }
+        };
+        mix(Layout::VERSION);
+        mix(background);
+        for (uint8_t i = 0; i < n; i++)
+        {
+            const ButtonWidget::Spec &s = widgets[i];
+            uintptr_t fields[] = {s.startx, s.starty, s.sizex, s.sizey, (uintptr_t)s.style, s.bgcolor, s.fgcolor, s.cornerradius,
+                                  s.font, s.fontSize, s.tooltipFont, s.tooltipFontSize, (uintptr_t)s.tooltipPosition,
+                                  s.tooltipPadding, s.tooltipFgColor, s.textx, s.texty, s.tooltipx, s.tooltipy};
+            for (uintptr_t field : fields)
+            {
+                mix(field);
+            }
+            mixString(s.text);
+            mixString(s.tooltip);
+            // XBM bitmap of sizex by sizey, rows padded to bytes
+            mix(s.icon != nullptr);
+            if (s.icon != nullptr)
+            {
+                mixBytes(s.icon, (s.sizex + 7) / 8 * s.sizey);
+            }
+        }
+        return hash;
+    }
+
+    Entry_s *find(uint32_t key)
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (entries[i].key == key)
+            {
+                return &entries[i];
+            }
+        }
+        return nullptr;
+    }
+
+    bool contains(uint32_t key)
+    {
+        return find(key) != nullptr;
+    }
+
+    // True if key was too large for the budget
+    bool isRejected(uint32_t key)
+    {
+        for (uint8_t i = 0; i < rejectedCount; i++)
+        {
+            if (rejected[i] == key)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void evict(uint8_t index)
+    {
+        heap_caps_free(entries[index].data);
+        used -= entries[index].size;
+        entries[index] = entries[--count];
+    }
+
+    // Index of the least recently used entry
+    uint8_t oldest()
+    {
+        uint8_t oldest = 0;
+        for (uint8_t i = 1; i < count; i++)
+        {
+            if (entries[i].lastUse < entries[oldest].lastUse)
+            {
+                oldest = i;
+            }
+        }
+        return oldest;
+    }
+
+    // Adds a snapshot to the cache, evicting the least recently used ones to make room
+    Entry_s *insert(uint32_t key, uint8_t *data, uint32_t size)
+    {
+        while (count > 0 && (used + size > budget || count >= MAX_ENTRIES))
+        {
+            evict(oldest());
+        }
+        Entry_s &entry = entries[count++];
+        entry.key = key;
+        entry.data = data;
+        entry.size = size;
+        entry.lastUse = ++useCounter;
+        used += size;
+        return &entry;
+    }
+
+    void filePath(uint32_t key, char *path, size_t length)
+    {
+        snprintf(path, length, "/snap%u.bin", (unsigned)(key % FILE_SLOTS));
+    }
+
+    // Writes a snapshot to its file slot
+    void save(const Entry_s &entry)
+    {
+        if (!persist)
+        {
+            return;
+        }
+        char path[16];
+        filePath(entry.key, path, sizeof(path));
+        FileHeader_s header = {FILE_MAGIC, Layout::VERSION, 0, entry.key, entry.size, crc32_le(0, entry.data, entry.size)};
+        File file = LittleFS.open(path, FILE_WRITE);
+        bool written = file && file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+                       file.write(entry.data, entry.size) == entry.size;
+        file.close();
+        if (!written)
+        {
+            // A partial file would fail its CRC anyway, give the space back
+            LittleFS.remove(path);
+            debugln("[snapshot.h] could not save snapshot");
+        }
+    }
+
+    /**
+     * @brief Reads the snapshot of key from LittleFS into the cache
+     *
+     * @return nullptr if there is no valid file for key
+     */
+    Entry_s *load(uint32_t key)
+    {
+        char path[16];
+        filePath(key, path, sizeof(path));
+        if (!persist || !LittleFS.exists(path))
+        {
+            return nullptr;
+        }
+        uint32_t start = micros();
+        File file = LittleFS.open(path, FILE_READ);
+        FileHeader_s header;
+        if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != FILE_MAGIC ||
+            header.version != Layout::VERSION)
+        {
+            file.close();
+            LittleFS.remove(path);
+            debugln("[snapshot.h] removed snapshot of an old layout");
+            return nullptr;
+        }
+        // Another screen in the same slot
+        if (header.key != key || header.size > budget)
+        {
+            file.close();
+            return nullptr;
+        }
+        uint8_t *data = (uint8_t *)heap_caps_malloc(header.size, caps);
+        if (data == nullptr)
+        {
+            file.close();
+            return nullptr;
+        }
+        bool valid = file.read(data, header.size) == header.size && crc32_le(0, data, header.size) == header.crc;
+        file.close();
+        if (!valid)
+        {
+            heap_caps_free(data);
+            LittleFS.remove(path);
+            debugln("[snapshot.h] removed corrupt snapshot");
+            return nullptr;
+        }
+        Entry_s *entry = insert(key, data, header.size);
+        loads++;
+        loadUs += micros() - start;
+        return entry;
+    }
+
+    // Compresses a row, returns the compressed size or 0 if it doesn't fit in out
+    uint32_t encodeRow(const uint16_t *row, uint16_t width, uint8_t *out, uint32_t room)
+    {
+        uint32_t length = 0;
+        uint16_t i = 0;
+        while (i < width)
+        {
+            uint16_t run = 1;
+            while (i + run < width && run < 129 && row[i + run] == row[i])
+            {
+                run++;
+            }
+            if (run >= 2)
+            {
+                if (length + 3 > room)
+                {
+                    return 0;
+                }
+                out[length++] = 126 + run;
+                memcpy(out + length, &row[i], 2);
+                length += 2;
+                i += run;
+                continue;
+            }
+            // Literals up to the start of the next run
+            uint16_t start = i;
+            uint16_t literals = 0;
+            while (i < width && literals < 128 && !(i + 1 < width && row[i + 1] == row[i]))
+            {
+                i++;
+                literals++;
+            }
+            if (length + 1 + 2 * literals > room)
+            {
+                return 0;
+            }
+            out[length++] = literals - 1;
+            memcpy(out + length, &row[start], 2 * literals);
+            length += 2 * literals;
+        }
+        return length;
+    }
+
+    // Decompresses a row, returns the position of the next one
+    const uint8_t *decodeRow(const uint8_t *in, uint16_t *row, uint16_t width)
+    {
+        uint16_t i = 0;
+        while (i < width)
+        {
+            uint8_t c = *in++;
+            if (c < 128)
+            {
+                memcpy(&row[i], in, 2 * (c + 1));
+                in += 2 * (c + 1);
+                i += c + 1;
+            }
+            else
+            {
+                uint16_t pixel;
+                memcpy(&pixel, in, 2);
+                in += 2;
+                for (uint8_t j = 0; j < c - 126; j++)
+                {
+                    row[i++] = pixel;
+                }
+            }
+        }
+        return in;
+    }
+
+    TFT_eSprite *createBand(TFT_eSPI *tft)
+    {
+        TFT_eSprite *band = new TFT_eSprite(tft);
+        band->setColorDepth(16);
+        if (band->createSprite(Layout::SCREEN_WIDTH, BAND) == nullptr)
+        {
+            delete band;
+            return nullptr;
+        }
+        return band;
+    }
+
+    void deleteBand(TFT_eSprite *band)
+    {
+        band->deleteSprite();
+        delete band;
+    }
+
+    /**
+     * @brief Renders the static layer of a screen off-screen and stores it compressed, evicting old snapshots
+     *
+     * @return false if it doesn't fit the budget or memory
+     */
+    bool capture(TFT_eSPI *tft, uint32_t key, const ButtonWidget::Spec *widgets, uint8_t n, uint16_t background)
+    {
+        if (contains(key) || isRejected(key))
+        {
+            return contains(key);
+        }
+        uint32_t start = micros();
+        TFT_eSprite *band = createBand(tft);
+        if (band == nullptr)
+        {
+            return false;
+        }
+        uint8_t *data = nullptr;
+        uint32_t capacity = 0;
+        uint32_t size = 0;
+        bool fits = true;
+        // Touch positions are not used while drawing
+        uint16_t touch = 0;
+        for (uint16_t y = 0; y < Layout::SCREEN_HEIGHT && fits; y += BAND)
+        {
+            band->fillSprite(background);
+            for (uint8_t i = 0; i < n; i++)
+            {
+                // Tooltips can sit around the widget, keep a margin
+                if (widgets[i].endy + 64 < y || widgets[i].starty > y + BAND + 64)
+                {
+                    continue;
+                }
+                ButtonWidget btn(&touch, &touch, tft, widgets[i]);
+                btn.drawTo(band, 0, y);
+            }
+            const uint16_t *pixels = (const uint16_t *)band->getPointer();
+            for (uint16_t row = 0; row < BAND && fits; row++)
+            {
+                // Worst case of a row is all literals
+                uint32_t worst = Layout::SCREEN_WIDTH * 2 + (Layout::SCREEN_WIDTH + 127) / 128;
+                if (capacity - size < worst)
+                {
+                    uint32_t grown = capacity + GROW < budget ? capacity + GROW : budget;
+                    uint8_t *bigger = grown - size < worst ? nullptr : (uint8_t *)heap_caps_realloc(data, grown, caps);
+                    if (bigger == nullptr)
+                    {
+                        fits = false;
+                        break;
+                    }
+                    data = bigger;
+                    capacity = grown;
+                }
+                size += encodeRow(pixels + row * Layout::SCREEN_WIDTH, Layout::SCREEN_WIDTH, data + size, capacity - size);
+            }
+        }
+        deleteBand(band);
+        if (!fits)
+        {
+            heap_caps_free(data);
+            if (rejectedCount < MAX_ENTRIES)
+            {
+                rejected[rejectedCount++] = key;
+            }
+            debugln("[snapshot.h] screen too large for the snapshot budget");
+            return false;
+        }
+        uint8_t *shrunk = (uint8_t *)heap_caps_realloc(data, size, caps);
+        data = shrunk != nullptr ? shrunk : data;
+        save(*insert(key, data, size));
+        captures++;
+        captureUs += micros() - start;
+        debug("[snapshot.h] captured screen in ");
+        debug(size);
+        debug(" bytes (");
+        debug(size * 100 / (Layout::SCREEN_WIDTH * Layout::SCREEN_HEIGHT * 2));
+        debugln("% of raw)");
+        return true;
+    }
+
+    /**
+     * @brief Streams the snapshot of key to the panel, loading it from LittleFS if it isn't in RAM
+     *
+     * @return false if there is no snapshot for key
+     */
+    bool restore(TFT_eSPI *tft, uint32_t key)
+    {
+        Entry_s *entry = find(key);
+        if (entry == nullptr)
+        {
+            entry = load(key);
+        }
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        uint32_t start = micros();
+        TFT_eSprite *band = createBand(tft);
+        if (band == nullptr)
+        {
+            return false;
+        }
+        entry->lastUse = ++useCounter;
+        const uint8_t *in = entry->data;
+        uint16_t *pixels = (uint16_t *)band->getPointer();
+        for (uint16_t y = 0; y < Layout::SCREEN_HEIGHT; y += BAND)
+        {
+            for (uint16_t row = 0; row < BAND; row++)
+            {
+                in = decodeRow(in, pixels + row * Layout::SCREEN_WIDTH, Layout::SCREEN_WIDTH);
+            }
+            band->pushSprite(0, y);
+        }
+        deleteBand(band);
+        restores++;
+        restoreUs += micros() - start;
+        return true;
+    }
+
+    // Frees every snapshot in RAM, the files stay
+    void clear()
+    {
+        while (count > 0)
+        {
+            evict(count - 1);
+        }
+        rejectedCount = 0;
+    }
+
+    // Prints the statistics since the last call
+    void report()
+    {
+        debug("[snapshot.h] ");
+        debug(count);
+        debug(" snapshots, ");
+        debug(used);
+        debug("/");
+        debug(budget);
+        debug(" bytes, restores: ");
+        debug(restores);
+        debug(" (avg us ");
+        debug(restores > 0 ? (uint32_t)(restoreUs / restores) : 0);
+        debug("), captures: ");
+        debug(captures);
+        debug(" (avg us ");
+        debug(captures > 0 ? (uint32_t)(captureUs / captures) : 0);
+        debug("), loads: ");
+        debug(loads);
+        debug(" (avg us ");
+        debug(loads > 0 ? (uint32_t)(loadUs / loads) : 0);
+        debugln(")");
+        restores = 0;
+        restoreUs = 0;
+        captures = 0;
+        captureUs = 0;
+        loads = 0;
+        loadUs = 0;
+    }
+};
+
+#endif
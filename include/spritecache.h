@@ -0,0 +1,207 @@
+/**
+ * @file spritecache.h
+ * @author Riccardo Iacob
+ * @brief LRU cache of pre-rendered widget sprites within a RAM budget
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef SPRITECACHE_H
+#define SPRITECACHE_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "debug.h"
+
+namespace SpriteCache
+{
+    const uint8_t MAX_ENTRIES = 16;
+
+    struct Entry_s
+    {
+        uint32_t key;
+        TFT_eSprite *sprite;
+        int16_t x;
+        int16_t y;
+        uint32_t bytes;
+        uint32_t lastUse;
+        // Time it took to render the sprite on the miss
+        uint32_t renderUs;
+        // Not pushed yet, the first push completes the miss
+        bool fresh;
+    };
+
+    // RAM allowed for sprites (16 bit color, 2 bytes per pixel)
+    uint32_t budget = 64 * 1024;
+    uint32_t used = 0;
+    Entry_s entries[MAX_ENTRIES];
+    uint8_t count = 0;
+    uint32_t useCounter = 0;
+    // Value of useCounter when the current frame started
+    uint32_t frameStart = 0;
+
+    // Statistics since the last report
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t evictions = 0;
+    uint32_t frames = 0;
+    // Sum over hits of the render time of the miss minus the time of the push, negative if pushing costs more
+    int64_t savedUs = 0;
+
+    Entry_s *get(uint32_t key);
+    Entry_s *create(TFT_eSPI *tft, uint32_t key, int16_t x, int16_t y, int16_t w, int16_t h);
+    void push(Entry_s *entry);
+
+    // Returns the cached sprite for key, or nullptr (counted as a miss)
+    Entry_s *get(uint32_t key)
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (entries[i].key == key)
+            {
+                entries[i].lastUse = ++useCounter;
+                hits++;
+                return &entries[i];
+            }
+        }
+        misses++;
+        return nullptr;
+    }
+
+    void evict(uint8_t index)
+    {
+        entries[index].sprite->deleteSprite();
+        delete entries[index].sprite;
+        used -= entries[index].bytes;
+        entries[index] = entries[--count];
+        evictions++;
+    }
+
+    // Index of the least recently used entry
+    uint8_t oldest()
+    {
+        uint8_t oldest = 0;
+        for (uint8_t i = 1; i < count; i++)
+        {
+            if (entries[i].lastUse < entries[oldest].lastUse)
+            {
+                oldest = i;
+            }
+        }
+        return oldest;
+    }
+
+    // Marks the start of a frame, sprites used from now on are not evicted to make room for new ones
+    void beginFrame()
+    {
+        frameStart = useCounter;
+        frames++;
+    }
+
+    /**
+     * @brief Allocates a sprite for key covering the given screen area, evicting old entries as needed
+     *
+     * @return Entry_s*: New entry to render into, nullptr if it doesn't fit the budget or memory
+     */
+    Entry_s *create(TFT_eSPI *tft, uint32_t key, int16_t x, int16_t y, int16_t w, int16_t h)
+    {
+        uint32_t bytes = (uint32_t)w * h * 2;
+        if (w <= 0 || h <= 0 || bytes > budget)
+        {
+            return nullptr;
+        }
+        while (count > 0 && (used + bytes > budget || count >= MAX_ENTRIES))
+        {
+            uint8_t victim = oldest();
+            // A screen larger than the budget would otherwise evict its own sprites in a loop and never hit
+            if (entries[victim].lastUse > frameStart)
+            {
+                return nullptr;
+            }
+            evict(victim);
+        }
+        TFT_eSprite *sprite = new TFT_eSprite(tft);
+        sprite->setColorDepth(16);
+        if (sprite->createSprite(w, h) == nullptr)
+        {
+            delete sprite;
+            return nullptr;
+        }
+        Entry_s &entry = entries[count++];
+        entry.key = key;
+        entry.sprite = sprite;
+        entry.x = x;
+        entry.y = y;
+        entry.bytes = bytes;
+        entry.lastUse = ++useCounter;
+        entry.renderUs = 0;
+        entry.fresh = true;
+        used += bytes;
+        return &entry;
+    }
+
+    // Draws a cached sprite on the screen
+    void push(Entry_s *entry)
+    {
+        uint32_t start = micros();
+        entry->sprite->pushSprite(entry->x, entry->y);
+        uint32_t pushUs = micros() - start;
+        if (!entry->fresh)
+        {
+            savedUs += (int32_t)entry->renderUs - (int32_t)pushUs;
+        }
+        entry->fresh = false;
+    }
+
+    // Average time saved per frame since the last report
+    int32_t savedPerFrameUs()
+    {
+        return frames > 0 ? (int32_t)(savedUs / frames) : 0;
+    }
+
+    // Frees every sprite, e.g. after a theme change
+    void clear()
+    {
+        while (count > 0)
+        {
+            evict(count - 1);
+        }
+    }
+
+    // Changes the budget, evicting entries that no longer fit
+    void setBudget(uint32_t bytes)
+    {
+        budget = bytes;
+        while (count > 0 && used > budget)
+        {
+            evict(oldest());
+        }
+    }
+
+    // Prints the statistics since the last call
+    void report()
+    {
+        debug("[spritecache.h] ");
+        debug(count);
+        debug(" sprites, ");
+        debug(used);
+        debug("/");
+        debug(budget);
+        debug(" bytes, hit rate ");
+        debug(hits + misses > 0 ? hits * 100 / (hits + misses) : 0);
+        debug("%, evictions ");
+        debug(evictions);
+        debug(", saved ");
+        debug(savedPerFrameUs());
+        debugln(" us per frame");
+        hits = 0;
+        misses = 0;
+        evictions = 0;
+        frames = 0;
+        savedUs = 0;
+    }
+};
+
+#endif
@@ -13,12 +13,20 @@
 
 #include <Arduino.h>
 #include <TFT_eSPI.h>
+#include <driver/ledc.h>
 #include "greenhouse.h"
 #include "rtchelper.h"
 #include "buttonwidget.h"
 #include "globals.h"
 #include "icons.h"
+#include "layout.h"
+#include "alarms.h"
+#include "clock.h"
+#include "trace.h"
+#include "snapshot.h"
 #define TFT_GREY 0x5AEB
+#define TFT_ALARM TFT_YELLOW
+#define TFT_PROGRESS TFT_GREEN
 
 namespace TFT
 {
@@ -43,22 +51,103 @@ namespace TFT
     uint16_t touchy = 0;
     // Timer for touch debouncing
     long last_ms = millis();
+    // Set when touchx and touchy were provided by a replay instead of the panel
+    bool touchInjected = false;
+    // Last user interaction, drives backlight dimming
+    uint32_t lastActivityMs = 0;
+    // Backlight duty levels
+    const uint8_t BACKLIGHT_FULL = 255;
+    const uint8_t BACKLIGHT_DIM = 40;
+    const uint8_t BACKLIGHT_OFF = 0;
+    uint8_t backlight = BACKLIGHT_FULL;
+
+    // Rendering is paced to one frame per FRAME_MS, invalidations in between are merged
+    const uint32_t FRAME_MS = 33;
+    // Interval between frame statistics reports
+    const uint32_t STATS_INTERVAL = 60000;
+    // Whole screen needs to be redrawn
+    bool dirtyScreen = false;
+    // Widgets (by index in the current layout) whose static part or value needs to be redrawn
+    uint32_t dirtyWidgets = 0;
+    uint32_t dirtyValues = 0;
+    // Invalidations caused by the user, drawn before background updates
+    bool urgentScreen = false;
+    uint32_t urgentWidgets = 0;
+    uint32_t lastFrameMs = 0;
+    // Progress of a background task (see ota.h) in permille, shown as a bar at the bottom of the screen
+    const int16_t PROGRESS_HIDDEN = -1;
+    int16_t progress = PROGRESS_HIDDEN;
+    // Part of the bar already on the panel, the bar is only extended
+    int16_t progressDrawn = 0;
+    bool dirtyProgress = false;
+    // The current screen was drawn from primitives, snapshot it once the display is idle
+    bool pendingCapture = false;
+    // Frame statistics since the last report
+    uint32_t statsMs = 0;
+    uint32_t frames = 0;
+    uint32_t droppedFrames = 0;
+    uint32_t coalesced = 0;
+    uint32_t deferred = 0;
+    uint32_t maxFrameUs = 0;
+    uint64_t totalFrameUs = 0;
+    // Full screen redraws by path, from a snapshot or from primitives
+    uint32_t snapshotSwitches = 0;
+    uint64_t snapshotSwitchUs = 0;
+    uint32_t primitiveSwitches = 0;
+    uint64_t primitiveSwitchUs = 0;
+
+    // Widgets of a screen
+    struct Screen_s
+    {
+        const ButtonWidget::Spec *widgets;
+        uint8_t count;
+        uint16_t background;
+    };
 
     void doSetup();
     void setState(TFTStates screen);
     void IRAM_ATTR touchISR();
     void doTick();
     void resetTouch();
+    void injectTouch(uint16_t x, uint16_t y);
+    void setBacklight(uint8_t level);
+    uint32_t nextDeadline();
+    void drawValue(const ButtonWidget::Spec &spec, uint16_t background);
+    void invalidateAll(bool urgent);
+    void invalidateWidget(uint8_t index, bool urgent);
+    void invalidateChannels(bool widgets);
+    void render();
+    Screen_s currentScreen();
+    void setProgress(int16_t permille);
+    void handleTouch();
+    void reportFrames();
 
-    // initialize tft and show idle screen
+    // initialize tft, the first screen is drawn by the boot sequence once cached data is loaded
     void doSetup()
     {
         uint16_t calData[5] = {338, 3387, 343, 3489, 4};
         tft.setTouch(calData);
-        attachInterrupt(22, touchISR, CHANGE);
+        attachInterrupt(Globals::touchIrqPin, touchISR, CHANGE);
         tft.init();
         tft.setRotation(0);
-        setState(TFTStates::IDLE);
+        // The backlight PWM runs from the RTC 8MHz clock so it keeps going during light sleep
+        ledc_timer_config_t timer = {};
+        timer.speed_mode = LEDC_LOW_SPEED_MODE;
+        timer.duty_resolution = LEDC_TIMER_8_BIT;
+        timer.timer_num = LEDC_TIMER_0;
+        timer.freq_hz = 5000;
+        timer.clk_cfg = LEDC_USE_RTC8M_CLK;
+        ledc_timer_config(&timer);
+        ledc_channel_config_t channel = {};
+        channel.gpio_num = Globals::backlightPin;
+        channel.speed_mode = LEDC_LOW_SPEED_MODE;
+        channel.channel = LEDC_CHANNEL_0;
+        channel.intr_type = LEDC_INTR_DISABLE;
+        channel.timer_sel = LEDC_TIMER_0;
+        channel.duty = BACKLIGHT_FULL;
+        ledc_channel_config(&channel);
+        lastActivityMs = Clock::now();
+        Snapshot::doSetup();
         debugln("[tfthelper.h] setup completed");
     }
 
@@ -74,29 +163,110 @@ namespace TFT
         if (touchPressed)
         {
             // Debouncing of touch position
-            if ((millis() - last_ms >= 500) || (touchx <= 0 && touchy <= 0))
+            if (touchInjected)
+            {
+                touchInjected = false;
+                last_ms = Clock::now();
+            }
+            else if ((Clock::now() - last_ms >= 500) || (touchx <= 0 && touchy <= 0))
             {
                 tft.getTouch(&touchx, &touchy);
-                last_ms = millis();
+                last_ms = Clock::now();
+            }
+            Trace::recordTouch(touchx, touchy);
+            lastActivityMs = Clock::now();
+            // The first touch on a dark screen only turns the backlight back on
+            if (backlight == BACKLIGHT_OFF)
+            {
+                setBacklight(BACKLIGHT_FULL);
+                resetTouch();
+                touchPressed = false;
+                return;
             }
+            setBacklight(BACKLIGHT_FULL);
             debug("[tfthelper.h] touch pressed at ");
             debug(touchx);
             debug(" ");
             debugln(touchy);
-            // Refresh the screen
-            setState(stateCurrent);
             touchPressed = false;
+            handleTouch();
         }
         if (newData)
         {
             debugln("[tfthelper.h] new data available");
-            // Refresh the screen if in idle state (homepage)
-            if (stateCurrent == TFTStates::IDLE)
+            // Only the values change
+            invalidateChannels(false);
+            newData = false;
+        }
+        if (Alarms::changed)
+        {
+            debugln("[tfthelper.h] alarm state changed");
+            // Highlighted widgets change background
+            invalidateChannels(true);
+            Alarms::changed = false;
+        }
+        if ((dirtyScreen || dirtyWidgets || dirtyValues || dirtyProgress) && Clock::now() - lastFrameMs >= FRAME_MS)
+        {
+            render();
+        }
+        else if (pendingCapture && !(dirtyScreen || dirtyWidgets || dirtyValues || dirtyProgress))
+        {
+            pendingCapture = false;
+            Screen_s screen = currentScreen();
+            if (screen.widgets != nullptr)
             {
-                setState(stateCurrent);
+                Snapshot::capture(&tft, Snapshot::key(screen.widgets, screen.count, screen.background), screen.widgets, screen.count, screen.background);
             }
-            newData = false;
         }
+        if (Clock::now() - statsMs >= STATS_INTERVAL)
+        {
+            reportFrames();
+        }
+        // Dim and then turn off the backlight after inactivity
+        uint32_t idleMs = Clock::now() - lastActivityMs;
+        if (idleMs >= (uint32_t)Globals::blankDelay)
+        {
+            setBacklight(BACKLIGHT_OFF);
+        }
+        else if (idleMs >= (uint32_t)Globals::dimDelay)
+        {
+            setBacklight(BACKLIGHT_DIM);
+        }
+    }
+
+    void setBacklight(uint8_t level)
+    {
+        if (level == backlight)
+        {
+            return;
+        }
+        backlight = level;
+        ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, level);
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
+    }
+
+    // time at which doTick has work to do next (now if something is pending)
+    uint32_t nextDeadline()
+    {
+        uint32_t now = Clock::now();
+        if (touchPressed || newData || Alarms::changed || pendingCapture)
+        {
+            return now;
+        }
+        if (dirtyScreen || dirtyWidgets || dirtyValues || dirtyProgress)
+        {
+            return lastFrameMs + FRAME_MS;
+        }
+        if (backlight == BACKLIGHT_FULL)
+        {
+            return lastActivityMs + Globals::dimDelay;
+        }
+        if (backlight == BACKLIGHT_DIM)
+        {
+            return lastActivityMs + Globals::blankDelay;
+        }
+        // Nothing scheduled, only a touch can wake the display
+        return now + 0x7FFFFFFF;
     }
 
     void resetTouch()
@@ -105,132 +275,367 @@ namespace TFT
         touchy = 0;
     }
 
-    // set finite state of tft
-    void setState(TFTStates screen)
+    // simulates a touch at the given position (used by replays)
+    void injectTouch(uint16_t x, uint16_t y)
     {
-        stateCurrent = screen;
-        debug("[tfthelper.h] screen set to ");
-        switch (screen)
+        touchx = x;
+        touchy = y;
+        touchInjected = true;
+        touchPressed = true;
+    }
+
+    // widgets of the current screen
+    Screen_s currentScreen()
+    {
+        switch (stateCurrent)
         {
         case TFTStates::IDLE:
+            return {Layout::IDLE, sizeof(Layout::IDLE) / sizeof(Layout::IDLE[0]), Layout::IDLE_BACKGROUND};
+        case TFTStates::CONFIG:
+            return {Layout::CONFIG, sizeof(Layout::CONFIG) / sizeof(Layout::CONFIG[0]), Layout::CONFIG_BACKGROUND};
+        default:
+            return {nullptr, 0, TFT_BLACK};
+        }
+    }
+
+    // acts on a touch of the current screen
+    void handleTouch()
+    {
+        Screen_s screen = currentScreen();
+        uint8_t pressed = Layout::hitTest(screen.widgets, screen.count, touchx, touchy);
+        switch (pressed)
         {
-            debugln("IDLE");
-            tft.fillScreen(TFT_WHITE);
-
-            ButtonWidget* btnConfig = new ButtonWidget(&touchx, &touchy, &tft, 200, 350, 63, 63);
-            ButtonWidget* btnTemp1 = new ButtonWidget(&touchx, &touchy, &tft, 20, 0, 63, 63);
-            ButtonWidget* btnTemp2 = new ButtonWidget(&touchx, &touchy, &tft, 20, 70, 63, 63);
-            ButtonWidget* btnTemp3 = new ButtonWidget(&touchx, &touchy, &tft, 20, 135, 63, 63);
-            ButtonWidget* btnHum1 = new ButtonWidget(&touchx, &touchy, &tft, 170, 0, 63, 63);
-            ButtonWidget* btnHum2 = new ButtonWidget(&touchx, &touchy, &tft, 170, 70, 63, 63);
-            ButtonWidget* btnHum3 = new ButtonWidget(&touchx, &touchy, &tft, 170, 135, 63, 63);
-
-            btnConfig->setStyle(TFT_CYAN, TFT_BLACK, ButtonWidget::ButtonStyles::ELLIPSE);
-            btnTemp1->setStyle(TFT_WHITE, TFT_RED, ButtonWidget::ButtonStyles::ROUND_RECT);
-            btnTemp2->setStyle(TFT_WHITE, TFT_RED, ButtonWidget::ButtonStyles::ROUND_RECT);
-            btnTemp3->setStyle(TFT_WHITE, TFT_RED, ButtonWidget::ButtonStyles::ROUND_RECT);
-            btnHum1->setStyle(TFT_WHITE, TFT_BLUE, ButtonWidget::ButtonStyles::ROUND_RECT);
-            btnHum2->setStyle(TFT_WHITE, TFT_BLUE, ButtonWidget::ButtonStyles::ROUND_RECT);
-            btnHum3->setStyle(TFT_WHITE, TFT_BLUE, ButtonWidget::ButtonStyles::ROUND_RECT);
-
-            btnConfig->setIcon(ICONS_63X63::cog);
-            btnTemp1->setIcon(ICONS_63X63::thermometer);
-            btnTemp2->setIcon(ICONS_63X63::thermometer);
-            btnTemp3->setIcon(ICONS_63X63::thermometer);
-            btnHum1->setIcon(ICONS_63X63::humidity);
-            btnHum2->setIcon(ICONS_63X63::humidity);
-            btnHum3->setIcon(ICONS_63X63::humidity);
-
-            btnTemp1->setTooltip("Temp1", 2, 1, ButtonWidget::TooltipPositions::RIGHT, btnTemp1->getSizeX() / 4, TFT_PURPLE);
-            btnTemp2->setTooltip("Temp2", 2, 1, ButtonWidget::TooltipPositions::RIGHT, btnTemp2->getSizeX() / 4, TFT_PURPLE);
-            btnTemp3->setTooltip("Temp3", 2, 1, ButtonWidget::TooltipPositions::RIGHT, btnTemp3->getSizeX() / 4, TFT_PURPLE);
-            btnHum1->setTooltip("Hum1", 2, 1, ButtonWidget::TooltipPositions::RIGHT, btnHum1->getSizeX() / 4, TFT_PURPLE);
-            btnHum2->setTooltip("Hum2", 2, 1, ButtonWidget::TooltipPositions::RIGHT, btnHum2->getSizeX() / 4, TFT_PURPLE);
-            btnHum3->setTooltip("Hum3", 2, 1, ButtonWidget::TooltipPositions::RIGHT, btnHum3->getSizeX() / 4, TFT_PURPLE);
-
-            btnConfig->draw();
-            btnTemp1->draw();
-            btnTemp2->draw();
-            btnTemp3->draw();
-            btnHum1->draw();
-            btnHum2->draw();
-            btnHum3->draw();
-
-            if (btnConfig->isPressed())
+        case Layout::IDLE_CONFIG:
+            resetTouch();
+            debugln("[tfthelper.h] IDLE:CONFIG pressed");
+            setState(TFTStates::CONFIG);
+            break;
+        case Layout::CONFIG_BACK:
+            resetTouch();
+            debugln("[tfthelper.h] CONFIG:IDLE pressed");
+            setState(TFTStates::IDLE);
+            break;
+        case Layout::NONE:
+            break;
+        default:
+            // Touch feedback: redraw the touched widget ahead of background updates
+            for (uint8_t i = 0; i < screen.count; i++)
             {
-                resetTouch();
-                debugln("[tfthelper.h] IDLE:CONFIG pressed");
-                setState(TFTStates::CONFIG);
+                if (screen.widgets[i].id == pressed)
+                {
+                    invalidateWidget(i, true);
+                }
             }
+            break;
+        }
+    }
 
-            delete btnConfig;
-            delete btnTemp1;
-            delete btnTemp2;
-            delete btnTemp3;
-            delete btnHum1;
-            delete btnHum2;
-            delete btnHum3;
-
+    // requests a redraw of a widget of the current screen
+    void invalidateWidget(uint8_t index, bool urgent)
+    {
+        uint32_t bit = 1UL << index;
+        if (dirtyScreen || (dirtyWidgets & bit))
+        {
+            coalesced++;
+        }
+        dirtyWidgets |= bit;
+        dirtyValues |= bit;
+        if (urgent)
+        {
+            urgentWidgets |= bit;
+        }
+    }
 
-            break;
+    // requests a redraw of the whole screen
+    void invalidateAll(bool urgent)
+    {
+        if (dirtyScreen)
+        {
+            coalesced++;
         }
-        case TFTStates::CONFIG:
+        dirtyScreen = true;
+        urgentScreen |= urgent;
+    }
+
+    // requests a redraw of the widgets bound to a channel (widgets = false: only their values)
+    void invalidateChannels(bool widgets)
+    {
+        Screen_s screen = currentScreen();
+        for (uint8_t i = 0; i < screen.count; i++)
         {
-            debugln("CONFIG");
+            if (screen.widgets[i].channel == Layout::NONE)
+            {
+                continue;
+            }
+            uint32_t bit = 1UL << i;
+            if (dirtyScreen || ((widgets ? dirtyWidgets : dirtyValues) & bit))
+            {
+                coalesced++;
+            }
+            if (widgets)
+            {
+                dirtyWidgets |= bit;
+            }
+            dirtyValues |= bit;
+        }
+    }
 
-            tft.fillScreen(TFT_BLACK);
+    // draws a widget of the current screen, highlighted if its channel is in alarm
+    void drawWidget(const ButtonWidget::Spec &spec, uint16_t background)
+    {
+        ButtonWidget btn(&touchx, &touchy, &tft, spec);
+        btn.setCanvasColor(background);
+        if (Alarms::isActive(spec.channel))
+        {
+            btn.setStyle(TFT_ALARM, spec.fgcolor, spec.style, spec.cornerradius);
+        }
+        btn.draw();
+    }
 
-            ButtonWidget* btnBack = new ButtonWidget(&touchx, &touchy, &tft, 200, 350, 100, 100);
-            ButtonWidget* btnConfig = new ButtonWidget(&touchx, &touchy, &tft, 100, 350, 100, 100);
+    // print the current reading of the channel bound to a widget
+    void drawValue(const ButtonWidget::Spec &spec, uint16_t background)
+    {
+        if (spec.channel == Layout::NONE)
+        {
+            return;
+        }
+        uint16_t color = TFT_BLACK;
+        if (Alarms::isActive(spec.channel))
+        {
+            color = TFT_RED;
+        }
+        else if (Greenhouse::data.quality[spec.channel] != Greenhouse::QUALITY_OK)
+        {
+            color = TFT_GREY;
+        }
+        // Format the fixed point value without going through float
+        int16_t value = Greenhouse::data.values[spec.channel];
+        uint16_t magnitude = abs(value);
+        char text[16];
+        snprintf(text, sizeof(text), "%s%u.%02u%s", value < 0 ? "-" : "", magnitude / Greenhouse::SCALE, magnitude % Greenhouse::SCALE, Greenhouse::getUnit(spec.channel));
+        tft.setTextFont(spec.tooltipFont);
+        tft.setTextSize(spec.tooltipFontSize);
+        tft.setTextColor(color, background);
+        tft.setTextDatum(TL_DATUM);
+        tft.setTextPadding(Layout::VALUE_WIDTH);
+        tft.drawString(text, Layout::valueX(spec), Layout::valueY(spec));
+        tft.setTextPadding(0);
+    }
 
-            btnBack->setStyle(TFT_PURPLE, TFT_WHITE, ButtonWidget::ButtonStyles::ROUND_RECT, 15);
+    // draws the touch calibration screen and prints the calibration data
+    void drawCalibration()
+    {
+        uint16_t calData[5];
+        tft.fillScreen(TFT_BLACK);
+        tft.setCursor(20, 0);
+        tft.setTextFont(2);
+        tft.setTextSize(1);
+        tft.setTextColor(TFT_WHITE, TFT_BLACK);
+        tft.println("Touch corners as indicated");
+        tft.setTextFont(1);
+        tft.println();
+        tft.calibrateTouch(calData, TFT_MAGENTA, TFT_BLACK, 15);
+        debug("[tfthelper.h] calibration values { ");
+        for (uint8_t i = 0; i < 5; i++)
+        {
+            debug(calData[i]);
+            if (i < 4)
+                debug(", ");
+        }
+        debugln(" };");
+        tft.fillScreen(TFT_BLACK);
+        tft.setTextColor(TFT_GREEN, TFT_BLACK);
+        tft.println("Calibration complete!");
+        tft.println("Calibration code sent to Serial port.");
+    }
 
-            btnBack->setText("Back", 2, 1);
-            btnConfig->setText("Spinbox",2,1);
+    // extends the progress bar up to the current progress, or clears it
+    void drawProgress(uint16_t background)
+    {
+        dirtyProgress = false;
+        if (progress == PROGRESS_HIDDEN || progress < progressDrawn)
+        {
+            tft.fillRect(0, Layout::PROGRESS_Y, Layout::SCREEN_WIDTH, Layout::PROGRESS_HEIGHT, background);
+            progressDrawn = 0;
+        }
+        if (progress > progressDrawn)
+        {
+            int16_t from = (int32_t)progressDrawn * Layout::SCREEN_WIDTH / 1000;
+            int16_t to = (int32_t)progress * Layout::SCREEN_WIDTH / 1000;
+            tft.fillRect(from, Layout::PROGRESS_Y, to - from, Layout::PROGRESS_HEIGHT, TFT_PROGRESS);
+            progressDrawn = progress;
+        }
+    }
 
-            btnBack->draw();
-            btnConfig->draw();
+    // Shows the progress bar at permille (0 to 1000), PROGRESS_HIDDEN removes it
+    void setProgress(int16_t permille)
+    {
+        if (permille == progress)
+        {
+            return;
+        }
+        progress = permille;
+        dirtyProgress = true;
+    }
 
-            if (btnBack->isPressed())
+    /**
+     * @brief Draws everything invalidated since the last frame. Touch-caused work goes first,
+     * background updates that don't fit in the frame budget are left for the next frame.
+     *
+     */
+    void render()
+    {
+        uint32_t start = micros();
+        Screen_s screen = currentScreen();
+        SpriteCache::beginFrame();
+        if (dirtyScreen)
+        {
+            if (stateCurrent == TFTStates::TFT_CALIBRATION)
             {
-                resetTouch();
-                debugln("[tfthelper.h] CONFIG:IDLE pressed");
-                setState(TFTStates::IDLE);
+                drawCalibration();
             }
-
-            delete btnBack;
-            delete btnConfig;
-
-            break;
+            else
+            {
+                uint32_t key = Snapshot::key(screen.widgets, screen.count, screen.background);
+                if (Snapshot::restore(&tft, key))
+                {
+                    // The snapshot has the widgets in their normal style and no values
+                    for (uint8_t i = 0; i < screen.count; i++)
+                    {
+                        if (Alarms::isActive(screen.widgets[i].channel))
+                        {
+                            drawWidget(screen.widgets[i], screen.background);
+                        }
+                        drawValue(screen.widgets[i], screen.background);
+                    }
+                    snapshotSwitches++;
+                    snapshotSwitchUs += micros() - start;
+                }
+                else
+                {
+                    tft.fillScreen(screen.background);
+                    for (uint8_t i = 0; i < screen.count; i++)
+                    {
+                        drawWidget(screen.widgets[i], screen.background);
+                        drawValue(screen.widgets[i], screen.background);
+                    }
+                    primitiveSwitches++;
+                    primitiveSwitchUs += micros() - start;
+                    pendingCapture = !Snapshot::isRejected(key);
+                }
+                progressDrawn = 0;
+                dirtyProgress = progress != PROGRESS_HIDDEN;
+            }
+            dirtyScreen = false;
+            urgentScreen = false;
+            dirtyWidgets = 0;
+            dirtyValues = 0;
+            urgentWidgets = 0;
         }
-        case TFTStates::TFT_CALIBRATION:
+        else
         {
-            uint16_t calData[5];
-            uint8_t calDataOK = 0;
-            tft.fillScreen(TFT_BLACK);
-            tft.setCursor(20, 0);
-            tft.setTextFont(2);
-            tft.setTextSize(1);
-            tft.setTextColor(TFT_WHITE, TFT_BLACK);
-            tft.println("Touch corners as indicated");
-            tft.setTextFont(1);
-            tft.println();
-            tft.calibrateTouch(calData, TFT_MAGENTA, TFT_BLACK, 15);
-            debug("[tfthelper.h] calibration values { ");
-            for (uint8_t i = 0; i < 5; i++)
+            // First pass draws urgent widgets, second pass the rest while the budget allows
+            for (uint8_t pass = 0; pass < 2; pass++)
             {
-                debug(calData[i]);
-                if (i < 4)
-                    debug(", ");
+                for (uint8_t i = 0; i < screen.count; i++)
+                {
+                    uint32_t bit = 1UL << i;
+                    bool urgent = urgentWidgets & bit;
+                    if (!((dirtyWidgets | dirtyValues) & bit) || urgent != (pass == 0))
+                    {
+                        continue;
+                    }
+                    if (pass == 1 && micros() - start >= FRAME_MS * 1000)
+                    {
+                        deferred++;
+                        continue;
+                    }
+                    if (dirtyWidgets & bit)
+                    {
+                        drawWidget(screen.widgets[i], screen.background);
+                    }
+                    drawValue(screen.widgets[i], screen.background);
+                    dirtyWidgets &= ~bit;
+                    dirtyValues &= ~bit;
+                    urgentWidgets &= ~bit;
+                }
             }
-            debugln(" };");
-            tft.fillScreen(TFT_BLACK);
-            tft.setTextColor(TFT_GREEN, TFT_BLACK);
-            tft.println("Calibration complete!");
-            tft.println("Calibration code sent to Serial port.");
-            break;
         }
+        if (dirtyProgress && stateCurrent != TFTStates::TFT_CALIBRATION)
+        {
+            drawProgress(screen.background);
+        }
+        uint32_t frameUs = micros() - start;
+        frames++;
+        totalFrameUs += frameUs;
+        if (frameUs > maxFrameUs)
+        {
+            maxFrameUs = frameUs;
+        }
+        // The frame took longer than its slot, so the next one is late
+        if (frameUs > FRAME_MS * 1000)
+        {
+            droppedFrames++;
+        }
+        lastFrameMs = Clock::now();
+    }
+
+    // prints the frame statistics since the last call
+    void reportFrames()
+    {
+        debug("[tfthelper.h] frames: ");
+        debug(frames);
+        debug(", avg/max us: ");
+        debug(frames > 0 ? (uint32_t)(totalFrameUs / frames) : 0);
+        debug("/");
+        debug(maxFrameUs);
+        debug(", dropped: ");
+        debug(droppedFrames);
+        debug(", coalesced: ");
+        debug(coalesced);
+        debug(", deferred: ");
+        debugln(deferred);
+        debug("[tfthelper.h] screen switches from snapshot/primitives: ");
+        debug(snapshotSwitches);
+        debug("/");
+        debug(primitiveSwitches);
+        debug(", avg us: ");
+        debug(snapshotSwitches > 0 ? (uint32_t)(snapshotSwitchUs / snapshotSwitches) : 0);
+        debug("/");
+        debugln(primitiveSwitches > 0 ? (uint32_t)(primitiveSwitchUs / primitiveSwitches) : 0);
+        SpriteCache::report();
+        Snapshot::report();
+        statsMs = Clock::now();
+        frames = 0;
+        droppedFrames = 0;
+        coalesced = 0;
+        deferred = 0;
+        maxFrameUs = 0;
+        totalFrameUs = 0;
+        snapshotSwitches = 0;
+        snapshotSwitchUs = 0;
+        primitiveSwitches = 0;
+        primitiveSwitchUs = 0;
+    }
+
+    // set finite state of tft, the screen is drawn on the next frame
+    void setState(TFTStates screen)
+    {
+        stateCurrent = screen;
+        debug("[tfthelper.h] screen set to ");
+        switch (screen)
+        {
+        case TFTStates::IDLE:
+            debugln("IDLE");
+            break;
+        case TFTStates::CONFIG:
+            debugln("CONFIG");
+            break;
+        case TFTStates::TFT_CALIBRATION:
+            debugln("TFT_CALIBRATION");
+            break;
         }
+        invalidateAll(true);
     }
 };
 
@@ -0,0 +1,211 @@
+/**
+ * @file timesync.h
+ * @author Riccardo Iacob
+ * @brief Master time authority: estimates the clock offset and drift of every slave and stamps their readings
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Every poll is a beacon carrying the master time T1 (Clock::now()). The slave answers with the time it
+ * received the beacon (t2), the time it sent the reply (t3) and the time its readings were taken, all on
+ * its own clock. With T4 the reception time of the reply on the master:
+ *   offset = ((t2 - T1) + (t3 - T4)) / 2    slave clock minus master clock
+ *   rtt    = (T4 - T1) - (t3 - t2)
+ * The offset is tracked as a line (offset at a reference time, drift in ppm), corrected by a fraction of
+ * the residual at every exchange. It is kept as whole milliseconds modulo 2^32 plus a float below one
+ * millisecond, a float alone would lose the fraction once offsets pass 2^24 ms (4.6 hours). Each measured
+ * offset has the whole milliseconds taken off in wrapping integer arithmetic first, so the residual, the
+ * filtered offset and the drift fit are floats of a few milliseconds and keep their fraction. The drift
+ * comes from the filtered offset over DRIFT_INTERVAL, over a single poll period the round trip noise would
+ * swamp it. Exchanges with a round trip well above the best recent one are discarded, their delays are
+ * likely asymmetric. The error bound of a converted time also covers the drift of the master clock from
+ * the DS3231, which the stamp goes through (RTC::driftBoundMs).
+ */
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include <Arduino.h>
+#include "debug.h"
+#include "clock.h"
+#include "greenhouse.h"
+#include "rtchelper.h"
+
+namespace TimeSync
+{
+    const uint8_t MAX_SLAVES = 4;
+    // Round trips above this can't give a useful offset
+    const uint32_t MAX_RTT = 200;
+    // Round trips up to twice the best one plus this are accepted
+    const uint32_t RTT_SLACK = 20;
+    // Share of the residual applied to the offset at every exchange, and of a new drift measurement
+    const float OFFSET_GAIN = 0.25f;
+    const float DRIFT_GAIN = 0.5f;
+    // Baseline of a drift measurement
+    const uint32_t DRIFT_INTERVAL = 600000;
+    // Margin on the drift estimate when extrapolating, crystals wander with temperature
+    const uint32_t DRIFT_MARGIN_PPM = 5;
+
+    struct Slave_s
+    {
+        bool synced;
+        // Offset (slave - master) at refMs on the master clock: whole ms, wrapping like the clocks, plus offset
+        uint32_t baseMs;
+        float offset;
+        float driftPpm;
+        uint32_t refMs;
+        // Start of the current drift measurement, relative to baseMs
+        float anchorOffset;
+        uint32_t anchorMs;
+        bool driftKnown;
+        // Best round trip seen, slowly forgotten so a slower link is eventually accepted
+        uint32_t minRtt;
+        uint32_t rtt;
+        // Smoothed absolute residual, i.e. how well the line predicts the slave clock
+        float jitter;
+        uint32_t exchanges;
+        uint32_t rejected;
+    };
+
+    Slave_s slaves[MAX_SLAVES];
+
+    bool exchange(const Greenhouse::Stamp_s &stamp, uint32_t t4);
+    uint32_t toMaster(uint8_t slave, uint32_t slaveMs, uint16_t &errorMs);
+    void stamp(uint32_t masterMs, uint16_t errorMs, Greenhouse::Data_s &out);
+
+    // Moves the whole milliseconds of the offset into the base
+    void rebase(Slave_s &s)
+    {
+        int32_t whole = (int32_t)s.offset;
+        s.baseMs += whole;
+        s.offset -= whole;
+        s.anchorOffset -= whole;
+    }
+
+    /**
+     * @brief Updates the clock model of a slave with a beacon round trip
+     *
+     * @param t4: Reception time of the reply on the master clock
+     * @return false if the exchange was discarded
+     */
+    bool exchange(const Greenhouse::Stamp_s &stamp, uint32_t t4)
+    {
+        if (stamp.slave >= MAX_SLAVES)
+        {
+            return false;
+        }
+        Slave_s &s = slaves[stamp.slave];
+        int32_t rtt = (int32_t)(t4 - stamp.beacon) - (int32_t)(stamp.sent - stamp.received);
+        if (rtt < 0 || (uint32_t)rtt > MAX_RTT || (s.synced && (uint32_t)rtt > 2 * s.minRtt + RTT_SLACK))
+        {
+            s.rejected++;
+            // Let the best round trip age, otherwise a lucky exchange would reject everything after it
+            s.minRtt++;
+            return false;
+        }
+        if (!s.synced || (uint32_t)rtt < s.minRtt)
+        {
+            s.minRtt = rtt;
+        }
+        s.rtt = rtt;
+        s.exchanges++;
+        // Midpoint of the exchange on the master clock
+        uint32_t atMs = stamp.beacon + (t4 - stamp.beacon) / 2;
+        if (!s.synced)
+        {
+            s.baseMs = stamp.received - stamp.beacon;
+        }
+        // Both halves relative to the base, small signed differences even when the clocks wrap
+        float measured = ((int32_t)(stamp.received - stamp.beacon - s.baseMs) + (int32_t)(stamp.sent - t4 - s.baseMs)) / 2.0f;
+        if (!s.synced)
+        {
+            s.synced = true;
+            s.offset = measured;
+            s.driftPpm = 0;
+            s.refMs = atMs;
+            s.anchorOffset = measured;
+            s.anchorMs = atMs;
+            s.driftKnown = false;
+            s.jitter = rtt / 2.0f;
+            rebase(s);
+            return true;
+        }
+        int32_t elapsed = (int32_t)(atMs - s.refMs);
+        float predicted = s.offset + s.driftPpm * elapsed / 1e6f;
+        float residual = measured - predicted;
+        s.offset = predicted + OFFSET_GAIN * residual;
+        s.refMs = atMs;
+        uint32_t baseline = atMs - s.anchorMs;
+        if (baseline >= DRIFT_INTERVAL)
+        {
+            float drift = (s.offset - s.anchorOffset) * 1e6f / baseline;
+            s.driftPpm = s.driftKnown ? s.driftPpm + DRIFT_GAIN * (drift - s.driftPpm) : drift;
+            s.driftKnown = true;
+            s.anchorOffset = s.offset;
+            s.anchorMs = atMs;
+        }
+        s.jitter += 0.25f * (fabsf(residual) - s.jitter);
+        rebase(s);
+        return true;
+    }
+
+    /**
+     * @brief Converts a time of a slave clock to the master clock
+     *
+     * @param errorMs: Bound of the error on the DS3231 timeline, Greenhouse::TIME_UNKNOWN for an unsynchronised slave
+     */
+    uint32_t toMaster(uint8_t slave, uint32_t slaveMs, uint16_t &errorMs)
+    {
+        if (slave >= MAX_SLAVES || !slaves[slave].synced)
+        {
+            errorMs = Greenhouse::TIME_UNKNOWN;
+            return Clock::now();
+        }
+        Slave_s &s = slaves[slave];
+        // First guess with the reference offset, then apply the drift from there
+        uint32_t guess = slaveMs - s.baseMs;
+        int32_t age = (int32_t)(guess - s.refMs);
+        uint32_t masterMs = slaveMs - s.baseMs - (int32_t)lroundf(s.offset + s.driftPpm * age / 1e6f);
+        uint32_t error = s.rtt / 2 + (uint32_t)s.jitter + 1 + (uint32_t)abs(age) / 1000 * DRIFT_MARGIN_PPM / 1000 +
+                         RTC::driftBoundMs(masterMs);
+        errorMs = error < Greenhouse::TIME_UNKNOWN ? error : Greenhouse::TIME_UNKNOWN - 1;
+        return masterMs;
+    }
+
+    // Stamps a reading with a master clock time
+    void stamp(uint32_t masterMs, uint16_t errorMs, Greenhouse::Data_s &out)
+    {
+        uint64_t epochMs = RTC::epochMs(masterMs);
+        out.time = epochMs / 1000;
+        out.timeMs = epochMs % 1000;
+        out.timeError = errorMs;
+    }
+
+    // Prints the clock model of every synchronised slave
+    void report()
+    {
+        for (uint8_t i = 0; i < MAX_SLAVES; i++)
+        {
+            if (!slaves[i].synced)
+            {
+                continue;
+            }
+            debug("[timesync.h] slave ");
+            debug(i);
+            debug(": offset ");
+            debug((int32_t)(slaves[i].baseMs + lroundf(slaves[i].offset)));
+            debug(" ms, drift ");
+            debug(slaves[i].driftPpm);
+            debug(" ppm, rtt ");
+            debug(slaves[i].rtt);
+            debug(" ms, jitter ");
+            debug(slaves[i].jitter);
+            debug(" ms, exchanges ");
+            debug(slaves[i].exchanges);
+            debug("/");
+            debugln(slaves[i].exchanges + slaves[i].rejected);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,300 @@
+/**
+ * @file trace.h
+ * @author Riccardo Iacob
+ * @brief Compact binary trace of radio frames, touches and clock ticks, see replay.h
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Format (little endian):
+ *   header: "GHTR", version (u8), start time in ms (u32)
+ *   record: type (u8), ms since the previous record (varint), payload
+ *     RECORD_TICK:  none
+ *     RECORD_FRAME: one zigzag varint per channel, delta from the previous frame
+ *     RECORD_TOUCH: x, y (varints)
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "debug.h"
+#include "clock.h"
+#include "greenhouse.h"
+
+// Record every session to TRACE_FILE
+#define TRACE_RECORD false
+#define TRACE_FILE "/trace.bin"
+
+namespace Trace
+{
+    constexpr uint8_t VERSION = 1;
+    // Interval between clock marks while recording
+    constexpr uint32_t TICK_INTERVAL = 1000;
+
+    enum Records : uint8_t
+    {
+        RECORD_TICK,
+        RECORD_FRAME,
+        RECORD_TOUCH
+    };
+
+    // Decoded record
+    struct Record_s
+    {
+        uint8_t type;
+        // Absolute time, on the clock of the recording
+        uint32_t ms;
+        int16_t frame[Greenhouse::CHANNEL_COUNT];
+        uint16_t x;
+        uint16_t y;
+    };
+
+    /**
+     * @brief Decodes a trace from a stream
+     *
+     */
+    struct Reader
+    {
+        Stream *in = nullptr;
+        uint32_t ms = 0;
+        int16_t frame[Greenhouse::CHANNEL_COUNT] = {0};
+
+        bool readVarint(uint32_t &value)
+        {
+            value = 0;
+            for (uint8_t shift = 0; shift < 35; shift += 7)
+            {
+                int c = in->read();
+                if (c < 0)
+                {
+                    return false;
+                }
+                value |= (uint32_t)(c & 0x7F) << shift;
+                if (!(c & 0x80))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Reads the header, returns false if the stream is not a trace
+        bool begin(Stream &stream)
+        {
+            in = &stream;
+            char magic[4];
+            for (uint8_t i = 0; i < 4; i++)
+            {
+                magic[i] = in->read();
+            }
+            if (memcmp(magic, "GHTR", 4) != 0 || in->read() != VERSION)
+            {
+                return false;
+            }
+            ms = 0;
+            for (uint8_t i = 0; i < 4; i++)
+            {
+                int c = in->read();
+                if (c < 0)
+                {
+                    return false;
+                }
+                ms |= (uint32_t)c << (8 * i);
+            }
+            memset(frame, 0, sizeof(frame));
+            return true;
+        }
+
+        // Reads the next record, returns false at the end of the trace
+        bool next(Record_s &r)
+        {
+            int type = in->read();
+            uint32_t dt;
+            if (type < 0 || !readVarint(dt))
+            {
+                return false;
+            }
+            ms += dt;
+            r.type = type;
+            r.ms = ms;
+            switch (type)
+            {
+            case RECORD_TICK:
+                return true;
+            case RECORD_FRAME:
+                for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+                {
+                    uint32_t zigzag;
+                    if (!readVarint(zigzag))
+                    {
+                        return false;
+                    }
+                    int32_t delta = (zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+                    frame[i] = (int16_t)(frame[i] + delta);
+                    r.frame[i] = frame[i];
+                }
+                return true;
+            case RECORD_TOUCH:
+            {
+                uint32_t x, y;
+                if (!readVarint(x) || !readVarint(y))
+                {
+                    return false;
+                }
+                r.x = x;
+                r.y = y;
+                return true;
+            }
+            default:
+                debugln("[trace.h] unknown record");
+                return false;
+            }
+        }
+    };
+
+    // Destination of the recording, nullptr when not recording
+    Print *out = nullptr;
+    File file;
+    uint32_t lastMs = 0;
+    uint32_t lastTickMs = 0;
+    int16_t lastFrame[Greenhouse::CHANNEL_COUNT];
+    // Set during replays so replayed events aren't recorded again
+    bool paused = false;
+
+    void begin(Print &sink);
+    bool beginFile(const char *path);
+    void end();
+    void recordFrame(const int16_t *frame);
+    void recordTouch(uint16_t x, uint16_t y);
+    void doTick();
+    uint32_t nextDeadline();
+
+    void writeVarint(uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            out->write((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        out->write((uint8_t)value);
+    }
+
+    // Writes the record header, returns false if not recording
+    bool writeRecord(uint8_t type)
+    {
+        if (out == nullptr || paused)
+        {
+            return false;
+        }
+        uint32_t ms = Clock::now();
+        out->write(type);
+        writeVarint(ms - lastMs);
+        lastMs = ms;
+        return true;
+    }
+
+    /**
+     * @brief Starts recording to a sink (e.g. Serial with debugging disabled, or a file)
+     *
+     * @param sink: Destination of the binary trace
+     */
+    void begin(Print &sink)
+    {
+        out = &sink;
+        lastMs = Clock::now();
+        lastTickMs = lastMs;
+        memset(lastFrame, 0, sizeof(lastFrame));
+        out->write((const uint8_t *)"GHTR", 4);
+        out->write(VERSION);
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            out->write((uint8_t)(lastMs >> (8 * i)));
+        }
+        debugln("[trace.h] recording started");
+    }
+
+    // Starts recording to a LittleFS file, replacing it
+    bool beginFile(const char *path)
+    {
+        if (!LittleFS.begin(true))
+        {
+            debugln("[trace.h] LittleFS mount failed");
+            return false;
+        }
+        file = LittleFS.open(path, FILE_WRITE);
+        if (!file)
+        {
+            debugln("[trace.h] cannot create trace file");
+            return false;
+        }
+        begin(file);
+        return true;
+    }
+
+    void end()
+    {
+        if (out == nullptr)
+        {
+            return;
+        }
+        out->flush();
+        if (out == &file)
+        {
+            file.close();
+        }
+        out = nullptr;
+        debugln("[trace.h] recording stopped");
+    }
+
+    // Records a raw frame as received from the radio
+    void recordFrame(const int16_t *frame)
+    {
+        if (!writeRecord(RECORD_FRAME))
+        {
+            return;
+        }
+        for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+        {
+            int32_t delta = (int32_t)frame[i] - lastFrame[i];
+            writeVarint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+            lastFrame[i] = frame[i];
+        }
+    }
+
+    // Records a debounced touch position
+    void recordTouch(uint16_t x, uint16_t y)
+    {
+        if (!writeRecord(RECORD_TOUCH))
+        {
+            return;
+        }
+        writeVarint(x);
+        writeVarint(y);
+    }
+
+    // Writes periodic clock marks and flushes the sink
+    void doTick()
+    {
+        if (out == nullptr || paused || Clock::now() - lastTickMs < TICK_INTERVAL)
+        {
+            return;
+        }
+        lastTickMs = Clock::now();
+        writeRecord(RECORD_TICK);
+        out->flush();
+    }
+
+    // time of the next clock mark
+    uint32_t nextDeadline()
+    {
+        if (out == nullptr || paused)
+        {
+            return Clock::now() + 0x7FFFFFFF;
+        }
+        return lastTickMs + TICK_INTERVAL;
+    }
+};
+
+#endif
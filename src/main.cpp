@@ -16,19 +16,31 @@
 #include "radiohelper.h"
 #include "greenhouse.h"
 #include "globals.h"
-#include "rtc.h"
+#include "rtchelper.h"
+#include "trace.h"
+#include "replay.h"
+#include "power.h"
+#include "boot.h"
+#include "seriallink.h"
+#include "ota.h"
 
 void setup(void)
 {
+    SerialLink::doSetup();
     Serial.begin(Globals::baudrate);
-    TFT::doSetup();
-    Radio::doSetup();
-    RTC::doSetup();
+    Boot::run();
     debugln("[main.cpp] setup completed");
 }
 
 void loop()
 {
+  Replay::doTick();
   TFT::doTick();
   Radio::doTick();
+  RTC::doTick();
+  SerialLink::doTick();
+  Ota::doTick();
+  Trace::doTick();
+  Boot::doTick();
+  Power::doTick();
 }
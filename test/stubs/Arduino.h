@@ -0,0 +1,324 @@
+/**
+ * @file Arduino.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the Arduino core for the native test environment
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Only what the modules in include/ use. Time is simulated: millis() and micros() read Host::nowUs,
+ * which tests advance explicitly (and delay() or a light sleep advance implicitly). Serial is a
+ * loopback, tests push bytes into Host::serialRx and read what the firmware wrote from Host::serialTx.
+ */
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define DEC 10
+#define HEX 16
+
+namespace Host
+{
+    // Simulated time since boot
+    inline uint64_t nowUs = 0;
+    inline void advanceUs(uint64_t us)
+    {
+        nowUs += us;
+    }
+    inline void advanceMs(uint32_t ms)
+    {
+        nowUs += (uint64_t)ms * 1000;
+    }
+
+    // Pin levels read by digitalRead, inputs idle high
+    inline int pins[40] = {HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+                           HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+                           HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH};
+    inline void (*isr[40])() = {};
+
+    // Serial loopback, and the bytes the UART can still accept (availableForWrite)
+    inline std::deque<uint8_t> serialRx;
+    inline std::vector<uint8_t> serialTx;
+    inline int serialTxRoom = 1 << 20;
+
+    inline bool restarted = false;
+    inline uint32_t seed = 1;
+};
+
+inline unsigned long millis()
+{
+    return (uint32_t)(Host::nowUs / 1000);
+}
+
+inline unsigned long micros()
+{
+    return (uint32_t)Host::nowUs;
+}
+
+inline void delay(unsigned long ms)
+{
+    Host::advanceMs(ms);
+}
+
+inline void delayMicroseconds(unsigned int us)
+{
+    Host::advanceUs(us);
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t level)
+{
+    Host::pins[pin] = level;
+}
+inline int digitalRead(uint8_t pin)
+{
+    return Host::pins[pin];
+}
+inline void attachInterrupt(uint8_t pin, void (*handler)(), int)
+{
+    Host::isr[pin] = handler;
+}
+inline uint8_t digitalPinToInterrupt(uint8_t pin)
+{
+    return pin;
+}
+
+// Deterministic, so simulations are reproducible
+inline long random(long high)
+{
+    Host::seed = Host::seed * 1103515245u + 12345u;
+    return high > 0 ? (long)((Host::seed >> 8) % (uint32_t)high) : 0;
+}
+inline long random(long low, long high)
+{
+    return high > low ? low + random(high - low) : low;
+}
+inline void randomSeed(unsigned long seed)
+{
+    Host::seed = seed;
+}
+
+inline void esp_restart()
+{
+    Host::restarted = true;
+}
+
+inline bool psramFound()
+{
+    return false;
+}
+
+class String : public std::string
+{
+public:
+    String() {}
+    String(const char *s) : std::string(s) {}
+    String(const std::string &s) : std::string(s) {}
+    void concat(const char *s)
+    {
+        append(s);
+    }
+    void concat(const String &s)
+    {
+        append(s);
+    }
+    void concat(long long value)
+    {
+        append(std::to_string(value));
+    }
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t byte) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            write(buffer[i]);
+        }
+        return size;
+    }
+    size_t write(const char *text)
+    {
+        return write((const uint8_t *)text, strlen(text));
+    }
+    virtual int availableForWrite()
+    {
+        return 0;
+    }
+    virtual void flush() {}
+
+    size_t print(const char *text)
+    {
+        return write(text);
+    }
+    size_t print(const String &text)
+    {
+        return write(text.c_str());
+    }
+    size_t print(char c)
+    {
+        return write((uint8_t)c);
+    }
+    size_t print(long long value, int base = DEC)
+    {
+        char text[24];
+        if (base == HEX)
+        {
+            snprintf(text, sizeof(text), "%llX", value);
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "%lld", value);
+        }
+        return write(text);
+    }
+    size_t print(int value, int base = DEC)
+    {
+        return print((long long)value, base);
+    }
+    size_t print(long value, int base = DEC)
+    {
+        return print((long long)value, base);
+    }
+    size_t print(unsigned int value, int base = DEC)
+    {
+        return print((long long)value, base);
+    }
+    size_t print(unsigned long value, int base = DEC)
+    {
+        return print((long long)value, base);
+    }
+    size_t print(unsigned long long value, int base = DEC)
+    {
+        return print((long long)value, base);
+    }
+    size_t print(double value, int digits = 2)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%.*f", digits, value);
+        return write(text);
+    }
+    size_t println()
+    {
+        return write("\r\n");
+    }
+    template <typename T>
+    size_t println(T value)
+    {
+        return print(value) + println();
+    }
+    template <typename T>
+    size_t println(T value, int format)
+    {
+        return print(value, format) + println();
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available()
+    {
+        return 0;
+    }
+    virtual int read()
+    {
+        return -1;
+    }
+    virtual int peek()
+    {
+        return -1;
+    }
+    size_t readBytes(uint8_t *buffer, size_t length)
+    {
+        size_t n = 0;
+        while (n < length && available() > 0)
+        {
+            buffer[n++] = read();
+        }
+        return n;
+    }
+};
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    size_t setRxBufferSize(size_t size)
+    {
+        return size;
+    }
+    size_t setTxBufferSize(size_t size)
+    {
+        txBufferSize = size;
+        return size;
+    }
+    size_t write(uint8_t byte) override
+    {
+        Host::serialTx.push_back(byte);
+        return 1;
+    }
+    using Print::write;
+    int availableForWrite() override
+    {
+        return Host::serialTxRoom;
+    }
+    int available() override
+    {
+        return Host::serialRx.size();
+    }
+    int read() override
+    {
+        if (Host::serialRx.empty())
+        {
+            return -1;
+        }
+        uint8_t byte = Host::serialRx.front();
+        Host::serialRx.pop_front();
+        return byte;
+    }
+    int peek() override
+    {
+        return Host::serialRx.empty() ? -1 : Host::serialRx.front();
+    }
+    operator bool()
+    {
+        return true;
+    }
+
+    size_t txBufferSize = 0;
+};
+
+inline HardwareSerial Serial;
+
+#endif
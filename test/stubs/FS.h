@@ -0,0 +1,172 @@
+/**
+ * @file FS.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the Arduino FS API, files live in memory
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Files survive as long as the process, so a test can "reboot" a module (reset its state and run
+ * doSetup() again) and find what it persisted. Tests wipe them with Host::files.clear().
+ */
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace Host
+{
+    inline std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+};
+
+namespace fs
+{
+    enum SeekMode
+    {
+        SeekSet,
+        SeekCur,
+        SeekEnd
+    };
+
+    class File : public Stream
+    {
+    public:
+        File() {}
+        File(std::shared_ptr<std::vector<uint8_t>> data, size_t position) : data(data), pos(position) {}
+
+        size_t write(uint8_t byte) override
+        {
+            return write(&byte, 1);
+        }
+        size_t write(const uint8_t *buffer, size_t size) override
+        {
+            if (!data)
+            {
+                return 0;
+            }
+            if (pos + size > data->size())
+            {
+                data->resize(pos + size);
+            }
+            memcpy(data->data() + pos, buffer, size);
+            pos += size;
+            return size;
+        }
+        using Print::write;
+        int availableForWrite() override
+        {
+            return data ? 4096 : 0;
+        }
+        size_t read(uint8_t *buffer, size_t size)
+        {
+            size_t n = data ? min(size, data->size() - pos) : 0;
+            memcpy(buffer, data->data() + pos, n);
+            pos += n;
+            return n;
+        }
+        int read() override
+        {
+            uint8_t byte;
+            return read(&byte, 1) == 1 ? byte : -1;
+        }
+        int peek() override
+        {
+            return data && pos < data->size() ? (*data)[pos] : -1;
+        }
+        int available() override
+        {
+            return data ? data->size() - pos : 0;
+        }
+        bool seek(uint32_t position, SeekMode mode = SeekSet)
+        {
+            if (!data)
+            {
+                return false;
+            }
+            size_t base = mode == SeekSet ? 0 : (mode == SeekCur ? pos : data->size());
+            if (base + position > data->size())
+            {
+                return false;
+            }
+            pos = base + position;
+            return true;
+        }
+        size_t position()
+        {
+            return pos;
+        }
+        size_t size()
+        {
+            return data ? data->size() : 0;
+        }
+        void close()
+        {
+            data.reset();
+        }
+        operator bool()
+        {
+            return (bool)data;
+        }
+
+    private:
+        std::shared_ptr<std::vector<uint8_t>> data;
+        size_t pos = 0;
+    };
+
+    class FS
+    {
+    public:
+        bool begin(bool formatOnFail = false)
+        {
+            (void)formatOnFail;
+            return true;
+        }
+        File open(const char *path, const char *mode = FILE_READ, bool create = false)
+        {
+            auto found = Host::files.find(path);
+            if (mode[0] == 'r' && found == Host::files.end() && !create)
+            {
+                return File();
+            }
+            if (found == Host::files.end())
+            {
+                found = Host::files.emplace(path, std::make_shared<std::vector<uint8_t>>()).first;
+            }
+            if (mode[0] == 'w')
+            {
+                found->second->clear();
+            }
+            return File(found->second, mode[0] == 'a' ? found->second->size() : 0);
+        }
+        bool exists(const char *path)
+        {
+            return Host::files.count(path) > 0;
+        }
+        bool remove(const char *path)
+        {
+            return Host::files.erase(path) > 0;
+        }
+        bool rename(const char *from, const char *to)
+        {
+            auto found = Host::files.find(from);
+            if (found == Host::files.end())
+            {
+                return false;
+            }
+            Host::files[to] = found->second;
+            Host::files.erase(found);
+            return true;
+        }
+    };
+};
+
+using fs::File;
+
+#endif
@@ -0,0 +1,18 @@
+/**
+ * @file LittleFS.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the LittleFS library
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "FS.h"
+
+inline fs::FS LittleFS;
+
+#endif
@@ -0,0 +1,16 @@
+/**
+ * @file SPI.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the Arduino SPI library
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <Arduino.h>
+
+#endif
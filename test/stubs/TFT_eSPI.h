@@ -0,0 +1,419 @@
+/**
+ * @file TFT_eSPI.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of TFT_eSPI: draws into a framebuffer and counts the pixels sent to the panel
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Shapes are drawn exactly where the library would draw them, text as a box of textWidth() by
+ * fontHeight() in the text color. Strings are kept in order in `strings`, so tests can check what
+ * was printed where. Every pixel that would cross the SPI bus of the panel is counted in
+ * `pixelsSent`, and Host::nowUs advances by Host::pixelNs per pixel plus Host::commandNs per
+ * primitive, a model of the bus time (both 0 by default, tests set them).
+ */
+#ifndef HOST_TFT_ESPI_H
+#define HOST_TFT_ESPI_H
+
+#include <Arduino.h>
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_PURPLE 0x780F
+#define TFT_DARKGREY 0x7BEF
+#define TFT_BLUE 0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_RED 0xF800
+#define TFT_MAGENTA 0xF81F
+#define TFT_YELLOW 0xFFE0
+#define TFT_WHITE 0xFFFF
+#define TFT_ORANGE 0xFDA0
+#define TFT_LIGHTGREY 0xD69A
+#define TL_DATUM 0
+#define MC_DATUM 4
+
+namespace Host
+{
+    // Bus time model of the panel
+    inline uint32_t pixelNs = 0;
+    inline uint32_t commandNs = 0;
+    // Touch returned by getTouch
+    inline uint16_t touchX = 0;
+    inline uint16_t touchY = 0;
+    inline uint32_t calibrations = 0;
+};
+
+class TFT_eSPI : public Print
+{
+public:
+    struct Text_s
+    {
+        std::string text;
+        int32_t x;
+        int32_t y;
+        uint16_t color;
+    };
+
+    TFT_eSPI(int16_t w = 320, int16_t h = 480) : _width(w), _height(h), pixels(w * h, 0) {}
+    virtual ~TFT_eSPI() {}
+
+    void init() {}
+    void setRotation(uint8_t) {}
+    void setTouch(uint16_t *) {}
+    uint8_t getTouch(uint16_t *x, uint16_t *y, uint16_t threshold = 600)
+    {
+        (void)threshold;
+        *x = Host::touchX;
+        *y = Host::touchY;
+        return 1;
+    }
+    void calibrateTouch(uint16_t *data, uint32_t, uint32_t, uint8_t)
+    {
+        memset(data, 0, 5 * sizeof(uint16_t));
+        Host::calibrations++;
+    }
+
+    int16_t width()
+    {
+        return _width;
+    }
+    int16_t height()
+    {
+        return _height;
+    }
+
+    void fillScreen(uint32_t color)
+    {
+        fillRect(0, 0, _width, _height, color);
+    }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+    {
+        command();
+        for (int32_t j = y; j < y + h; j++)
+        {
+            for (int32_t i = x; i < x + w; i++)
+            {
+                plot(i, j, color);
+            }
+        }
+    }
+    void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color)
+    {
+        command();
+        for (int32_t j = y; j < y + h; j++)
+        {
+            for (int32_t i = x; i < x + w; i++)
+            {
+                // Distance to the nearest corner center
+                int32_t dx = i < x + r ? x + r - i : (i >= x + w - r ? i - (x + w - r - 1) : 0);
+                int32_t dy = j < y + r ? y + r - j : (j >= y + h - r ? j - (y + h - r - 1) : 0);
+                if (dx * dx + dy * dy <= r * r)
+                {
+                    plot(i, j, color);
+                }
+            }
+        }
+    }
+    void fillEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint32_t color)
+    {
+        command();
+        for (int32_t j = -ry; j <= ry; j++)
+        {
+            for (int32_t i = -rx; i <= rx; i++)
+            {
+                if ((int64_t)i * i * ry * ry + (int64_t)j * j * rx * rx <= (int64_t)rx * rx * ry * ry)
+                {
+                    plot(x0 + i, y0 + j, color);
+                }
+            }
+        }
+    }
+    void drawXBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color)
+    {
+        command();
+        int16_t stride = (w + 7) / 8;
+        for (int16_t j = 0; j < h; j++)
+        {
+            for (int16_t i = 0; i < w; i++)
+            {
+                if (bitmap[j * stride + i / 8] & (1 << (i & 7)))
+                {
+                    plot(x + i, y + j, color);
+                }
+            }
+        }
+    }
+    void drawXBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color, uint16_t bgcolor)
+    {
+        fillRect(x, y, w, h, bgcolor);
+        drawXBitmap(x, y, bitmap, w, h, color);
+    }
+
+    void setTextSize(uint8_t size)
+    {
+        textSize = size > 0 ? size : 1;
+    }
+    void setTextFont(uint8_t font)
+    {
+        textFont = font;
+    }
+    void setTextColor(uint16_t color)
+    {
+        textColor = color;
+        textBgFill = false;
+    }
+    void setTextColor(uint16_t color, uint16_t background)
+    {
+        textColor = color;
+        textBackground = background;
+        textBgFill = true;
+    }
+    void setTextDatum(uint8_t datum)
+    {
+        textDatum = datum;
+    }
+    void setTextPadding(uint16_t padding)
+    {
+        textPadding = padding;
+    }
+    void setCursor(int16_t x, int16_t y)
+    {
+        cursorX = x;
+        cursorY = y;
+    }
+
+    // Fixed pitch model of the built-in fonts, at most the widest glyph (see Layout::fontWidth)
+    int16_t textWidth(const char *text, uint8_t font)
+    {
+        return strlen(text) * glyphWidth(font) * textSize;
+    }
+    int16_t textWidth(const char *text)
+    {
+        return textWidth(text, textFont);
+    }
+    int16_t fontHeight(uint8_t font)
+    {
+        switch (font)
+        {
+        case 1:
+            return 8 * textSize;
+        case 2:
+            return 16 * textSize;
+        case 4:
+            return 26 * textSize;
+        case 6:
+        case 7:
+            return 48 * textSize;
+        case 8:
+            return 75 * textSize;
+        default:
+            return 8 * textSize;
+        }
+    }
+    int16_t fontHeight()
+    {
+        return fontHeight(textFont);
+    }
+
+    int16_t drawString(const char *text, int32_t x, int32_t y)
+    {
+        int16_t w = textWidth(text);
+        if (textDatum == MC_DATUM)
+        {
+            x -= w / 2;
+            y -= fontHeight() / 2;
+        }
+        if (textPadding > w)
+        {
+            fillRect(x, y, textPadding, fontHeight(), textBgFill ? textBackground : textColor);
+        }
+        drawText(text, x, y);
+        return w;
+    }
+
+    size_t write(uint8_t byte) override
+    {
+        if (byte == '\n')
+        {
+            cursorY += fontHeight();
+            cursorX = 0;
+            return 1;
+        }
+        if (byte == '\r')
+        {
+            return 1;
+        }
+        char text[2] = {(char)byte, 0};
+        drawText(text, cursorX, cursorY);
+        cursorX += textWidth(text);
+        return 1;
+    }
+    using Print::write;
+
+    uint16_t readPixel(int32_t x, int32_t y)
+    {
+        return pixels[y * _width + x];
+    }
+
+    // Everything printed since the last clearStrings(), one entry per drawString or print() call
+    std::vector<Text_s> strings;
+    void clearStrings()
+    {
+        strings.clear();
+    }
+    bool printed(const char *text)
+    {
+        for (const Text_s &s : strings)
+        {
+            if (s.text.find(text) != std::string::npos)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t pixelsSent = 0;
+    uint32_t commands = 0;
+
+    // Sprites draw in RAM and don't cross the bus
+    virtual bool onPanel()
+    {
+        return true;
+    }
+
+    void command()
+    {
+        if (onPanel())
+        {
+            commands++;
+            Host::advanceUs(Host::commandNs / 1000);
+        }
+    }
+
+    void plot(int32_t x, int32_t y, uint32_t color)
+    {
+        if (x < 0 || y < 0 || x >= _width || y >= _height)
+        {
+            return;
+        }
+        pixels[y * _width + x] = color;
+        if (onPanel())
+        {
+            pixelsSent++;
+            pixelTime += Host::pixelNs;
+            if (pixelTime >= 1000)
+            {
+                Host::advanceUs(pixelTime / 1000);
+                pixelTime %= 1000;
+            }
+        }
+    }
+
+    uint8_t glyphWidth(uint8_t font)
+    {
+        switch (font)
+        {
+        case 1:
+            return 6;
+        case 2:
+            return 9;
+        case 4:
+            return 14;
+        case 6:
+        case 7:
+            return 32;
+        case 8:
+            return 55;
+        default:
+            return 6;
+        }
+    }
+
+    void drawText(const char *text, int32_t x, int32_t y)
+    {
+        if (!strings.empty() && strings.back().y == y && strings.back().x + textWidth(strings.back().text.c_str()) == x &&
+            strlen(text) == 1)
+        {
+            // Characters of one print() call
+            strings.back().text += text;
+        }
+        else
+        {
+            strings.push_back({text, x, y, textColor});
+        }
+        fillRect(x, y, textWidth(text), fontHeight(), textColor);
+    }
+
+    int16_t _width;
+    int16_t _height;
+    uint8_t textSize = 1;
+    uint8_t textFont = 1;
+    uint16_t textColor = TFT_WHITE;
+    uint16_t textBackground = TFT_BLACK;
+    bool textBgFill = false;
+    uint8_t textDatum = TL_DATUM;
+    uint16_t textPadding = 0;
+    int16_t cursorX = 0;
+    int16_t cursorY = 0;
+    uint32_t pixelTime = 0;
+    std::vector<uint16_t> pixels;
+};
+
+class TFT_eSprite : public TFT_eSPI
+{
+public:
+    explicit TFT_eSprite(TFT_eSPI *parent) : TFT_eSPI(0, 0), parent(parent) {}
+
+    void setColorDepth(int8_t) {}
+    void setPsram(bool) {}
+    void *createSprite(int16_t w, int16_t h, uint8_t frames = 1)
+    {
+        (void)frames;
+        _width = w;
+        _height = h;
+        pixels.assign(w * h, 0);
+        return pixels.data();
+    }
+    void deleteSprite()
+    {
+        pixels.clear();
+        _width = 0;
+        _height = 0;
+    }
+    bool created()
+    {
+        return !pixels.empty();
+    }
+    void *getPointer()
+    {
+        return pixels.data();
+    }
+    void fillSprite(uint32_t color)
+    {
+        std::fill(pixels.begin(), pixels.end(), color);
+    }
+    // Copies the sprite to the panel, a single window write on the real bus
+    void pushSprite(int32_t x, int32_t y)
+    {
+        parent->command();
+        for (int32_t j = 0; j < _height; j++)
+        {
+            for (int32_t i = 0; i < _width; i++)
+            {
+                parent->plot(x + i, y + j, pixels[j * _width + i]);
+            }
+        }
+    }
+
+    bool onPanel() override
+    {
+        return false;
+    }
+
+    TFT_eSPI *parent;
+};
+
+#endif
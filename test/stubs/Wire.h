@@ -0,0 +1,76 @@
+/**
+ * @file Wire.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the Arduino I2C library, with a DS3231 on the bus
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * The DS3231 registers are read from Host::rtc (BCD, as on the chip). Host::rtcPresent = false
+ * leaves the bus empty.
+ */
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+namespace Host
+{
+    inline bool rtcPresent = true;
+    // Seconds, minutes, hours, day of week, date, month, year (2021-03-14 15:09:26, a Sunday)
+    inline uint8_t rtc[7] = {0x26, 0x09, 0x15, 0x01, 0x14, 0x03, 0x21};
+    inline int sdaPin = -1;
+    inline int sclPin = -1;
+};
+
+class TwoWire
+{
+public:
+    bool begin(int sda = 21, int scl = 22, uint32_t frequency = 0)
+    {
+        (void)frequency;
+        Host::sdaPin = sda;
+        Host::sclPin = scl;
+        return true;
+    }
+    void beginTransmission(uint8_t address)
+    {
+        target = address;
+    }
+    size_t write(uint8_t byte)
+    {
+        reg = byte;
+        return 1;
+    }
+    uint8_t endTransmission(bool stop = true)
+    {
+        (void)stop;
+        return target == 0x68 && Host::rtcPresent ? 0 : 2;
+    }
+    uint8_t requestFrom(uint8_t address, uint8_t count)
+    {
+        next = reg;
+        left = address == 0x68 && Host::rtcPresent ? count : 0;
+        return left;
+    }
+    int read()
+    {
+        if (left == 0)
+        {
+            return -1;
+        }
+        left--;
+        return next < sizeof(Host::rtc) ? Host::rtc[next++] : 0;
+    }
+
+private:
+    uint8_t target = 0;
+    uint8_t reg = 0;
+    uint8_t next = 0;
+    uint8_t left = 0;
+};
+
+inline TwoWire Wire;
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file gpio.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the ESP-IDF GPIO driver
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+
+#include <Arduino.h>
+
+typedef int gpio_num_t;
+typedef enum
+{
+    GPIO_INTR_DISABLE = 0,
+    GPIO_INTR_POSEDGE = 1,
+    GPIO_INTR_NEGEDGE = 2,
+    GPIO_INTR_ANYEDGE = 3,
+    GPIO_INTR_LOW_LEVEL = 4,
+    GPIO_INTR_HIGH_LEVEL = 5
+} gpio_int_type_t;
+
+namespace Host
+{
+    // Level that wakes the chip from light sleep on each pin, -1 if it isn't a wake source
+    inline int wakeLevel[40] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+};
+
+inline int gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type)
+{
+    Host::wakeLevel[pin] = type == GPIO_INTR_LOW_LEVEL ? LOW : HIGH;
+    return 0;
+}
+inline int gpio_wakeup_disable(gpio_num_t pin)
+{
+    Host::wakeLevel[pin] = -1;
+    return 0;
+}
+inline int gpio_set_intr_type(gpio_num_t, gpio_int_type_t)
+{
+    return 0;
+}
+
+#endif
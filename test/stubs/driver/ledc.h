@@ -0,0 +1,89 @@
+/**
+ * @file ledc.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the ESP-IDF LEDC driver, remembers the pin and duty of every channel
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef HOST_DRIVER_LEDC_H
+#define HOST_DRIVER_LEDC_H
+
+#include <Arduino.h>
+
+typedef enum
+{
+    LEDC_LOW_SPEED_MODE
+} ledc_mode_t;
+typedef enum
+{
+    LEDC_TIMER_0
+} ledc_timer_t;
+typedef enum
+{
+    LEDC_CHANNEL_0,
+    LEDC_CHANNEL_MAX = 8
+} ledc_channel_t;
+typedef enum
+{
+    LEDC_TIMER_8_BIT = 8
+} ledc_timer_bit_t;
+typedef enum
+{
+    LEDC_AUTO_CLK,
+    LEDC_USE_RTC8M_CLK
+} ledc_clk_cfg_t;
+typedef enum
+{
+    LEDC_INTR_DISABLE
+} ledc_intr_type_t;
+
+typedef struct
+{
+    ledc_mode_t speed_mode;
+    ledc_timer_bit_t duty_resolution;
+    ledc_timer_t timer_num;
+    uint32_t freq_hz;
+    ledc_clk_cfg_t clk_cfg;
+} ledc_timer_config_t;
+
+typedef struct
+{
+    int gpio_num;
+    ledc_mode_t speed_mode;
+    ledc_channel_t channel;
+    ledc_intr_type_t intr_type;
+    ledc_timer_t timer_sel;
+    uint32_t duty;
+    int hpoint;
+} ledc_channel_config_t;
+
+namespace Host
+{
+    inline int ledcPin[LEDC_CHANNEL_MAX] = {-1, -1, -1, -1, -1, -1, -1, -1};
+    inline uint32_t ledcDuty[LEDC_CHANNEL_MAX] = {};
+};
+
+inline int ledc_timer_config(const ledc_timer_config_t *)
+{
+    return 0;
+}
+inline int ledc_channel_config(const ledc_channel_config_t *config)
+{
+    Host::ledcPin[config->channel] = config->gpio_num;
+    Host::ledcDuty[config->channel] = config->duty;
+    return 0;
+}
+inline int ledc_set_duty(ledc_mode_t, ledc_channel_t channel, uint32_t duty)
+{
+    Host::ledcDuty[channel] = duty;
+    return 0;
+}
+inline int ledc_update_duty(ledc_mode_t, ledc_channel_t)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,26 @@
+/**
+ * @file uart.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the ESP-IDF UART driver
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef HOST_DRIVER_UART_H
+#define HOST_DRIVER_UART_H
+
+typedef enum
+{
+    UART_NUM_0,
+    UART_NUM_1,
+    UART_NUM_2
+} uart_port_t;
+
+inline int uart_set_wakeup_threshold(uart_port_t, int)
+{
+    return 0;
+}
+
+#endif
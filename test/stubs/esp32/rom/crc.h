@@ -0,0 +1,31 @@
+/**
+ * @file crc.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the ESP32 ROM CRC routines
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef HOST_ESP32_ROM_CRC_H
+#define HOST_ESP32_ROM_CRC_H
+
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, reflected), crc32_le(0, ...) matches zlib's crc32()
+inline uint32_t crc32_le(uint32_t crc, const uint8_t *buffer, uint32_t length)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        crc ^= buffer[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/**
+ * @file esp_heap_caps.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the ESP-IDF capability allocator
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+inline void *heap_caps_malloc(size_t size, uint32_t)
+{
+    return malloc(size);
+}
+inline void *heap_caps_realloc(void *pointer, size_t size, uint32_t)
+{
+    return realloc(pointer, size);
+}
+inline void heap_caps_free(void *pointer)
+{
+    free(pointer);
+}
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file esp_ota_ops.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the ESP-IDF OTA API
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * The boot partition is only remembered, and accepted if the image starts with the ESP32 image
+ * magic byte like the real check of the image header.
+ */
+#ifndef HOST_ESP_OTA_OPS_H
+#define HOST_ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+#define ESP_IMAGE_HEADER_MAGIC 0xE9
+#define ESP_ERR_OTA_VALIDATE_FAILED 0x1503
+
+namespace Host
+{
+    inline const esp_partition_t *bootPartition = nullptr;
+    inline bool rollbackCancelled = false;
+};
+
+inline const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *)
+{
+    return &Host::otaPartition;
+}
+
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    uint8_t magic = 0;
+    if (esp_partition_read(partition, 0, &magic, 1) != ESP_OK || magic != ESP_IMAGE_HEADER_MAGIC)
+    {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    Host::bootPartition = partition;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ota_mark_app_valid_cancel_rollback()
+{
+    Host::rollbackCancelled = true;
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file esp_partition.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the ESP-IDF partition API, the OTA partition is a file
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Host::partitionFile backs the partition, so its content survives a simulated reboot like flash
+ * does. Erased bytes read 0xFF and writes can only clear bits, as on NOR flash. Host::failWrites
+ * makes writes fail from a given offset on, to simulate a flash error.
+ */
+#ifndef HOST_ESP_PARTITION_H
+#define HOST_ESP_PARTITION_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+struct esp_partition_t
+{
+    uint32_t address;
+    uint32_t size;
+    const char *label;
+};
+
+namespace Host
+{
+    inline const char *partitionFile = "ota_partition.bin";
+    inline esp_partition_t otaPartition = {0x210000, 0x1F0000, "ota_1"};
+    inline uint32_t failWrites = 0xFFFFFFFF;
+    inline uint32_t erasedBytes = 0;
+
+    // Maps the backing file, creating it erased if needed
+    inline FILE *partition()
+    {
+        FILE *file = fopen(partitionFile, "r+b");
+        if (file == nullptr)
+        {
+            file = fopen(partitionFile, "w+b");
+            std::vector<uint8_t> erased(4096, 0xFF);
+            for (uint32_t i = 0; i < otaPartition.size; i += erased.size())
+            {
+                fwrite(erased.data(), 1, erased.size(), file);
+            }
+        }
+        return file;
+    }
+};
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (offset % 4096 != 0 || size % 4096 != 0 || offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    FILE *file = Host::partition();
+    std::vector<uint8_t> erased(size, 0xFF);
+    fseek(file, offset, SEEK_SET);
+    fwrite(erased.data(), 1, size, file);
+    fclose(file);
+    Host::erasedBytes += size;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *data, size_t size)
+{
+    if (offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (offset + size > Host::failWrites)
+    {
+        return ESP_FAIL;
+    }
+    FILE *file = Host::partition();
+    std::vector<uint8_t> current(size);
+    fseek(file, offset, SEEK_SET);
+    fread(current.data(), 1, size, file);
+    for (size_t i = 0; i < size; i++)
+    {
+        current[i] &= ((const uint8_t *)data)[i];
+    }
+    fseek(file, offset, SEEK_SET);
+    fwrite(current.data(), 1, size, file);
+    fclose(file);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *data, size_t size)
+{
+    if (offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    FILE *file = Host::partition();
+    fseek(file, offset, SEEK_SET);
+    size_t n = fread(data, 1, size, file);
+    fclose(file);
+    return n == size ? ESP_OK : ESP_FAIL;
+}
+
+#endif
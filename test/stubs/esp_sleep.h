@@ -0,0 +1,101 @@
+/**
+ * @file esp_sleep.h
+ * @author Riccardo Iacob
+ * @brief Host stand-in of the ESP-IDF sleep API, a light sleep advances the simulated time
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+typedef enum
+{
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_TIMER = 4,
+    ESP_SLEEP_WAKEUP_GPIO = 7,
+    ESP_SLEEP_WAKEUP_UART = 8
+} esp_sleep_wakeup_cause_t;
+typedef enum
+{
+    ESP_PD_DOMAIN_RTC8M
+} esp_sleep_pd_domain_t;
+typedef enum
+{
+    ESP_PD_OPTION_OFF,
+    ESP_PD_OPTION_ON
+} esp_sleep_pd_option_t;
+
+namespace Host
+{
+    inline uint64_t sleepTimerUs = 0;
+    // Simulated time of the next external wakeup (touch, radio, serial), 0 if none
+    inline uint64_t nextEventUs = 0;
+    // Active low line the event pulls down when it fires, -1 if none
+    inline int eventPin = -1;
+    // Time it takes to enter and leave light sleep
+    inline uint32_t sleepOverheadUs = 0;
+    inline esp_sleep_wakeup_cause_t wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+};
+
+inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us)
+{
+    Host::sleepTimerUs = us;
+    return ESP_OK;
+}
+inline esp_err_t esp_sleep_enable_gpio_wakeup()
+{
+    return ESP_OK;
+}
+inline esp_err_t esp_sleep_enable_uart_wakeup(int)
+{
+    return ESP_OK;
+}
+inline esp_err_t esp_sleep_pd_config(esp_sleep_pd_domain_t, esp_sleep_pd_option_t)
+{
+    return ESP_OK;
+}
+
+// Sleeps until the timer or the next external event, whichever comes first. Wakeups are level
+// triggered like on the chip: a line already at its wake level ends the sleep right away.
+inline esp_err_t esp_light_sleep_start()
+{
+    for (uint8_t pin = 0; pin < 40; pin++)
+    {
+        if (Host::wakeLevel[pin] >= 0 && Host::pins[pin] == Host::wakeLevel[pin])
+        {
+            Host::wakeupCause = ESP_SLEEP_WAKEUP_GPIO;
+            Host::nowUs += Host::sleepOverheadUs;
+            return ESP_OK;
+        }
+    }
+    uint64_t wakeUs = Host::nowUs + Host::sleepTimerUs;
+    Host::wakeupCause = ESP_SLEEP_WAKEUP_TIMER;
+    if (Host::nextEventUs != 0 && Host::nextEventUs < wakeUs)
+    {
+        wakeUs = Host::nextEventUs > Host::nowUs ? Host::nextEventUs : Host::nowUs;
+        Host::wakeupCause = ESP_SLEEP_WAKEUP_GPIO;
+        if (Host::eventPin >= 0)
+        {
+            Host::pins[Host::eventPin] = LOW;
+        }
+    }
+    Host::nowUs = wakeUs + Host::sleepOverheadUs;
+    return ESP_OK;
+}
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause()
+{
+    return Host::wakeupCause;
+}
+
+#endif
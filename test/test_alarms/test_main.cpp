@@ -0,0 +1,214 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Rolling statistics and alarm engine (alarms.h), with a per-sample cost benchmark
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <unity.h>
+#include <chrono>
+#include "alarms.h"
+
+void setUp()
+{
+    for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+    {
+        Alarms::stats[i] = Alarms::Stats();
+        Alarms::alarms[i] = Alarms::Alarm();
+    }
+    Alarms::changed = false;
+}
+
+void tearDown() {}
+
+// Brute force extremes of the last WINDOW samples
+void checkWindow(const Alarms::Stats &s, const std::vector<int16_t> &history)
+{
+    size_t from = history.size() > Alarms::WINDOW ? history.size() - Alarms::WINDOW : 0;
+    int16_t low = *std::min_element(history.begin() + from, history.end());
+    int16_t high = *std::max_element(history.begin() + from, history.end());
+    TEST_ASSERT_EQUAL_INT16(low, s.min);
+    TEST_ASSERT_EQUAL_INT16(high, s.max);
+    TEST_ASSERT_LESS_OR_EQUAL(Alarms::WINDOW, s.minq.count);
+    TEST_ASSERT_LESS_OR_EQUAL(Alarms::WINDOW, s.maxq.count);
+}
+
+// A falling run longer than the window keeps every sample in the max deque, which used to overwrite its head
+void test_falling_run_longer_than_window()
+{
+    Alarms::Stats s;
+    std::vector<int16_t> history;
+    for (int16_t value = 9900; value >= 5000; value -= 100)
+    {
+        Alarms::update(s, value, history.size() * 1000);
+        history.push_back(value);
+        checkWindow(s, history);
+    }
+    // 50 samples: the max is the oldest one still in the window
+    TEST_ASSERT_EQUAL_INT16(9900 - 100 * (history.size() - Alarms::WINDOW), s.max);
+    TEST_ASSERT_EQUAL_UINT8(Alarms::WINDOW, s.maxq.count);
+}
+
+void test_rising_run_longer_than_window()
+{
+    Alarms::Stats s;
+    std::vector<int16_t> history;
+    for (int16_t value = -2000; value <= 3000; value += 50)
+    {
+        Alarms::update(s, value, history.size() * 1000);
+        history.push_back(value);
+        checkWindow(s, history);
+    }
+    TEST_ASSERT_EQUAL_UINT8(Alarms::WINDOW, s.minq.count);
+}
+
+void test_random_walk_matches_brute_force()
+{
+    Alarms::Stats s;
+    std::vector<int16_t> history;
+    int16_t value = 2300;
+    randomSeed(7);
+    for (uint32_t i = 0; i < 5000; i++)
+    {
+        // Long monotonic stretches as well as noise
+        value += (i / 100) % 2 ? random(-30, 10) : random(-10, 30);
+        Alarms::update(s, value, i * 5000);
+        history.push_back(value);
+        checkWindow(s, history);
+    }
+}
+
+void test_ewma_and_rate()
+{
+    Alarms::Stats s;
+    double ewma = 2000;
+    Alarms::update(s, 2000, 0);
+    for (uint32_t i = 1; i <= 40; i++)
+    {
+        Alarms::update(s, 3000, i * 5000);
+        ewma += 51.0 / 256 * (3000 - ewma);
+    }
+    TEST_ASSERT_INT_WITHIN(2, (int32_t)ewma, s.ewma >> Alarms::EWMA_SHIFT);
+    // 10 units in 5 s
+    Alarms::update(s, 4000, 41 * 5000);
+    TEST_ASSERT_EQUAL_INT32(200, s.rate);
+}
+
+void test_alarm_raised_on_first_sample_and_cleared_with_hysteresis()
+{
+    uint32_t ms = 0;
+    Alarms::feed(Greenhouse::TEMP1, 3400, ms += 5000);
+    TEST_ASSERT_FALSE(Alarms::isActive(Greenhouse::TEMP1));
+    Alarms::feed(Greenhouse::TEMP1, 3501, ms += 5000);
+    TEST_ASSERT_TRUE(Alarms::isActive(Greenhouse::TEMP1));
+    TEST_ASSERT_TRUE(Alarms::changed);
+    Alarms::changed = false;
+    // Back inside, but within the hysteresis
+    Alarms::feed(Greenhouse::TEMP1, 3480, ms += 5000);
+    TEST_ASSERT_TRUE(Alarms::isActive(Greenhouse::TEMP1));
+    TEST_ASSERT_FALSE(Alarms::changed);
+    Alarms::feed(Greenhouse::TEMP1, 3450, ms += 5000);
+    TEST_ASSERT_FALSE(Alarms::isActive(Greenhouse::TEMP1));
+    TEST_ASSERT_TRUE(Alarms::changed);
+    // Hold-off: crossing again right away stays quiet, after holdoffMs it raises
+    Alarms::feed(Greenhouse::TEMP1, 3600, ms += 5000);
+    TEST_ASSERT_FALSE(Alarms::isActive(Greenhouse::TEMP1));
+    Alarms::feed(Greenhouse::TEMP1, 3600, ms += Alarms::thresholds[Greenhouse::TEMP1].holdoffMs);
+    TEST_ASSERT_TRUE(Alarms::isActive(Greenhouse::TEMP1));
+}
+
+void test_rate_alarm()
+{
+    Alarms::Threshold t = {true, 0, 10000, 100, 50, 0};
+    Alarms::Stats s;
+    Alarms::Alarm a;
+    Alarms::update(s, 5000, 0);
+    TEST_ASSERT_FALSE(Alarms::evaluate(t, s, a, 0));
+    // 0.5 units/s is the limit, 1 unit/s is not
+    Alarms::update(s, 5500, 1000);
+    TEST_ASSERT_TRUE(Alarms::evaluate(t, s, a, 1000));
+    TEST_ASSERT_EQUAL(Alarms::Levels::RATE, a.level);
+}
+
+void test_untrusted_channels_are_not_fed()
+{
+    Greenhouse::Data_s data = {};
+    for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+    {
+        data.values[i] = i <= Greenhouse::TEMP3 ? 2000 : 7000;
+    }
+    uint32_t ms = 0;
+    Alarms::feedAll(data, ms += 5000);
+    TEST_ASSERT_FALSE(Alarms::changed);
+    TEST_ASSERT_EQUAL_UINT32(1, Alarms::stats[Greenhouse::TEMP1].seq);
+    // A stale channel holding a value over the limit raises nothing and adds no sample
+    data.values[Greenhouse::TEMP1] = 3600;
+    data.quality[Greenhouse::TEMP1] = Greenhouse::QUALITY_STALE;
+    Alarms::feedAll(data, ms += 5000);
+    TEST_ASSERT_FALSE(Alarms::isActive(Greenhouse::TEMP1));
+    TEST_ASSERT_FALSE(Alarms::changed);
+    TEST_ASSERT_EQUAL_UINT32(1, Alarms::stats[Greenhouse::TEMP1].seq);
+    TEST_ASSERT_EQUAL_UINT32(2, Alarms::stats[Greenhouse::TEMP2].seq);
+    // Trusted again, the value is alarmed on
+    data.quality[Greenhouse::TEMP1] = Greenhouse::QUALITY_OK;
+    Alarms::feedAll(data, ms += 5000);
+    TEST_ASSERT_TRUE(Alarms::isActive(Greenhouse::TEMP1));
+    // And an active alarm is not cleared by an out of range channel
+    data.values[Greenhouse::TEMP1] = 2000;
+    data.quality[Greenhouse::TEMP1] = Greenhouse::QUALITY_RANGE;
+    Alarms::feedAll(data, ms += 5000);
+    TEST_ASSERT_TRUE(Alarms::isActive(Greenhouse::TEMP1));
+}
+
+/**
+ * Cost per sample with hundreds of channels: the deques are amortized O(1), so nanoseconds per
+ * sample must not grow with the channel count. Prints the figures and fails on a 3x growth.
+ */
+void test_benchmark_per_sample_cost_is_flat()
+{
+    const uint16_t counts[] = {6, 60, 600};
+    const uint32_t SAMPLES = 600000;
+    double nsPerSample[3];
+    for (uint8_t c = 0; c < 3; c++)
+    {
+        uint16_t channels = counts[c];
+        std::vector<Alarms::Stats> stats(channels);
+        std::vector<Alarms::Alarm> alarms(channels);
+        Alarms::Threshold t = {true, 500, 3500, 50, 100, 60000};
+        uint32_t events = 0;
+        int16_t value = 2000;
+        randomSeed(1);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < SAMPLES; i++)
+        {
+            uint16_t channel = i % channels;
+            value += random(-40, 41);
+            uint32_t ms = i / channels * 5000;
+            Alarms::update(stats[channel], value, ms);
+            events += Alarms::evaluate(t, stats[channel], alarms[channel], ms);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        nsPerSample[c] = ns / SAMPLES;
+        char line[96];
+        snprintf(line, sizeof(line), "%u channels: %.1f ns/sample (%u alarm events)", channels, nsPerSample[c], events);
+        TEST_MESSAGE(line);
+    }
+    TEST_ASSERT_LESS_THAN(3 * nsPerSample[0] + 20, nsPerSample[2]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_falling_run_longer_than_window);
+    RUN_TEST(test_rising_run_longer_than_window);
+    RUN_TEST(test_random_walk_matches_brute_force);
+    RUN_TEST(test_ewma_and_rate);
+    RUN_TEST(test_alarm_raised_on_first_sample_and_cleared_with_hysteresis);
+    RUN_TEST(test_rate_alarm);
+    RUN_TEST(test_untrusted_channels_are_not_fed);
+    RUN_TEST(test_benchmark_per_sample_cost_is_flat);
+    return UNITY_END();
+}
@@ -0,0 +1,251 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief History export (export.h) decoded by host/export_decoder.h, with compression and speed figures
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <unity.h>
+#include <chrono>
+#include "export.h"
+#include "export_decoder.h"
+
+std::vector<std::vector<uint8_t>> chunks;
+
+bool collect(const uint8_t *chunk, uint16_t length)
+{
+    chunks.emplace_back(chunk, chunk + length);
+    return true;
+}
+
+// Refuses every chunk the first time it is offered, like a full transmit buffer
+uint32_t refused = 0;
+bool offered = false;
+bool collectSecondTime(const uint8_t *chunk, uint16_t length)
+{
+    offered = !offered;
+    if (offered)
+    {
+        refused++;
+        return false;
+    }
+    return collect(chunk, length);
+}
+
+void setUp()
+{
+    Host::files.clear();
+    History::meta = {0, 0};
+    History::appended = false;
+    History::doSetup();
+    Export::active = false;
+    chunks.clear();
+}
+
+void tearDown() {}
+
+// Greenhouse readings every minute: a daily swing with sensor noise, hundredths of a unit
+void fillGreenhouse(uint32_t count)
+{
+    Greenhouse::Data_s data = {};
+    randomSeed(3);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        double day = sin(i * 2 * M_PI / 1440);
+        for (uint8_t c = 0; c < Greenhouse::CHANNEL_COUNT; c++)
+        {
+            bool temperature = c <= Greenhouse::TEMP3;
+            double base = temperature ? 2200 + 600 * day : 7500 - 1500 * day;
+            data.values[c] = (int16_t)(base + c * 40 + random(-4, 5));
+            data.quality[c] = Greenhouse::QUALITY_OK;
+        }
+        // A slave dropout now and then
+        if (i % 1000 >= 990)
+        {
+            data.quality[Greenhouse::HUM3] = Greenhouse::QUALITY_STALE;
+        }
+        History::append(data, 1700000000 + i * 60);
+        Host::advanceMs(History::INTERVAL);
+    }
+}
+
+// Every channel a random walk of up to 1 unit a step, no structure to compress
+void fillRandomWalk(uint32_t count)
+{
+    Greenhouse::Data_s data = {};
+    randomSeed(5);
+    for (uint8_t c = 0; c < Greenhouse::CHANNEL_COUNT; c++)
+    {
+        data.values[c] = 2000;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (uint8_t c = 0; c < Greenhouse::CHANNEL_COUNT; c++)
+        {
+            data.values[c] += random(-100, 101);
+        }
+        History::append(data, 1700000000 + i * 60);
+        Host::advanceMs(History::INTERVAL);
+    }
+}
+
+// Runs an export of the whole history, returns the host time it took
+double exportAll()
+{
+    auto start = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(Export::begin(0, History::size(), collect));
+    uint32_t steps = 0;
+    while (!Export::doStep())
+    {
+        steps++;
+        TEST_ASSERT_LESS_THAN(History::size(), steps);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Decodes every chunk and checks each record against the store
+double decodeAndCheck(uint32_t &decoded)
+{
+    decoded = 0;
+    double ns = 0;
+    for (const std::vector<uint8_t> &bytes : chunks)
+    {
+        TEST_ASSERT_LESS_OR_EQUAL(Export::CHUNK, bytes.size());
+        ExportDecoder::Chunk_s chunk;
+        auto start = std::chrono::steady_clock::now();
+        TEST_ASSERT_TRUE(ExportDecoder::decodeChunk(bytes.data(), bytes.size(), chunk));
+        ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::vector<History::Record_s> stored(chunk.records.size());
+        TEST_ASSERT_EQUAL_UINT32(chunk.records.size(), History::read(chunk.first, stored.data(), stored.size()));
+        for (size_t i = 0; i < stored.size(); i++)
+        {
+            TEST_ASSERT_EQUAL_UINT32(stored[i].time, chunk.records[i].time);
+            TEST_ASSERT_EQUAL_MEMORY(stored[i].values, chunk.records[i].values, sizeof(stored[i].values));
+            TEST_ASSERT_EQUAL_MEMORY(stored[i].quality, chunk.records[i].quality, sizeof(stored[i].quality));
+        }
+        decoded += chunk.records.size();
+    }
+    return ns;
+}
+
+void report(const char *name, double encodeNs, double decodeNs)
+{
+    uint32_t stored = Export::records * sizeof(History::Record_s);
+    char line[200];
+    snprintf(line, sizeof(line), "%s: %u records, %u stored -> %u encoded -> %u bytes in %u chunks (%.1f%% of stored), export %.1f MB/s, decode %.1f MB/s",
+             name, Export::records, stored, Export::rawBytes, Export::compressedBytes, (unsigned)chunks.size(),
+             100.0 * Export::compressedBytes / stored, stored / encodeNs * 1000, stored / decodeNs * 1000);
+    TEST_MESSAGE(line);
+}
+
+void test_greenhouse_trace_round_trip()
+{
+    fillGreenhouse(20160);
+    double encodeNs = exportAll();
+    uint32_t decoded;
+    double decodeNs = decodeAndCheck(decoded);
+    report("2 weeks of readings", encodeNs, decodeNs);
+    TEST_ASSERT_EQUAL_UINT32(20160, decoded);
+    // Deltas of a few units pack into about a quarter of the store
+    TEST_ASSERT_LESS_THAN(Export::records * sizeof(History::Record_s) * 30 / 100, Export::compressedBytes);
+}
+
+void test_random_walk_round_trip()
+{
+    fillRandomWalk(2000);
+    double encodeNs = exportAll();
+    uint32_t decoded;
+    double decodeNs = decodeAndCheck(decoded);
+    report("2000 random walk records", encodeNs, decodeNs);
+    TEST_ASSERT_EQUAL_UINT32(2000, decoded);
+    // Incompressible deltas: LZSS adds at most a ninth, chunk headers a little more
+    TEST_ASSERT_LESS_THAN(Export::rawBytes * 9 / 8 + chunks.size() * (Export::HEADER + 2), Export::compressedBytes);
+}
+
+void test_chunks_decode_on_their_own()
+{
+    fillGreenhouse(3000);
+    exportAll();
+    TEST_ASSERT_GREATER_THAN(3, chunks.size());
+    // Lose the second chunk, decode the others in reverse order
+    uint32_t lostFirst, lostCount;
+    ExportDecoder::Chunk_s chunk;
+    TEST_ASSERT_TRUE(ExportDecoder::decodeChunk(chunks[1].data(), chunks[1].size(), chunk));
+    lostFirst = chunk.first;
+    lostCount = chunk.records.size();
+    chunks.erase(chunks.begin() + 1);
+    std::reverse(chunks.begin(), chunks.end());
+    uint32_t decoded;
+    decodeAndCheck(decoded);
+    TEST_ASSERT_EQUAL_UINT32(3000 - lostCount, decoded);
+    TEST_ASSERT_GREATER_THAN(0, lostFirst);
+}
+
+void test_truncated_chunk_is_rejected()
+{
+    fillGreenhouse(500);
+    exportAll();
+    ExportDecoder::Chunk_s chunk;
+    const std::vector<uint8_t> &bytes = chunks[0];
+    TEST_ASSERT_FALSE(ExportDecoder::decodeChunk(bytes.data(), bytes.size() / 2, chunk));
+    TEST_ASSERT_EQUAL_UINT32(0, chunk.records.size());
+    TEST_ASSERT_FALSE(ExportDecoder::decodeChunk(bytes.data(), 3, chunk));
+}
+
+void test_partial_range()
+{
+    fillGreenhouse(500);
+    TEST_ASSERT_TRUE(Export::begin(100, 50, collect));
+    while (!Export::doStep())
+    {
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, chunks.size());
+    ExportDecoder::Chunk_s chunk;
+    TEST_ASSERT_TRUE(ExportDecoder::decodeChunk(chunks[0].data(), chunks[0].size(), chunk));
+    TEST_ASSERT_EQUAL_UINT32(100, chunk.first);
+    TEST_ASSERT_EQUAL_UINT32(50, chunk.records.size());
+    TEST_ASSERT_EQUAL_UINT32(1700000000 + 100 * 60, chunk.records[0].time);
+}
+
+void test_refused_chunk_is_sent_again()
+{
+    fillGreenhouse(3000);
+    exportAll();
+    uint32_t clean = chunks.size();
+    uint32_t cleanBytes = Export::compressedBytes;
+    std::vector<std::vector<uint8_t>> expected = chunks;
+    chunks.clear();
+    refused = 0;
+    offered = false;
+    TEST_ASSERT_TRUE(Export::begin(0, History::size(), collectSecondTime));
+    uint32_t steps = 0;
+    while (!Export::doStep())
+    {
+        steps++;
+        TEST_ASSERT_LESS_THAN(2 * History::size(), steps);
+    }
+    // Every chunk, the last one included, refused once and then sent unchanged
+    TEST_ASSERT_EQUAL_UINT32(clean, refused);
+    TEST_ASSERT_EQUAL_UINT32(clean, Export::retries);
+    TEST_ASSERT_TRUE(expected == chunks);
+    TEST_ASSERT_EQUAL_UINT32(3000, Export::records);
+    TEST_ASSERT_EQUAL_UINT32(cleanBytes, Export::compressedBytes);
+    uint32_t decoded;
+    decodeAndCheck(decoded);
+    TEST_ASSERT_EQUAL_UINT32(3000, decoded);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_greenhouse_trace_round_trip);
+    RUN_TEST(test_random_walk_round_trip);
+    RUN_TEST(test_chunks_decode_on_their_own);
+    RUN_TEST(test_truncated_chunk_is_rejected);
+    RUN_TEST(test_partial_range);
+    RUN_TEST(test_refused_chunk_is_sent_again);
+    return UNITY_END();
+}
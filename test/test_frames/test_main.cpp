@@ -0,0 +1,127 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Frame scheduler (tfthelper.h): coalescing of invalidations, urgent first pass and deferral over budget
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <unity.h>
+#include "tfthelper.h"
+
+// Widgets of IDLE bound to a channel, by index
+std::vector<uint8_t> bound;
+
+void setUp()
+{
+    Host::pixelNs = 0;
+    Host::commandNs = 0;
+    SpriteCache::clear();
+    Snapshot::clear();
+    TFT::setState(TFT::TFTStates::IDLE);
+    TFT::render();
+    TFT::pendingCapture = false;
+    TFT::frames = 0;
+    TFT::droppedFrames = 0;
+    TFT::coalesced = 0;
+    TFT::deferred = 0;
+    TFT::maxFrameUs = 0;
+    bound.clear();
+    for (uint8_t i = 0; i < sizeof(Layout::IDLE) / sizeof(Layout::IDLE[0]); i++)
+    {
+        if (Layout::IDLE[i].channel != Layout::NONE)
+        {
+            bound.push_back(i);
+        }
+    }
+}
+
+void tearDown()
+{
+    Host::pixelNs = 0;
+}
+
+bool dirty(uint8_t index)
+{
+    return (TFT::dirtyWidgets | TFT::dirtyValues) & (1UL << index);
+}
+
+void test_invalidations_within_a_frame_are_coalesced()
+{
+    TEST_ASSERT_GREATER_THAN(2, bound.size());
+    Host::advanceMs(TFT::FRAME_MS);
+    TFT::doTick();
+    TEST_ASSERT_EQUAL_UINT32(0, TFT::frames);
+    // Three readings, an alarm change and a touch before the next frame is due
+    TFT::lastFrameMs = Clock::now();
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        TFT::newData = true;
+        TFT::doTick();
+        Host::advanceMs(5);
+    }
+    TFT::invalidateChannels(true);
+    TFT::invalidateWidget(bound[0], true);
+    TEST_ASSERT_EQUAL_UINT32(0, TFT::frames);
+    // The second and third reading, and the touch on a widget the alarm change already marked
+    TEST_ASSERT_EQUAL_UINT32(2 * bound.size() + 1, TFT::coalesced);
+    Host::advanceMs(TFT::FRAME_MS);
+    TFT::doTick();
+    TEST_ASSERT_EQUAL_UINT32(1, TFT::frames);
+    TEST_ASSERT_EQUAL_UINT32(0, TFT::deferred);
+    TEST_ASSERT_EQUAL_UINT32(0, TFT::dirtyWidgets | TFT::dirtyValues | TFT::urgentWidgets);
+}
+
+void test_over_budget_frame_draws_urgent_first_and_defers_the_rest()
+{
+    // About 50 ms a widget, each one alone is over the frame budget
+    Host::pixelNs = 10000;
+    TFT::invalidateChannels(true);
+    uint8_t n = bound.size();
+    uint8_t touched = bound.back();
+    TFT::invalidateWidget(touched, true);
+    TFT::render();
+    // Only the touched widget, although it comes last in the layout
+    TEST_ASSERT_FALSE(dirty(touched));
+    for (uint8_t i = 0; i + 1 < n; i++)
+    {
+        TEST_ASSERT_TRUE(dirty(bound[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT32(bound.size() - 1, TFT::deferred);
+    TEST_ASSERT_EQUAL_UINT32(1, TFT::droppedFrames);
+    // Later frames draw one deferred widget each, in layout order
+    for (uint8_t i = 0; i + 1 < n; i++)
+    {
+        TFT::render();
+        TEST_ASSERT_FALSE(dirty(bound[i]));
+        if (i + 2 < n)
+        {
+            TEST_ASSERT_TRUE(dirty(bound[i + 1]));
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(bound.size(), TFT::frames);
+    TEST_ASSERT_EQUAL_UINT32(0, TFT::dirtyWidgets | TFT::dirtyValues);
+    // Deferred once per frame they waited
+    TEST_ASSERT_EQUAL_UINT32((bound.size() - 1) * bound.size() / 2, TFT::deferred);
+}
+
+void test_frame_within_budget_defers_nothing()
+{
+    Host::pixelNs = 100;
+    TFT::invalidateChannels(true);
+    TFT::render();
+    TEST_ASSERT_EQUAL_UINT32(0, TFT::deferred);
+    TEST_ASSERT_EQUAL_UINT32(0, TFT::droppedFrames);
+    TEST_ASSERT_LESS_OR_EQUAL(TFT::FRAME_MS * 1000, TFT::maxFrameUs);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_invalidations_within_a_frame_are_coalesced);
+    RUN_TEST(test_over_budget_frame_draws_urgent_first_and_defers_the_rest);
+    RUN_TEST(test_frame_within_budget_defers_nothing);
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Reading history (history.h): ring order, META_FILE write interval and recovery after a restart
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <unity.h>
+#include "history.h"
+
+const uint32_t T0 = 1700000000;
+
+void setUp()
+{
+    Host::files.clear();
+    History::appended = false;
+    History::doSetup();
+}
+
+void tearDown() {}
+
+// Appends records numbered by time, one a minute
+void fill(uint32_t first, uint32_t count)
+{
+    Greenhouse::Data_s data = {};
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        data.values[0] = i % 30000;
+        History::append(data, T0 + i * 60);
+        Host::advanceMs(History::INTERVAL);
+    }
+}
+
+// Ring position as stored in META_FILE
+History::Meta_s storedMeta()
+{
+    History::Meta_s meta = {0, 0};
+    File file = LittleFS.open(History::META_FILE, FILE_READ);
+    if (file)
+    {
+        file.read((uint8_t *)&meta, sizeof(meta));
+        file.close();
+    }
+    return meta;
+}
+
+// Power loss: the RAM state is gone, the files stay
+void restart()
+{
+    History::meta = {0, 0};
+    History::ready = false;
+    History::appended = false;
+    History::doSetup();
+}
+
+// Times of the oldest and newest record
+void checkEnds(uint32_t oldest, uint32_t newest)
+{
+    History::Record_s record;
+    TEST_ASSERT_EQUAL_UINT32(1, History::read(0, &record, 1));
+    TEST_ASSERT_EQUAL_UINT32(T0 + oldest * 60, record.time);
+    TEST_ASSERT_EQUAL_UINT32(1, History::read(History::size() - 1, &record, 1));
+    TEST_ASSERT_EQUAL_UINT32(T0 + newest * 60, record.time);
+}
+
+void test_meta_written_every_meta_records()
+{
+    fill(0, History::META_RECORDS - 1);
+    TEST_ASSERT_FALSE(LittleFS.exists(History::META_FILE));
+    fill(History::META_RECORDS - 1, 1);
+    TEST_ASSERT_EQUAL_UINT32(History::META_RECORDS, storedMeta().count);
+    fill(History::META_RECORDS, 2 * History::META_RECORDS + 5);
+    TEST_ASSERT_EQUAL_UINT32(3 * History::META_RECORDS, storedMeta().count);
+    TEST_ASSERT_EQUAL_UINT32(3 * History::META_RECORDS + 5, History::size());
+}
+
+void test_restart_recovers_records_past_the_meta()
+{
+    fill(0, 25);
+    restart();
+    TEST_ASSERT_EQUAL_UINT32(25, History::size());
+    checkEnds(0, 24);
+    // Stored again, and the ring carries on after the last record
+    TEST_ASSERT_EQUAL_UINT32(25, storedMeta().count);
+    fill(25, 3);
+    History::Record_s records[28];
+    TEST_ASSERT_EQUAL_UINT32(28, History::read(0, records, 28));
+    for (uint32_t i = 0; i < 28; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(T0 + i * 60, records[i].time);
+    }
+    // Nothing written before the first meta
+    Host::files.clear();
+    History::doSetup();
+    fill(0, 4);
+    restart();
+    TEST_ASSERT_EQUAL_UINT32(4, History::size());
+}
+
+void test_restart_with_meta_in_step_adds_nothing()
+{
+    fill(0, 2 * History::META_RECORDS);
+    restart();
+    TEST_ASSERT_EQUAL_UINT32(2 * History::META_RECORDS, History::size());
+    checkEnds(0, 2 * History::META_RECORDS - 1);
+}
+
+void test_restart_after_wrap()
+{
+    // The meta falls 5 records behind just after the ring wraps
+    fill(0, History::MAX_RECORDS + 15);
+    TEST_ASSERT_EQUAL_UINT32(10, storedMeta().head);
+    restart();
+    TEST_ASSERT_EQUAL_UINT32(History::MAX_RECORDS, History::size());
+    TEST_ASSERT_EQUAL_UINT32(15, History::meta.head);
+    checkEnds(15, History::MAX_RECORDS + 14);
+    // Full ring and meta in step: the record at the head is the oldest, not a newer one
+    fill(History::MAX_RECORDS + 15, 5);
+    restart();
+    TEST_ASSERT_EQUAL_UINT32(20, History::meta.head);
+    checkEnds(20, History::MAX_RECORDS + 19);
+}
+
+void test_invalid_meta_resets_history()
+{
+    fill(0, 25);
+    History::Meta_s meta = {History::MAX_RECORDS, 0};
+    File file = LittleFS.open(History::META_FILE, FILE_WRITE);
+    file.write((const uint8_t *)&meta, sizeof(meta));
+    file.close();
+    restart();
+    TEST_ASSERT_EQUAL_UINT32(0, History::size());
+    fill(0, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, History::size());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_meta_written_every_meta_records);
+    RUN_TEST(test_restart_recovers_records_past_the_meta);
+    RUN_TEST(test_restart_with_meta_in_step_adds_nothing);
+    RUN_TEST(test_restart_after_wrap);
+    RUN_TEST(test_invalid_meta_resets_history);
+    return UNITY_END();
+}
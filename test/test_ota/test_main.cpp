@@ -0,0 +1,291 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Firmware update (ota.h) over the serial link from the stand-in sender (host/ota_sender.h)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * The update partition is the file Host::partitionFile with NOR flash semantics, the metadata
+ * lives in the in-memory LittleFS. A reboot resets the module state and runs Ota::doSetup()
+ * again with both kept, like a power cycle.
+ */
+#include <unity.h>
+#include "seriallink.h"
+#include "ota_sender.h"
+
+class LoopbackPort : public LinkClient::Port
+{
+public:
+    size_t write(const uint8_t *data, size_t length) override
+    {
+        Host::serialRx.insert(Host::serialRx.end(), data, data + length);
+        return length;
+    }
+    int read() override
+    {
+        if (Host::serialTx.empty())
+        {
+            return -1;
+        }
+        uint8_t byte = Host::serialTx.front();
+        Host::serialTx.erase(Host::serialTx.begin());
+        return byte;
+    }
+};
+
+LoopbackPort port;
+std::vector<uint8_t> image;
+
+// Image with a valid header byte, the rest pseudo random
+std::vector<uint8_t> makeImage(uint32_t size)
+{
+    std::vector<uint8_t> bytes(size);
+    randomSeed(size);
+    for (uint8_t &b : bytes)
+    {
+        b = random(256);
+    }
+    bytes[0] = ESP_IMAGE_HEADER_MAGIC;
+    return bytes;
+}
+
+// Power cycle: RAM state is lost, flash and LittleFS are kept
+void reboot()
+{
+    Ota::state = Ota::IDLE;
+    Ota::received = 0;
+    Ota::verified = 0;
+    Ota::error = Ota::STATUS_OK;
+    SerialLink::connected = false;
+    SerialLink::otaVerifying = false;
+    SerialLink::rxLength = 0;
+    SerialLink::txHead = SerialLink::txTail = 0;
+    Host::serialRx.clear();
+    Host::serialTx.clear();
+    Ota::doSetup();
+}
+
+// Runs the device until the sender is done or stalls
+void run(OtaSender::Sender &sender, LinkClient::Client &client, uint32_t maxPasses = 100000)
+{
+    LinkClient::Frame_s frame;
+    for (uint32_t i = 0; i < maxPasses && !sender.done(); i++)
+    {
+        size_t pending = Host::serialRx.size();
+        SerialLink::doTick();
+        Ota::doTick();
+        Host::advanceUs(200);
+        bool progressed = pending != Host::serialRx.size();
+        while (client.receive(frame))
+        {
+            sender.handle(frame);
+            progressed = true;
+        }
+        // Nothing in either direction and no verification result to report: the sender stopped
+        if (!progressed && Host::serialRx.empty() && !SerialLink::otaVerifying)
+        {
+            return;
+        }
+    }
+}
+
+bool partitionMatches(const std::vector<uint8_t> &bytes)
+{
+    std::vector<uint8_t> flash(bytes.size());
+    esp_partition_read(&Host::otaPartition, 0, flash.data(), flash.size());
+    return flash == bytes;
+}
+
+void setUp()
+{
+    remove(Host::partitionFile);
+    Host::files.clear();
+    Host::bootPartition = nullptr;
+    Host::failWrites = 0xFFFFFFFF;
+    Host::erasedBytes = 0;
+    Host::restarted = false;
+    image = makeImage(100000);
+    reboot();
+}
+
+void tearDown()
+{
+    remove(Host::partitionFile);
+}
+
+void test_full_transfer_becomes_the_boot_partition()
+{
+    LinkClient::Client client(port);
+    OtaSender::Sender sender(client);
+    sender.begin(image);
+    run(sender, client);
+    TEST_ASSERT_EQUAL(OtaSender::DONE, sender.phase);
+    TEST_ASSERT_EQUAL_UINT32(sender.chunkCount(), sender.chunksSent);
+    TEST_ASSERT_EQUAL(Ota::READY, Ota::state);
+    TEST_ASSERT_TRUE(Host::bootPartition == &Host::otaPartition);
+    TEST_ASSERT_TRUE(partitionMatches(image));
+    // Only the sectors the image covers
+    TEST_ASSERT_EQUAL_UINT32((image.size() + Ota::SECTOR - 1) / Ota::SECTOR * Ota::SECTOR, Host::erasedBytes);
+    TEST_ASSERT_FALSE(LittleFS.exists(Ota::META_FILE));
+    // The reboot request restarts once acknowledged
+    sender.reboot();
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        SerialLink::doTick();
+    }
+    TEST_ASSERT_TRUE(Host::restarted);
+}
+
+void test_interrupted_transfer_resumes_after_reboot()
+{
+    LinkClient::Client client(port);
+    OtaSender::Sender first(client);
+    // The link drops 100 chunks in, past 6 sector boundaries
+    first.stopAfter = 100;
+    first.begin(image);
+    run(first, client);
+    TEST_ASSERT_FALSE(first.done());
+    TEST_ASSERT_EQUAL_UINT32(100, Ota::received);
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(96, Ota::meta.confirmed);
+    uint32_t erased = Host::erasedBytes;
+
+    OtaSender::Sender second(client);
+    second.begin(image);
+    run(second, client);
+    TEST_ASSERT_EQUAL(OtaSender::DONE, second.phase);
+    // Resumed from the last persisted sector, which is erased and written again
+    TEST_ASSERT_EQUAL_UINT32(96, second.resumedFrom);
+    TEST_ASSERT_EQUAL_UINT32(second.chunkCount() - 96, second.chunksSent);
+    TEST_ASSERT_EQUAL_UINT32((image.size() + Ota::SECTOR - 1) / Ota::SECTOR * Ota::SECTOR - 6 * Ota::SECTOR, Host::erasedBytes - erased);
+    TEST_ASSERT_TRUE(partitionMatches(image));
+    TEST_ASSERT_TRUE(Host::bootPartition == &Host::otaPartition);
+}
+
+void test_other_image_after_reboot_starts_over()
+{
+    LinkClient::Client client(port);
+    OtaSender::Sender first(client);
+    first.stopAfter = 40;
+    first.begin(image);
+    run(first, client);
+    reboot();
+    std::vector<uint8_t> other = makeImage(50000);
+    OtaSender::Sender second(client);
+    second.begin(other);
+    run(second, client);
+    TEST_ASSERT_EQUAL(OtaSender::DONE, second.phase);
+    TEST_ASSERT_EQUAL_UINT32(0, second.resumedFrom);
+    TEST_ASSERT_TRUE(partitionMatches(other));
+}
+
+void test_corrupt_chunk_is_refused_and_sent_again()
+{
+    LinkClient::Client client(port);
+    OtaSender::Sender sender(client);
+    sender.corruptChunk = 17;
+    sender.begin(image);
+    run(sender, client);
+    TEST_ASSERT_EQUAL(OtaSender::DONE, sender.phase);
+    TEST_ASSERT_EQUAL_UINT32(1, sender.retries);
+    TEST_ASSERT_EQUAL_UINT32(sender.chunkCount() + 1, sender.chunksSent);
+    TEST_ASSERT_TRUE(partitionMatches(image));
+}
+
+void test_hash_mismatch_is_not_booted()
+{
+    LinkClient::Client client(port);
+    OtaSender::Sender sender(client);
+    uint8_t wrong[32] = {1, 2, 3};
+    sender.begin(image, wrong);
+    run(sender, client);
+    TEST_ASSERT_EQUAL(OtaSender::FAILED, sender.phase);
+    TEST_ASSERT_EQUAL(Ota::FAILED, Ota::state);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_BAD_HASH, sender.lastStatus);
+    TEST_ASSERT_NULL(Host::bootPartition);
+    // A failed image is not resumed
+    TEST_ASSERT_FALSE(LittleFS.exists(Ota::META_FILE));
+}
+
+void test_image_without_header_is_not_booted()
+{
+    image[0] = 0;
+    LinkClient::Client client(port);
+    OtaSender::Sender sender(client);
+    sender.begin(image);
+    run(sender, client);
+    TEST_ASSERT_EQUAL(OtaSender::FAILED, sender.phase);
+    TEST_ASSERT_NULL(Host::bootPartition);
+}
+
+void test_flash_error_fails_the_transfer()
+{
+    Host::failWrites = 20000;
+    LinkClient::Client client(port);
+    OtaSender::Sender sender(client);
+    sender.begin(image);
+    run(sender, client);
+    TEST_ASSERT_EQUAL(OtaSender::FAILED, sender.phase);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_FLASH_ERROR, sender.lastStatus);
+    TEST_ASSERT_EQUAL(Ota::FAILED, Ota::state);
+}
+
+void test_out_of_order_and_oversized()
+{
+    uint8_t status;
+    uint8_t sha[32] = {};
+    TEST_ASSERT_EQUAL_UINT32(0, Ota::begin(Host::otaPartition.size + 1, sha, status));
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_TOO_LARGE, status);
+    Ota::begin(image.size(), sha, status);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OK, status);
+    uint32_t crc = crc32_le(0, image.data() + Ota::CHUNK, Ota::CHUNK);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OUT_OF_ORDER, Ota::write(1, crc, image.data() + Ota::CHUNK, Ota::CHUNK));
+    crc = crc32_le(0, image.data(), 100);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_BAD_LENGTH, Ota::write(0, crc, image.data(), 100));
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OUT_OF_ORDER, Ota::finish());
+
+    // A chunk past the end of a sector aligned image touches no flash and keeps it complete
+    std::vector<uint8_t> aligned = makeImage(Ota::SECTOR);
+    Host::erasedBytes = 0;
+    Ota::begin(aligned.size(), sha, status);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OK, status);
+    for (uint32_t i = 0; i < Ota::chunkCount(); i++)
+    {
+        crc = crc32_le(0, aligned.data() + i * Ota::CHUNK, Ota::CHUNK);
+        TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OK, Ota::write(i, crc, aligned.data() + i * Ota::CHUNK, Ota::CHUNK));
+    }
+    crc = crc32_le(0, aligned.data(), Ota::CHUNK);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OUT_OF_ORDER, Ota::write(Ota::chunkCount(), crc, aligned.data(), Ota::CHUNK));
+    TEST_ASSERT_EQUAL_UINT32(Ota::SECTOR, Host::erasedBytes);
+    TEST_ASSERT_EQUAL_UINT32(Ota::chunkCount(), Ota::received);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OK, Ota::finish());
+
+    // Same past the end of an image with a short last chunk
+    reboot();
+    std::vector<uint8_t> odd = makeImage(Ota::CHUNK + 100);
+    Ota::begin(odd.size(), sha, status);
+    crc = crc32_le(0, odd.data(), Ota::CHUNK);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OK, Ota::write(0, crc, odd.data(), Ota::CHUNK));
+    crc = crc32_le(0, odd.data() + Ota::CHUNK, 100);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OK, Ota::write(1, crc, odd.data() + Ota::CHUNK, 100));
+    crc = crc32_le(0, odd.data(), Ota::CHUNK);
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OUT_OF_ORDER, Ota::write(2, crc, odd.data(), Ota::CHUNK));
+    TEST_ASSERT_EQUAL_UINT8(Ota::STATUS_OK, Ota::finish());
+    TEST_ASSERT_TRUE(partitionMatches(odd));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_full_transfer_becomes_the_boot_partition);
+    RUN_TEST(test_interrupted_transfer_resumes_after_reboot);
+    RUN_TEST(test_other_image_after_reboot_starts_over);
+    RUN_TEST(test_corrupt_chunk_is_refused_and_sent_again);
+    RUN_TEST(test_hash_mismatch_is_not_booted);
+    RUN_TEST(test_image_without_header_is_not_booted);
+    RUN_TEST(test_flash_error_fails_the_transfer);
+    RUN_TEST(test_out_of_order_and_oversized);
+    return UNITY_END();
+}
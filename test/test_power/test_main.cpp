@@ -0,0 +1,233 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Tickless scheduling (power.h): duty cycle and sleep residency of the main loop on the simulated clock
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * loop() runs against the stand-ins, a light sleep advances the simulated clock to the next
+ * deadline or touch. Each loop pass costs LOOP_US of CPU time, and panel writes cost bus time
+ * through the TFT stand-in, so the awake time is what the firmware would spend drawing.
+ */
+#include <unity.h>
+#include "power.h"
+
+// CPU time of one loop() pass without drawing
+const uint32_t LOOP_US = 150;
+// SPI time of one 16 bit pixel at 40 MHz
+const uint32_t PIXEL_NS = 400;
+// Entry and exit of light sleep
+const uint32_t SLEEP_OVERHEAD_US = 500;
+
+struct Run_s
+{
+    uint64_t elapsedUs;
+    uint64_t sleptUs;
+    uint32_t loops;
+    uint32_t sleeps;
+    uint32_t gpioWakes;
+    uint32_t screenSwitches;
+};
+
+// Touches at these times (ms from setUp), released after holdMs
+std::vector<uint32_t> touches;
+uint32_t holdMs = 100;
+// When the finger lifts, kept across runs since a sleep can end past the end of one
+uint64_t releaseUs = 0;
+size_t nextTouch = 0;
+uint64_t startUs = 0;
+
+void setUp()
+{
+    Host::files.clear();
+    Host::nowUs = 1000000;
+    Host::nextEventUs = 0;
+    Host::eventPin = Globals::touchIrqPin;
+    Host::pixelNs = PIXEL_NS;
+    Host::sleepOverheadUs = SLEEP_OVERHEAD_US;
+    Host::pins[Globals::touchIrqPin] = HIGH;
+    // GDO0 only goes high on a received packet
+    Host::pins[Globals::radioGdo0Pin] = LOW;
+    Host::touchX = 0;
+    Host::touchY = 0;
+    startUs = Host::nowUs;
+    touches.clear();
+    nextTouch = 0;
+    holdMs = 100;
+    releaseUs = 0;
+    TFT::backlight = TFT::BACKLIGHT_FULL;
+    TFT::doSetup();
+    TFT::setState(TFT::TFTStates::IDLE);
+    Radio::doSetup();
+    Radio::polling = true;
+    Power::doSetup();
+}
+
+void tearDown()
+{
+    Host::pixelNs = 0;
+    Host::sleepOverheadUs = 0;
+    Host::eventPin = -1;
+}
+
+/**
+ * Runs loop() for the given simulated time. Power::report() clears its counters every minute,
+ * so the sleep time is summed here one Power::doTick() at a time.
+ */
+Run_s run(uint32_t ms)
+{
+    Run_s r = {};
+    uint64_t start = Host::nowUs;
+    uint64_t end = start + (uint64_t)ms * 1000;
+    TFT::TFTStates screen = TFT::stateCurrent;
+    while (Host::nowUs < end)
+    {
+        // A touch pulls the line low, during a sleep or while awake, until the finger lifts
+        if (nextTouch < touches.size())
+        {
+            Host::nextEventUs = startUs + (uint64_t)touches[nextTouch] * 1000;
+            if (Host::nowUs >= Host::nextEventUs)
+            {
+                if (Host::pins[Globals::touchIrqPin] == HIGH)
+                {
+                    Host::pins[Globals::touchIrqPin] = LOW;
+                    TFT::touchISR();
+                }
+                Host::nextEventUs = 0;
+                releaseUs = Host::nowUs + (uint64_t)holdMs * 1000;
+                nextTouch++;
+            }
+        }
+        if (releaseUs != 0 && Host::nowUs >= releaseUs)
+        {
+            Host::pins[Globals::touchIrqPin] = HIGH;
+            releaseUs = 0;
+        }
+
+        TFT::doTick();
+        Radio::doTick();
+        SerialLink::doTick();
+        Ota::doTick();
+        Trace::doTick();
+        Host::advanceUs(LOOP_US);
+        if (TFT::stateCurrent != screen)
+        {
+            screen = TFT::stateCurrent;
+            r.screenSwitches++;
+        }
+
+        uint64_t slept = Power::sleptUs;
+        uint32_t sleeps = Power::sleeps;
+        uint32_t gpioWakes = Power::gpioWakes;
+        Power::doTick();
+        // A report in between starts the counters over
+        r.sleptUs += Power::sleptUs >= slept ? Power::sleptUs - slept : Power::sleptUs;
+        r.sleeps += Power::sleeps >= sleeps ? Power::sleeps - sleeps : Power::sleeps;
+        r.gpioWakes += Power::gpioWakes >= gpioWakes ? Power::gpioWakes - gpioWakes : Power::gpioWakes;
+        r.loops++;
+    }
+    r.elapsedUs = Host::nowUs - start;
+    return r;
+}
+
+void print(const char *name, const Run_s &r)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "%s: %.2f%% asleep, duty cycle %.3f%%, %u loops, %u sleeps (%u on touch), %.1f ms awake per minute",
+             name, 100.0 * r.sleptUs / r.elapsedUs, 100.0 * (r.elapsedUs - r.sleptUs) / r.elapsedUs, r.loops, r.sleeps,
+             r.gpioWakes, (r.elapsedUs - r.sleptUs) / 1000.0 / (r.elapsedUs / 60e6));
+    TEST_MESSAGE(line);
+}
+
+void test_backlight_is_on_its_own_pin()
+{
+    TEST_ASSERT_EQUAL_INT(Globals::backlightPin, Host::ledcPin[LEDC_CHANNEL_0]);
+    TEST_ASSERT_NOT_EQUAL(Globals::i2cSdaPin, Globals::backlightPin);
+    TEST_ASSERT_NOT_EQUAL(Globals::i2cSclPin, Globals::backlightPin);
+    TEST_ASSERT_NOT_EQUAL(Globals::touchIrqPin, Globals::backlightPin);
+    TEST_ASSERT_NOT_EQUAL(Globals::radioGdo0Pin, Globals::backlightPin);
+    // Input only pins can't drive the LEDC
+    TEST_ASSERT_LESS_THAN(34, Globals::backlightPin);
+}
+
+void test_idle_polling_sleeps_between_deadlines()
+{
+    Run_s r = run(10 * 60000);
+    print("idle, polling every 5 s", r);
+    // One poll and one frame every 5 s, nothing else wakes us
+    TEST_ASSERT_EQUAL_UINT32(0, r.gpioWakes);
+    TEST_ASSERT_LESS_THAN(r.elapsedUs / 1000 / Globals::pollDelay * 4, r.sleeps);
+    TEST_ASSERT_GREATER_THAN(99.0 * r.elapsedUs / 100, r.sleptUs);
+    // Dimmed and then dark
+    TEST_ASSERT_EQUAL_UINT32(TFT::BACKLIGHT_OFF, Host::ledcDuty[LEDC_CHANNEL_0]);
+}
+
+void test_touches_wake_the_loop_and_the_backlight()
+{
+    touches = {10000, 40000, 200000, 200500};
+    Run_s r = run(45000);
+    TEST_ASSERT_EQUAL_UINT32(TFT::BACKLIGHT_FULL, Host::ledcDuty[LEDC_CHANNEL_0]);
+    Run_s rest = run(10 * 60000 - 45000);
+    r.elapsedUs += rest.elapsedUs;
+    r.sleptUs += rest.sleptUs;
+    r.loops += rest.loops;
+    r.sleeps += rest.sleeps;
+    r.gpioWakes += rest.gpioWakes;
+    r.screenSwitches += rest.screenSwitches;
+    print("4 touches in 10 min", r);
+    TEST_ASSERT_GREATER_OR_EQUAL(touches.size(), r.gpioWakes);
+    // Full screen redraws after the touches still leave the loop asleep most of the time
+    TEST_ASSERT_GREATER_THAN(95.0 * r.elapsedUs / 100, r.sleptUs);
+}
+
+void test_held_touch_switches_screen_once()
+{
+    // On the cog of IDLE, where CONFIG has its back button
+    const ButtonWidget::Spec &cog = Layout::IDLE[0];
+    TEST_ASSERT_EQUAL_UINT8(Layout::IDLE_CONFIG, cog.id);
+    Host::touchX = cog.startx + cog.sizex / 2;
+    Host::touchY = cog.starty + cog.sizey / 2;
+    const uint32_t holds[] = {150, 3000};
+    for (uint32_t hold : holds)
+    {
+        TFT::setState(TFT::TFTStates::IDLE);
+        run(100);
+        startUs = Host::nowUs;
+        touches = {1000};
+        nextTouch = 0;
+        holdMs = hold;
+        Run_s r = run(1000 + hold + 1000);
+        char line[96];
+        snprintf(line, sizeof(line), "touch held %u ms: %u screen switches, %u sleeps, %.1f%% asleep",
+                 hold, r.screenSwitches, r.sleeps, 100.0 * r.sleptUs / r.elapsedUs);
+        TEST_MESSAGE(line);
+        // One press, one switch
+        TEST_ASSERT_EQUAL_UINT32(1, r.screenSwitches);
+        TEST_ASSERT_TRUE(TFT::stateCurrent == TFT::TFTStates::CONFIG);
+        // The held line doesn't keep the chip awake
+        TEST_ASSERT_GREATER_THAN(90.0 * r.elapsedUs / 100, r.sleptUs);
+    }
+}
+
+void test_backlight_dims_and_blanks_on_schedule()
+{
+    run(Globals::dimDelay - 1000);
+    TEST_ASSERT_EQUAL_UINT32(TFT::BACKLIGHT_FULL, Host::ledcDuty[LEDC_CHANNEL_0]);
+    run(2000);
+    TEST_ASSERT_EQUAL_UINT32(TFT::BACKLIGHT_DIM, Host::ledcDuty[LEDC_CHANNEL_0]);
+    run(Globals::blankDelay - Globals::dimDelay);
+    TEST_ASSERT_EQUAL_UINT32(TFT::BACKLIGHT_OFF, Host::ledcDuty[LEDC_CHANNEL_0]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_backlight_is_on_its_own_pin);
+    RUN_TEST(test_idle_polling_sleeps_between_deadlines);
+    RUN_TEST(test_touches_wake_the_loop_and_the_backlight);
+    RUN_TEST(test_held_touch_switches_screen_once);
+    RUN_TEST(test_backlight_dims_and_blanks_on_schedule);
+    return UNITY_END();
+}
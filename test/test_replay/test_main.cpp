@@ -0,0 +1,244 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Record and replay (trace.h, replay.h): a replayed session renders and alarms like the live one
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * A live session is driven on the simulated clock with frames and touches and recorded to a trace.
+ * The modules are then reset and the trace replayed on the virtual clock. Alarm transitions and
+ * screen changes must happen at the same times and the final framebuffer must be identical. Frames
+ * must be drawn when the live loop drew them, within its 10 ms period, also between records.
+ */
+#include <unity.h>
+#include "tfthelper.h"
+#include "radiohelper.h"
+#include "trace.h"
+#include "replay.h"
+
+// Alarm and screen transitions, in order, with the time they were seen at
+struct Event_s
+{
+    uint32_t ms;
+    uint8_t channel;
+    bool active;
+};
+
+// Screen changes are logged as channel SCREEN_EVENT
+const uint8_t SCREEN_EVENT = 0xFE;
+std::vector<Event_s> events;
+bool activeBefore[Greenhouse::CHANNEL_COUNT];
+TFT::TFTStates screenBefore;
+// Times frames were drawn at
+std::vector<uint32_t> frameTimes;
+uint32_t lastFrameBefore;
+
+void resetModules()
+{
+    for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+    {
+        Alarms::stats[i] = Alarms::Stats();
+        Alarms::alarms[i] = Alarms::Alarm();
+        Sensors::states[i] = Sensors::State_s();
+        activeBefore[i] = false;
+    }
+    Alarms::changed = false;
+    memset(&Greenhouse::data, 0, sizeof(Greenhouse::data));
+    memset(&Greenhouse::config, 0, sizeof(Greenhouse::config));
+    Rules::compile(Rules::defaultSource);
+    SpriteCache::clear();
+    Snapshot::clear();
+    TFT::tft.fillScreen(TFT_BLACK);
+    TFT::tft.clearStrings();
+    TFT::touchPressed = false;
+    TFT::newData = false;
+    TFT::resetTouch();
+    TFT::last_ms = Clock::now();
+    TFT::lastActivityMs = Clock::now();
+    TFT::backlight = TFT::BACKLIGHT_FULL;
+    TFT::pendingCapture = false;
+    TFT::lastFrameMs = 0;
+    lastFrameBefore = 0;
+    frameTimes.clear();
+    TFT::setState(TFT::TFTStates::IDLE);
+    screenBefore = TFT::TFTStates::IDLE;
+    Radio::polling = false;
+    events.clear();
+}
+
+// One iteration of loop(), minus the modules not involved
+void loopOnce()
+{
+    Replay::doTick();
+    TFT::doTick();
+    Radio::doTick();
+    Trace::doTick();
+    for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+    {
+        if (Alarms::isActive(i) != activeBefore[i])
+        {
+            activeBefore[i] = Alarms::isActive(i);
+            events.push_back({Clock::now(), i, activeBefore[i]});
+        }
+    }
+    if (TFT::stateCurrent != screenBefore)
+    {
+        screenBefore = TFT::stateCurrent;
+        events.push_back({Clock::now(), SCREEN_EVENT, screenBefore == TFT::TFTStates::CONFIG});
+    }
+    // TFT::frames restarts at every report
+    if (TFT::lastFrameMs != lastFrameBefore)
+    {
+        lastFrameBefore = TFT::lastFrameMs;
+        frameTimes.push_back(TFT::lastFrameMs);
+    }
+}
+
+void frameAt(int16_t temp1, int16_t hum2)
+{
+    int16_t frame[Greenhouse::CHANNEL_COUNT] = {2300, 2300, 2300, 7000, hum2, 7000};
+    frame[Greenhouse::TEMP1] = temp1;
+    Radio::handleFrame(frame, Clock::now(), 0);
+}
+
+void touchAt(uint16_t x, uint16_t y)
+{
+    Host::touchX = x;
+    Host::touchY = y;
+    TFT::touchISR();
+}
+
+void setUp()
+{
+    Host::files.clear();
+    Host::nowUs = 1000000;
+    Clock::isVirtual = false;
+}
+
+void tearDown() {}
+
+void test_replay_matches_live_session()
+{
+    // Live session: a frame every 5 s for 10 minutes, loop() every 10 ms
+    resetModules();
+    TEST_ASSERT_TRUE(Trace::beginFile("/session.bin"));
+    for (uint32_t step = 0; step < 60000; step++)
+    {
+        uint32_t t = step * 10;
+        if (t % 5000 == 0)
+        {
+            // TEMP1 climbs over the 35 C limit at 2:00 and comes back at 5:00
+            int16_t temp1 = t < 120000 ? 2500 : (t < 300000 ? 3600 : 2500);
+            // HUM2 is out of range once, and over its limit from 7:00
+            int16_t hum2 = t == 60000 ? 12000 : (t < 420000 ? 7500 : 9500);
+            frameAt(temp1, hum2);
+        }
+        // The screen is dark by then, the first touch only turns the backlight on
+        if (t == 200000 || t == 205000)
+        {
+            touchAt(230, 380);
+        }
+        if (t == 230000)
+        {
+            touchAt(250, 400);
+        }
+        // A touch on a value widget only redraws it, the second one within FRAME_MS of a frame
+        if (t == 250000 || t == 255010)
+        {
+            touchAt(40, 30);
+        }
+        loopOnce();
+        Host::advanceMs(10);
+    }
+    Trace::end();
+    // Let the last frame render
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        loopOnce();
+        Host::advanceMs(10);
+    }
+    std::vector<Event_s> live = events;
+    std::vector<uint32_t> liveFrames = frameTimes;
+    std::vector<uint16_t> livePixels = TFT::tft.pixels;
+    Greenhouse::Data_s liveData = Greenhouse::data;
+
+    // Replay from a clean state, on the virtual clock
+    resetModules();
+    TEST_ASSERT_TRUE(Replay::begin("/session.bin"));
+    uint32_t loops = 0;
+    while (Replay::active && loops < 100000)
+    {
+        loopOnce();
+        loops++;
+    }
+    TEST_ASSERT_FALSE(Replay::active);
+    std::vector<uint32_t> replayFrames = frameTimes;
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        loopOnce();
+        Host::advanceMs(10);
+    }
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u live events, %u replayed, %u frames, in %u loops",
+             (unsigned)live.size(), (unsigned)events.size(), (unsigned)replayFrames.size(), loops);
+    TEST_MESSAGE(line);
+    // TEMP1 raised and cleared, HUM2 raised, two screen changes
+    TEST_ASSERT_EQUAL_UINT32(5, live.size());
+    TEST_ASSERT_EQUAL_UINT32(live.size(), events.size());
+    for (size_t i = 0; i < live.size(); i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(live[i].ms, events[i].ms);
+        TEST_ASSERT_EQUAL_UINT8(live[i].channel, events[i].channel);
+        TEST_ASSERT_EQUAL(live[i].active, events[i].active);
+    }
+    // A frame deferred by FRAME_MS after a record is drawn then, not at the next record
+    TEST_ASSERT_EQUAL_UINT32(liveFrames.size(), replayFrames.size());
+    for (size_t i = 0; i < liveFrames.size(); i++)
+    {
+        TEST_ASSERT_UINT32_WITHIN(10, liveFrames[i], replayFrames[i]);
+    }
+    TEST_ASSERT_EQUAL_MEMORY(liveData.values, Greenhouse::data.values, sizeof(liveData.values));
+    TEST_ASSERT_EQUAL_MEMORY(liveData.quality, Greenhouse::data.quality, sizeof(liveData.quality));
+    TEST_ASSERT_TRUE(TFT::stateCurrent == TFT::TFTStates::IDLE);
+    TEST_ASSERT_TRUE(Alarms::isActive(Greenhouse::HUM2));
+    TEST_ASSERT_FALSE(Alarms::isActive(Greenhouse::TEMP1));
+    // The same pixels, and the alarm value printed in red
+    TEST_ASSERT_TRUE(livePixels == TFT::tft.pixels);
+    TEST_ASSERT_TRUE(TFT::tft.printed("95.00%"));
+    bool red = false;
+    for (const TFT_eSPI::Text_s &s : TFT::tft.strings)
+    {
+        red |= s.text == "95.00%" && s.color == TFT_RED;
+    }
+    TEST_ASSERT_TRUE(red);
+}
+
+void test_trace_is_compact()
+{
+    resetModules();
+    TEST_ASSERT_TRUE(Trace::beginFile("/frames.bin"));
+    for (uint32_t i = 0; i < 720; i++)
+    {
+        frameAt(2300 + i % 7, 7000 - i % 5);
+        Host::advanceMs(5000);
+        Trace::doTick();
+    }
+    Trace::end();
+    size_t size = Host::files["/frames.bin"]->size();
+    char line[64];
+    snprintf(line, sizeof(line), "1 hour of frames: %u bytes", (unsigned)size);
+    TEST_MESSAGE(line);
+    // Type, time delta and 6 one-byte deltas per frame, plus a 3 byte clock mark per frame
+    TEST_ASSERT_LESS_OR_EQUAL(720 * (1 + 2 + 6 + 3) + 9, size);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_matches_live_session);
+    RUN_TEST(test_trace_is_compact);
+    return UNITY_END();
+}
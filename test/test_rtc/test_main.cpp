@@ -0,0 +1,58 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief DS3231 helper (rtchelper.h) against the stand-in on the I2C bus
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <unity.h>
+#include "rtchelper.h"
+
+void setUp()
+{
+    Host::nowUs = 0;
+    Host::rtcPresent = true;
+}
+
+void tearDown() {}
+
+void test_bus_stays_off_the_touch_and_backlight_pins()
+{
+    RTC::doSetup();
+    TEST_ASSERT_EQUAL_INT(Globals::i2cSdaPin, Host::sdaPin);
+    TEST_ASSERT_EQUAL_INT(Globals::i2cSclPin, Host::sclPin);
+    const uint8_t others[] = {Globals::touchIrqPin, Globals::radioGdo0Pin, Globals::backlightPin};
+    for (uint8_t pin : others)
+    {
+        TEST_ASSERT_NOT_EQUAL(pin, Host::sdaPin);
+        TEST_ASSERT_NOT_EQUAL(pin, Host::sclPin);
+    }
+}
+
+void test_date_and_time_strings()
+{
+    // The stand-in DS3231 holds 2021-03-14 15:09:26
+    RTC::doSetup();
+    TEST_ASSERT_TRUE(RTC::present);
+    TEST_ASSERT_EQUAL_UINT32(1615734566, RTC::epochMs(Clock::now()) / 1000);
+    RTC::readTime();
+    TEST_ASSERT_EQUAL_STRING("14/03/2021", RTC::currentDateString.c_str());
+    TEST_ASSERT_EQUAL_STRING("15:09:26", RTC::currentTimeString.c_str());
+    // December, the last month, and the last second of the year
+    RTC::syncEpochMs = 1640995199500ULL;
+    RTC::syncMs = Clock::now();
+    RTC::readTime();
+    TEST_ASSERT_EQUAL_STRING("31/12/2021", RTC::currentDateString.c_str());
+    TEST_ASSERT_EQUAL_STRING("23:59:59", RTC::currentTimeString.c_str());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bus_stays_off_the_touch_and_backlight_pins);
+    RUN_TEST(test_date_and_time_strings);
+    return UNITY_END();
+}
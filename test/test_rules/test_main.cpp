@@ -0,0 +1,183 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Rule compiler and interpreter (rules.h), and a simulated day through host/rulesim.h
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <unity.h>
+#include "rules.h"
+#include "rulesim.h"
+
+Greenhouse::Data_s data;
+Greenhouse::Config_s config;
+
+void setUp()
+{
+    memset(&data, 0, sizeof(data));
+    memset(&config, 0, sizeof(config));
+    for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+    {
+        data.values[i] = 2000;
+        data.quality[i] = Greenhouse::QUALITY_OK;
+    }
+    TEST_ASSERT_TRUE(Rules::compile(Rules::defaultSource));
+}
+
+void tearDown() {}
+
+void test_non_finite_constants_are_rejected()
+{
+    const char *sources[] = {"if temp1 > nan then fan=on",
+                             "if temp1 > inf then fan=on",
+                             "if temp1 < -infinity then fan=on",
+                             "if temp1 > NAN then fan=on",
+                             "if temp1 > 20 then fan=nan",
+                             "if temp1 > 20 for nan min then fan=on",
+                             "if temp1 > 20 for inf s then fan=on",
+                             "pid fan = temp1 to nan kp 1",
+                             "pid fan = temp1 to 26 kp 20 ki inf"};
+    for (const char *source : sources)
+    {
+        TEST_ASSERT_FALSE_MESSAGE(Rules::compile(source), source);
+        TEST_ASSERT_EQUAL_STRING("finite number expected", Rules::Compiler::error);
+    }
+    // The previous program is still loaded
+    data.values[Greenhouse::HUM2] = 9000;
+    Rules::run(data, config, 0);
+    TEST_ASSERT_TRUE(Rules::run(data, config, 121000));
+    TEST_ASSERT_EQUAL_UINT8(100, config.vent);
+}
+
+void test_comparisons_and_timer()
+{
+    TEST_ASSERT_TRUE(Rules::compile("if temp1 >= 30 and hum1 < 60 then fan=100, mister=on; if temp2 > 25 for 10 s then vent=40"));
+    data.values[Greenhouse::TEMP1] = 3000;
+    data.values[Greenhouse::HUM1] = 5999;
+    TEST_ASSERT_TRUE(Rules::run(data, config, 0));
+    TEST_ASSERT_EQUAL_UINT8(100, config.fan);
+    TEST_ASSERT_EQUAL_UINT8(100, config.mister);
+    data.values[Greenhouse::TEMP2] = 2501;
+    TEST_ASSERT_FALSE(Rules::run(data, config, 1000));
+    TEST_ASSERT_FALSE(Rules::run(data, config, 10999));
+    TEST_ASSERT_TRUE(Rules::run(data, config, 11000));
+    TEST_ASSERT_EQUAL_UINT8(40, config.vent);
+}
+
+void test_untrusted_readings_do_not_drive_actuators()
+{
+    TEST_ASSERT_TRUE(Rules::compile("if hum2 > 85 then vent=open; if hum2 <= 85 then vent=close; if temp1 < 10 or temp2 < 10 then fan=on"));
+    data.values[Greenhouse::HUM2] = 9500;
+    data.quality[Greenhouse::HUM2] = Greenhouse::QUALITY_STALE;
+    // Neither branch fires on a stale reading, the vent keeps its level
+    config.vent = 30;
+    TEST_ASSERT_FALSE(Rules::run(data, config, 0));
+    TEST_ASSERT_EQUAL_UINT8(30, config.vent);
+    data.quality[Greenhouse::HUM2] = Greenhouse::QUALITY_RANGE;
+    TEST_ASSERT_FALSE(Rules::run(data, config, 0));
+    data.quality[Greenhouse::HUM2] = Greenhouse::QUALITY_OK;
+    TEST_ASSERT_TRUE(Rules::run(data, config, 0));
+    TEST_ASSERT_EQUAL_UINT8(100, config.vent);
+    // An untrusted operand of "or" doesn't hide a trusted one
+    data.values[Greenhouse::TEMP1] = 500;
+    data.quality[Greenhouse::TEMP1] = Greenhouse::QUALITY_STALE;
+    TEST_ASSERT_FALSE(Rules::run(data, config, 0));
+    data.values[Greenhouse::TEMP2] = 500;
+    TEST_ASSERT_TRUE(Rules::run(data, config, 0));
+    TEST_ASSERT_EQUAL_UINT8(100, config.fan);
+}
+
+void test_pid_holds_on_untrusted_reading()
+{
+    TEST_ASSERT_TRUE(Rules::compile("pid fan = temp1 to 26 kp 20 ki 0.5 kd 0"));
+    data.values[Greenhouse::TEMP1] = 2800;
+    Rules::run(data, config, 0);
+    uint8_t level = config.fan;
+    TEST_ASSERT_EQUAL_UINT8(40, level);
+    data.values[Greenhouse::TEMP1] = 4000;
+    data.quality[Greenhouse::TEMP1] = Greenhouse::QUALITY_RANGE;
+    TEST_ASSERT_FALSE(Rules::run(data, config, 5000));
+    TEST_ASSERT_EQUAL_UINT8(level, config.fan);
+}
+
+// Simulated day: humidity swings across the vent limits, with a spike and a radio dropout
+uint32_t ventOpenedMs = 0;
+uint32_t ventClosedMs = 0;
+uint32_t staleSteps = 0;
+
+void observe(const RuleSim::Step_s &step)
+{
+    if (step.changed && step.config->vent == 100 && ventOpenedMs == 0)
+    {
+        ventOpenedMs = step.ms;
+    }
+    if (step.changed && step.config->vent == 0 && ventOpenedMs != 0 && ventClosedMs == 0)
+    {
+        ventClosedMs = step.ms;
+    }
+    if (step.data->quality[Greenhouse::HUM2] & Greenhouse::QUALITY_STALE)
+    {
+        staleSteps++;
+    }
+}
+
+void test_simulated_day_from_a_trace()
+{
+    Host::files.clear();
+    Clock::setVirtual(0);
+    TEST_ASSERT_TRUE(Trace::beginFile("/day.bin"));
+    int16_t frame[Greenhouse::CHANNEL_COUNT];
+    // One frame every 5 s for 4 hours
+    for (uint32_t t = 0; t < 4 * 3600; t += 5)
+    {
+        Clock::virtualMs = t * 1000;
+        Trace::doTick();
+        // Radio dropout between 1:00 and 1:05
+        if (t >= 3600 && t < 3900)
+        {
+            continue;
+        }
+        for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+        {
+            frame[i] = i <= Greenhouse::TEMP3 ? 2300 : 7000;
+        }
+        // Humidity climbs to 90% around 2:00 and back down by 3:00, with one bogus reading
+        int32_t hum = t < 5400 ? 7000 : (t < 7200 ? 7000 + (t - 5400) * 2000 / 1800 : (t < 9000 ? 9000 - (t - 7200) * 2000 / 1800 : 7000));
+        frame[Greenhouse::HUM2] = t == 3000 ? 12000 : hum;
+        Trace::recordFrame(frame);
+    }
+    Trace::end();
+    Clock::isVirtual = false;
+
+    File trace = LittleFS.open("/day.bin", FILE_READ);
+    RuleSim::Result_s result;
+    TEST_ASSERT_TRUE(RuleSim::run(trace, Rules::defaultSource, observe, result));
+    trace.close();
+    char line[128];
+    snprintf(line, sizeof(line), "%u frames, %u actuator changes, vent open at %u s, closed at %u s, eval avg/max %.0f/%.0f ns",
+             result.frames, result.changes, ventOpenedMs / 1000, ventClosedMs / 1000, result.totalEvalNs / result.frames, result.maxEvalNs);
+    TEST_MESSAGE(line);
+    // 85% is reached at 6750 s, the filters lag a few samples, then the 2 min hold
+    TEST_ASSERT_INT_WITHIN(30, 6750 + 120, ventOpenedMs / 1000);
+    // Below 75% from 8550 s
+    TEST_ASSERT_INT_WITHIN(30, 8550 + 120, ventClosedMs / 1000);
+    TEST_ASSERT_EQUAL_UINT32(2, result.changes);
+    // The dropout outlasted the 30 s stale timeout
+    TEST_ASSERT_GREATER_THAN(0, staleSteps);
+    // Evaluation stays in microseconds
+    TEST_ASSERT_LESS_THAN(10000, result.totalEvalNs / result.frames);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_non_finite_constants_are_rejected);
+    RUN_TEST(test_comparisons_and_timer);
+    RUN_TEST(test_untrusted_readings_do_not_drive_actuators);
+    RUN_TEST(test_pid_holds_on_untrusted_reading);
+    RUN_TEST(test_simulated_day_from_a_trace);
+    return UNITY_END();
+}
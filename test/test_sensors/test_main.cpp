@@ -0,0 +1,151 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Ingestion filters (sensors.h): calibration, range check, median, IIR and the stale flag
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <unity.h>
+#include "sensors.h"
+
+const uint8_t CH = Greenhouse::TEMP1;
+int16_t frame[Greenhouse::CHANNEL_COUNT];
+Greenhouse::Data_s data;
+
+void setUp()
+{
+    for (uint8_t i = 0; i < Greenhouse::CHANNEL_COUNT; i++)
+    {
+        Sensors::configure(i, {0, Sensors::UNITY_GAIN, -4000, 8000, 1, 0, 30000});
+        frame[i] = Greenhouse::MISSING;
+    }
+    memset(&data, 0, sizeof(data));
+}
+
+void tearDown() {}
+
+// Feeds one raw value to CH, returns the filtered value
+int16_t feed(int16_t raw, uint32_t ms = 0)
+{
+    frame[CH] = raw;
+    Sensors::ingest(frame, ms, data);
+    return data.values[CH];
+}
+
+void test_calibration()
+{
+    // value = raw * 1.5 + 1.20
+    Sensors::configure(CH, {120, Sensors::UNITY_GAIN * 3 / 2, -4000, 8000, 1, 0, 30000});
+    TEST_ASSERT_EQUAL_INT16(3120, feed(2000));
+    TEST_ASSERT_EQUAL_INT16(-1380, feed(-1000));
+    TEST_ASSERT_EQUAL_UINT8(Greenhouse::QUALITY_OK, data.quality[CH]);
+}
+
+void test_out_of_range_is_rejected()
+{
+    Sensors::configure(CH, {0, Sensors::UNITY_GAIN, 0, 5000, 3, 0, 30000});
+    feed(2000);
+    feed(2000);
+    // Above and below: the last good value stays, flagged
+    TEST_ASSERT_EQUAL_INT16(2000, feed(5001));
+    TEST_ASSERT_TRUE(data.quality[CH] & Greenhouse::QUALITY_RANGE);
+    TEST_ASSERT_EQUAL_INT16(2000, feed(-1));
+    TEST_ASSERT_TRUE(data.quality[CH] & Greenhouse::QUALITY_RANGE);
+    // The rejected values never reach the median window
+    TEST_ASSERT_EQUAL_UINT8(2, Sensors::states[CH].count);
+    TEST_ASSERT_EQUAL_INT16(2000, feed(2000));
+    TEST_ASSERT_EQUAL_UINT8(Greenhouse::QUALITY_OK, data.quality[CH]);
+    // The bounds themselves are plausible
+    TEST_ASSERT_EQUAL_INT16(2000, feed(5000));
+    TEST_ASSERT_EQUAL_UINT8(Greenhouse::QUALITY_OK, data.quality[CH]);
+}
+
+void test_median_rejects_a_single_spike()
+{
+    Sensors::configure(CH, {0, Sensors::UNITY_GAIN, -4000, 8000, 3, 0, 30000});
+    const int16_t raw[] = {2000, 2010, 7000, 2020, 2030, -3000, 2040};
+    const int16_t expected[] = {2000, 2005, 2010, 2020, 2030, 2020, 2030};
+    for (uint8_t i = 0; i < sizeof(raw) / sizeof(raw[0]); i++)
+    {
+        TEST_ASSERT_EQUAL_INT16(expected[i], feed(raw[i]));
+    }
+}
+
+void test_median_of_two_samples_is_their_mean()
+{
+    Sensors::configure(CH, {0, Sensors::UNITY_GAIN, -4000, 8000, 3, 0, 30000});
+    feed(2000);
+    // Neither sample wins while the window fills up
+    TEST_ASSERT_EQUAL_INT16(3000, feed(4000));
+    Sensors::configure(CH, {0, Sensors::UNITY_GAIN, -4000, 8000, 5, 0, 30000});
+    feed(-100);
+    TEST_ASSERT_EQUAL_INT16(-150, feed(-200));
+    feed(-300);
+    TEST_ASSERT_EQUAL_INT16(-250, feed(-400));
+    const int16_t full[] = {-100, -500, -300, -200, -400};
+    TEST_ASSERT_EQUAL_INT16(-300, Sensors::median(full, 5));
+}
+
+void test_iir_step_response()
+{
+    const uint8_t shift = 2;
+    Sensors::configure(CH, {0, Sensors::UNITY_GAIN, -4000, 8000, 1, shift, 30000});
+    // The first sample primes the filter, no ramp up from 0
+    TEST_ASSERT_EQUAL_INT16(1000, feed(1000));
+    // Step to 5000: y_n = 5000 - 4000 * (1 - 2^-shift)^n
+    double model = 1000;
+    uint8_t settled = 0;
+    for (uint8_t n = 1; n <= 40; n++)
+    {
+        model += (5000 - model) / (1 << shift);
+        int16_t value = feed(5000);
+        TEST_ASSERT_INT_WITHIN(1, lround(model), value);
+        if (settled == 0 && value > 5000 - 40)
+        {
+            settled = n;
+        }
+    }
+    // Closer than 1% of the step after ceil(log(0.01) / log(0.75)) = 17 samples
+    TEST_ASSERT_EQUAL_UINT8(17, settled);
+    TEST_ASSERT_EQUAL_INT16(5000, data.values[CH]);
+}
+
+void test_stale_after_timeout()
+{
+    // Never seen
+    Sensors::checkStale(0, data);
+    TEST_ASSERT_TRUE(data.quality[CH] & Greenhouse::QUALITY_STALE);
+    feed(2000, 1000);
+    TEST_ASSERT_EQUAL_UINT8(Greenhouse::QUALITY_OK, data.quality[CH]);
+    // Missing readings don't refresh the channel
+    frame[CH] = Greenhouse::MISSING;
+    Sensors::ingest(frame, 31000, data);
+    TEST_ASSERT_EQUAL_UINT8(Greenhouse::QUALITY_OK, data.quality[CH]);
+    Sensors::checkStale(31001, data);
+    TEST_ASSERT_TRUE(data.quality[CH] & Greenhouse::QUALITY_STALE);
+    TEST_ASSERT_EQUAL_INT16(2000, data.values[CH]);
+    // Out of range readings neither
+    Sensors::configure(CH, {0, Sensors::UNITY_GAIN, 0, 5000, 1, 0, 30000});
+    feed(2000, 40000);
+    feed(9000, 70001);
+    TEST_ASSERT_TRUE(data.quality[CH] & Greenhouse::QUALITY_STALE);
+    TEST_ASSERT_TRUE(data.quality[CH] & Greenhouse::QUALITY_RANGE);
+    // A valid reading clears both
+    feed(2100, 70002);
+    TEST_ASSERT_EQUAL_UINT8(Greenhouse::QUALITY_OK, data.quality[CH]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_calibration);
+    RUN_TEST(test_out_of_range_is_rejected);
+    RUN_TEST(test_median_rejects_a_single_spike);
+    RUN_TEST(test_median_of_two_samples_is_their_mean);
+    RUN_TEST(test_iir_step_response);
+    RUN_TEST(test_stale_after_timeout);
+    return UNITY_END();
+}
@@ -0,0 +1,341 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Serial link (seriallink.h) driven by the host client (host/seriallink_client.h), with a throughput benchmark
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * The client writes into the receive side of the stand-in Serial. What the firmware writes goes
+ * through a model of the UART: a transmit buffer the size set with setTxBufferSize() (the
+ * 128 byte FIFO if none), drained onto the wire at 921600 baud, 10 bits per byte.
+ */
+#include <unity.h>
+#include <chrono>
+#include "seriallink.h"
+#include "seriallink_client.h"
+
+const uint32_t BAUD = 921600;
+const uint16_t UART_FIFO = 128;
+
+// Bytes on the wire towards the host
+std::deque<uint8_t> wire;
+// Line time not yet spent on a whole byte, in bits
+uint64_t lineBits = 0;
+
+class LoopbackPort : public LinkClient::Port
+{
+public:
+    size_t write(const uint8_t *data, size_t length) override
+    {
+        Host::serialRx.insert(Host::serialRx.end(), data, data + length);
+        return length;
+    }
+    int read() override
+    {
+        if (wire.empty())
+        {
+            return -1;
+        }
+        uint8_t byte = wire.front();
+        wire.pop_front();
+        return byte;
+    }
+};
+
+LoopbackPort port;
+
+uint16_t uartBuffer()
+{
+    return Serial.txBufferSize > 0 ? Serial.txBufferSize : UART_FIFO;
+}
+
+// Lets simulated time pass, the UART shifts out what it holds
+void elapse(uint32_t us)
+{
+    Host::advanceUs(us);
+    lineBits += (uint64_t)us * BAUD / 1000000;
+    size_t n = min((size_t)(lineBits / 10), Host::serialTx.size());
+    lineBits -= n * 10;
+    wire.insert(wire.end(), Host::serialTx.begin(), Host::serialTx.begin() + n);
+    Host::serialTx.erase(Host::serialTx.begin(), Host::serialTx.begin() + n);
+    if (Host::serialTx.empty())
+    {
+        // An idle line doesn't bank time
+        lineBits = 0;
+    }
+    Host::serialTxRoom = uartBuffer() - Host::serialTx.size();
+}
+
+// Runs the link with a loop pass every 200 us until a frame other than debug output reaches the client
+bool exchange(LinkClient::Client &client, LinkClient::Frame_s &frame)
+{
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        SerialLink::doTick();
+        elapse(200);
+        while (client.receive(frame))
+        {
+            if (frame.type != SerialLink::MSG_LOG)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+uint8_t request(LinkClient::Client &client, uint8_t seq)
+{
+    LinkClient::Frame_s frame;
+    LinkClient::Ack_s ack;
+    TEST_ASSERT_TRUE(exchange(client, frame));
+    TEST_ASSERT_TRUE(LinkClient::parseAck(frame, ack));
+    TEST_ASSERT_EQUAL_UINT8(seq, ack.seq);
+    return ack.status;
+}
+
+void setUp()
+{
+    Host::files.clear();
+    Host::serialRx.clear();
+    Host::serialTx.clear();
+    wire.clear();
+    lineBits = 0;
+    Serial.txBufferSize = 0;
+    SerialLink::doSetup();
+    Host::serialTxRoom = uartBuffer();
+    SerialLink::txHead = SerialLink::txTail = 0;
+    SerialLink::rxLength = 0;
+    SerialLink::connected = false;
+    SerialLink::subscribed = false;
+    SerialLink::historyRemaining = 0;
+    SerialLink::rxErrors = 0;
+    SerialLink::txDrops = 0;
+    memset(&Greenhouse::config, 0, sizeof(Greenhouse::config));
+    TFT::stateCurrent = TFT::TFTStates::IDLE;
+}
+
+void tearDown() {}
+
+void test_setup_sizes_the_uart_buffers()
+{
+    TEST_ASSERT_EQUAL_UINT32(SerialLink::UART_TX_BUFFER, Serial.txBufferSize);
+}
+
+void test_config_round_trip()
+{
+    LinkClient::Client client(port);
+    Greenhouse::Config_s config = {true, 40, 100, 0};
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_OK, request(client, client.setConfig(config)));
+    TEST_ASSERT_TRUE(Radio::configModified);
+    client.getConfig();
+    LinkClient::Frame_s frame;
+    TEST_ASSERT_TRUE(exchange(client, frame));
+    Greenhouse::Config_s read;
+    TEST_ASSERT_TRUE(LinkClient::parseConfig(frame, read));
+    TEST_ASSERT_TRUE(read.test);
+    TEST_ASSERT_EQUAL_UINT8(40, read.vent);
+    TEST_ASSERT_EQUAL_UINT8(100, read.fan);
+    TEST_ASSERT_EQUAL_UINT8(0, read.mister);
+}
+
+void test_out_of_range_config_is_rejected()
+{
+    LinkClient::Client client(port);
+    Greenhouse::config = {false, 10, 20, 30};
+    const uint8_t bodies[][4] = {{2, 0, 0, 0}, {0xFF, 0, 0, 0}, {0, 101, 0, 0}, {0, 0, 255, 0}, {1, 0, 0, 200}};
+    for (const uint8_t *body : bodies)
+    {
+        uint8_t seq = client.send(SerialLink::MSG_SET_CONFIG, body, 4);
+        TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_BAD_VALUE, request(client, seq));
+    }
+    uint8_t tooLong[5] = {};
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_BAD_LENGTH, request(client, client.send(SerialLink::MSG_SET_CONFIG, tooLong, 5)));
+    // Unchanged, and every bool field still holds 0 or 1
+    TEST_ASSERT_FALSE(Greenhouse::config.test);
+    TEST_ASSERT_EQUAL_UINT8(10, Greenhouse::config.vent);
+    TEST_ASSERT_EQUAL_UINT8(20, Greenhouse::config.fan);
+    TEST_ASSERT_EQUAL_UINT8(30, Greenhouse::config.mister);
+}
+
+void test_only_data_screens_can_be_selected()
+{
+    LinkClient::Client client(port);
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_OK, request(client, client.setScreen((uint8_t)TFT::TFTStates::CONFIG)));
+    TEST_ASSERT_TRUE(TFT::stateCurrent == TFT::TFTStates::CONFIG);
+    uint32_t calibrations = Host::calibrations;
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_REJECTED, request(client, client.setScreen((uint8_t)TFT::TFTStates::TFT_CALIBRATION)));
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_REJECTED, request(client, client.setScreen(7)));
+    TEST_ASSERT_TRUE(TFT::stateCurrent == TFT::TFTStates::CONFIG);
+    TEST_ASSERT_EQUAL_UINT32(calibrations, Host::calibrations);
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_OK, request(client, client.setScreen((uint8_t)TFT::TFTStates::IDLE)));
+    TEST_ASSERT_TRUE(TFT::stateCurrent == TFT::TFTStates::IDLE);
+}
+
+void test_corrupt_frames_are_dropped()
+{
+    LinkClient::Client client(port);
+    // A ping with a wrong CRC, then a good one
+    std::vector<uint8_t> frame = {SerialLink::MSG_PING, 0, 0, 0};
+    frame = LinkClient::Client::encode(frame);
+    port.write(frame.data(), frame.size());
+    uint8_t seq = client.ping();
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_OK, request(client, seq));
+    TEST_ASSERT_EQUAL_UINT32(1, SerialLink::rxErrors);
+    // Unknown request
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_UNKNOWN, request(client, client.send(0x7F, nullptr, 0)));
+}
+
+void test_large_uart_room_is_not_truncated()
+{
+    LinkClient::Client client(port);
+    uint8_t seq = client.ping();
+    // More room than fits in 16 bits used to make no progress at all
+    Host::serialTxRoom = 1 << 16;
+    SerialLink::doTick();
+    TEST_ASSERT_GREATER_THAN(0, Host::serialTx.size());
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_OK, request(client, seq));
+}
+
+void test_live_frames_follow_the_radio()
+{
+    LinkClient::Client client(port);
+    TEST_ASSERT_EQUAL_UINT8(SerialLink::STATUS_OK, request(client, client.subscribe(true)));
+    Greenhouse::data.values[Greenhouse::TEMP2] = 2345;
+    Radio::frames++;
+    LinkClient::Frame_s frame;
+    Greenhouse::Data_s data;
+    TEST_ASSERT_TRUE(exchange(client, frame));
+    TEST_ASSERT_TRUE(LinkClient::parseLive(frame, data));
+    TEST_ASSERT_EQUAL_INT16(2345, data.values[Greenhouse::TEMP2]);
+}
+
+// Fills the history with records numbered by time
+void fillHistory(uint32_t count)
+{
+    History::doSetup();
+    Greenhouse::Data_s data = {};
+    for (uint32_t i = 0; i < count; i++)
+    {
+        data.values[0] = i;
+        History::append(data, i);
+        Host::advanceMs(History::INTERVAL);
+    }
+}
+
+struct Transfer_s
+{
+    uint32_t records;
+    uint64_t us;
+    uint64_t wireBytes;
+    double tickNs;
+};
+
+/**
+ * Downloads the whole history. Loop passes take passUs, every 50th one renderUs like a frame
+ * redraw, during which only the UART buffer keeps the line busy.
+ */
+Transfer_s download(uint32_t passUs, uint32_t renderUs)
+{
+    LinkClient::Client client(port);
+    uint64_t start = Host::nowUs;
+    uint64_t wireBefore = 0;
+    client.getHistory(0, History::size());
+    Transfer_s t = {0, 0, 0, 0};
+    LinkClient::Frame_s frame;
+    LinkClient::HistoryPage_s page;
+    uint32_t pass = 0;
+    while (t.records < History::size() && pass < 1000000)
+    {
+        auto tickStart = std::chrono::steady_clock::now();
+        SerialLink::doTick();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - tickStart).count();
+        t.tickNs += ns;
+        size_t before = wire.size();
+        elapse(++pass % 50 == 0 ? renderUs : passUs);
+        wireBefore += wire.size() - before;
+        while (client.receive(frame))
+        {
+            if (frame.type == SerialLink::MSG_LOG)
+            {
+                continue;
+            }
+            TEST_ASSERT_TRUE(LinkClient::parseHistory(frame, page));
+            TEST_ASSERT_EQUAL_UINT32(t.records, page.first);
+            for (const History::Record_s &record : page.records)
+            {
+                TEST_ASSERT_EQUAL_UINT32(t.records, record.time);
+                t.records++;
+            }
+        }
+    }
+    t.us = Host::nowUs - start;
+    t.tickNs /= pass;
+    t.wireBytes = wireBefore;
+    return t;
+}
+
+void report(const char *name, const Transfer_s &t)
+{
+    double lineBytes = (double)t.us * BAUD / 10 / 1e6;
+    char line[192];
+    snprintf(line, sizeof(line), "%s: %u records in %.0f ms, %.1f kB/s payload, line %.1f%% busy, doTick %.2f us on average",
+             name, t.records, t.us / 1000.0, t.records * sizeof(History::Record_s) / (t.us / 1e6) / 1000,
+             100.0 * t.wireBytes / lineBytes, t.tickNs / 1000);
+    TEST_MESSAGE(line);
+}
+
+void test_benchmark_history_throughput()
+{
+    fillHistory(4000);
+    // Same link, FIFO only and then the transmit buffer set by doSetup
+    Serial.txBufferSize = 0;
+    Host::serialTxRoom = uartBuffer();
+    Transfer_s fifo = download(200, 10000);
+    report("128 byte FIFO", fifo);
+    SerialLink::doSetup();
+    Host::serialTxRoom = uartBuffer();
+    Transfer_s buffered = download(200, 10000);
+    report("2 kB tx buffer", buffered);
+    TEST_ASSERT_EQUAL_UINT32(4000, buffered.records);
+    TEST_ASSERT_EQUAL_UINT32(0, SerialLink::txDrops);
+    // The buffer keeps the line going through redraws
+    TEST_ASSERT_LESS_THAN(fifo.us, buffered.us);
+    TEST_ASSERT_GREATER_THAN(85.0 * buffered.us * BAUD / 10 / 1e8, buffered.wireBytes);
+}
+
+void test_benchmark_frame_encoding()
+{
+    Greenhouse::Data_s data = {};
+    const uint32_t FRAMES = 100000;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < FRAMES; i++)
+    {
+        data.values[0] = i;
+        SerialLink::send(SerialLink::MSG_LIVE, &data, sizeof(data));
+        // Consumed right away
+        SerialLink::txTail = SerialLink::txHead;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    char line[96];
+    snprintf(line, sizeof(line), "MSG_LIVE: %.0f ns per frame, %.1f ns per byte", ns / FRAMES, ns / FRAMES / (sizeof(data) + 4));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, SerialLink::txDrops);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_setup_sizes_the_uart_buffers);
+    RUN_TEST(test_config_round_trip);
+    RUN_TEST(test_out_of_range_config_is_rejected);
+    RUN_TEST(test_only_data_screens_can_be_selected);
+    RUN_TEST(test_corrupt_frames_are_dropped);
+    RUN_TEST(test_large_uart_room_is_not_truncated);
+    RUN_TEST(test_live_frames_follow_the_radio);
+    RUN_TEST(test_benchmark_history_throughput);
+    RUN_TEST(test_benchmark_frame_encoding);
+    return UNITY_END();
+}
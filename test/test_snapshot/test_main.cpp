@@ -0,0 +1,255 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Screen snapshots (snapshot.h): codec, restored pixels, persistence and switch latency
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * The benchmark switches screens through TFT::render(), the same code the firmware runs, with the
+ * panel bus modelled by Host::pixelNs and Host::commandNs. The latency it reads is the one the
+ * on-device statistics (TFT::snapshotSwitchUs, TFT::primitiveSwitchUs) accumulate. CPU time of the
+ * decoder is measured separately on the host, the stand-in panel doesn't model it.
+ */
+#include <unity.h>
+#include <chrono>
+#include "tfthelper.h"
+
+// 40 MHz SPI, 16 bits a pixel, and the address window set up of a primitive
+const uint32_t PIXEL_NS = 400;
+const uint32_t COMMAND_NS = 2000;
+
+void setUp()
+{
+    Host::files.clear();
+    Host::pixelNs = 0;
+    Host::commandNs = 0;
+    Snapshot::clear();
+    Snapshot::persist = true;
+    memset(&Greenhouse::data, 0, sizeof(Greenhouse::data));
+    for (uint8_t c = 0; c < Greenhouse::CHANNEL_COUNT; c++)
+    {
+        Greenhouse::data.values[c] = 2000 + 137 * c;
+    }
+    TFT::tft.fillScreen(TFT_BLACK);
+    TFT::pendingCapture = false;
+    TFT::lastFrameMs = 0;
+    TFT::snapshotSwitches = 0;
+    TFT::snapshotSwitchUs = 0;
+    TFT::primitiveSwitches = 0;
+    TFT::primitiveSwitchUs = 0;
+}
+
+void tearDown()
+{
+    Host::pixelNs = 0;
+    Host::commandNs = 0;
+}
+
+// Switches screen and draws it, returns the simulated time it took
+uint32_t switchTo(TFT::TFTStates screen)
+{
+    TFT::setState(screen);
+    uint32_t start = micros();
+    TFT::render();
+    return micros() - start;
+}
+
+// Lets the display go idle, which captures a pending snapshot
+void settle()
+{
+    Host::advanceMs(TFT::FRAME_MS);
+    TFT::doTick();
+    TEST_ASSERT_FALSE(TFT::pendingCapture);
+}
+
+uint32_t currentKey()
+{
+    TFT::Screen_s screen = TFT::currentScreen();
+    return Snapshot::key(screen.widgets, screen.count, screen.background);
+}
+
+void test_rle_round_trip()
+{
+    const uint16_t width = Layout::SCREEN_WIDTH;
+    uint16_t row[width];
+    uint16_t decoded[width];
+    uint8_t packed[width * 2 + (width + 127) / 128];
+    randomSeed(7);
+    for (uint16_t pass = 0; pass < 500; pass++)
+    {
+        // Runs of random length, the first passes all literals and all one run
+        uint16_t i = 0;
+        while (i < width)
+        {
+            uint16_t run = pass == 0 ? 1 : (pass == 1 ? width : random(1, 300));
+            uint16_t pixel = random(4) == 0 ? random(65536) : random(3);
+            for (uint16_t j = 0; j < run && i < width; j++, i++)
+            {
+                row[i] = pass == 0 ? i : pixel;
+            }
+        }
+        uint32_t length = Snapshot::encodeRow(row, width, packed, sizeof(packed));
+        TEST_ASSERT_GREATER_THAN(0, length);
+        const uint8_t *end = Snapshot::decodeRow(packed, decoded, width);
+        TEST_ASSERT_EQUAL_UINT32(length, end - packed);
+        TEST_ASSERT_EQUAL_MEMORY(row, decoded, sizeof(row));
+    }
+    // A row of literals doesn't fit in less than its worst case
+    for (uint16_t i = 0; i < width; i++)
+    {
+        row[i] = i;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, Snapshot::encodeRow(row, width, packed, width * 2));
+}
+
+void test_restore_matches_primitives()
+{
+    const TFT::TFTStates screens[] = {TFT::TFTStates::IDLE, TFT::TFTStates::CONFIG};
+    for (TFT::TFTStates screen : screens)
+    {
+        switchTo(screen);
+        std::vector<uint16_t> primitives = TFT::tft.pixels;
+        settle();
+        TEST_ASSERT_TRUE(Snapshot::contains(currentKey()));
+        TFT::tft.fillScreen(TFT_BLACK);
+        switchTo(screen);
+        TEST_ASSERT_TRUE(primitives == TFT::tft.pixels);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, TFT::primitiveSwitches);
+    TEST_ASSERT_EQUAL_UINT32(2, TFT::snapshotSwitches);
+}
+
+void test_snapshots_survive_restart()
+{
+    switchTo(TFT::TFTStates::IDLE);
+    std::vector<uint16_t> primitives = TFT::tft.pixels;
+    settle();
+    uint32_t key = currentKey();
+    char path[16];
+    Snapshot::filePath(key, path, sizeof(path));
+    TEST_ASSERT_TRUE(LittleFS.exists(path));
+
+    // Restart: RAM is gone, the first frame comes from the file
+    Snapshot::clear();
+    TFT::tft.fillScreen(TFT_BLACK);
+    Snapshot::loads = 0;
+    switchTo(TFT::TFTStates::IDLE);
+    TEST_ASSERT_EQUAL_UINT32(1, Snapshot::loads);
+    TEST_ASSERT_EQUAL_UINT32(1, TFT::snapshotSwitches);
+    TEST_ASSERT_TRUE(primitives == TFT::tft.pixels);
+
+    // Corrupt data fails the CRC and the file is dropped
+    std::vector<uint8_t> saved = *Host::files[path];
+    (*Host::files[path])[sizeof(Snapshot::FileHeader_s) + 10] ^= 1;
+    Snapshot::clear();
+    TEST_ASSERT_FALSE(Snapshot::restore(&TFT::tft, key));
+    TEST_ASSERT_FALSE(LittleFS.exists(path));
+
+    // A firmware with another Layout::VERSION doesn't use the file
+    Snapshot::FileHeader_s header;
+    memcpy(&header, saved.data(), sizeof(header));
+    header.version++;
+    memcpy(saved.data(), &header, sizeof(header));
+    Host::files[path] = std::make_shared<std::vector<uint8_t>>(saved);
+    TEST_ASSERT_FALSE(Snapshot::restore(&TFT::tft, key));
+    TEST_ASSERT_FALSE(LittleFS.exists(path));
+}
+
+void test_nothing_written_without_filesystem()
+{
+    Snapshot::persist = false;
+    switchTo(TFT::TFTStates::IDLE);
+    settle();
+    TEST_ASSERT_EQUAL_UINT8(1, Snapshot::count);
+    TEST_ASSERT_TRUE(Host::files.empty());
+}
+
+void test_key_follows_contents()
+{
+    const uint8_t n = sizeof(Layout::IDLE) / sizeof(Layout::IDLE[0]);
+    uint32_t original = Snapshot::key(Layout::IDLE, n, Layout::IDLE_BACKGROUND);
+    // Same tooltips and icons at other addresses, as in another build
+    ButtonWidget::Spec copy[n];
+    std::vector<std::string> tooltips(n);
+    std::vector<std::vector<uint8_t>> icons(n);
+    for (uint8_t i = 0; i < n; i++)
+    {
+        copy[i] = Layout::IDLE[i];
+        if (copy[i].tooltip != nullptr)
+        {
+            tooltips[i] = copy[i].tooltip;
+            copy[i].tooltip = tooltips[i].c_str();
+        }
+        if (copy[i].icon != nullptr)
+        {
+            icons[i].assign(copy[i].icon, copy[i].icon + (copy[i].sizex + 7) / 8 * copy[i].sizey);
+            copy[i].icon = icons[i].data();
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(original, Snapshot::key(copy, n, Layout::IDLE_BACKGROUND));
+    // One letter of a tooltip, one pixel of an icon
+    TEST_ASSERT_NOT_NULL(copy[1].tooltip);
+    tooltips[1][0] ^= 1;
+    TEST_ASSERT_NOT_EQUAL(original, Snapshot::key(copy, n, Layout::IDLE_BACKGROUND));
+    tooltips[1][0] ^= 1;
+    TEST_ASSERT_NOT_NULL(copy[0].icon);
+    icons[0].back() ^= 1;
+    TEST_ASSERT_NOT_EQUAL(original, Snapshot::key(copy, n, Layout::IDLE_BACKGROUND));
+}
+
+void test_benchmark_switch_latency()
+{
+    Host::pixelNs = PIXEL_NS;
+    Host::commandNs = COMMAND_NS;
+    const TFT::TFTStates screens[] = {TFT::TFTStates::IDLE, TFT::TFTStates::CONFIG};
+    const char *names[] = {"IDLE", "CONFIG"};
+    for (uint8_t s = 0; s < 2; s++)
+    {
+        TFT::primitiveSwitchUs = 0;
+        TFT::snapshotSwitchUs = 0;
+        uint64_t pixels = TFT::tft.pixelsSent;
+        uint32_t primitiveUs = switchTo(screens[s]);
+        uint64_t primitivePixels = TFT::tft.pixelsSent - pixels;
+        settle();
+        pixels = TFT::tft.pixelsSent;
+        uint32_t snapshotUs = switchTo(screens[s]);
+        uint64_t snapshotPixels = TFT::tft.pixelsSent - pixels;
+        // The on-device statistics time the same paths
+        TEST_ASSERT_UINT32_WITHIN(1, primitiveUs, TFT::primitiveSwitchUs);
+        TEST_ASSERT_UINT32_WITHIN(1, snapshotUs, TFT::snapshotSwitchUs);
+
+        // Decoder CPU time on the host, no bus
+        Host::pixelNs = 0;
+        Host::commandNs = 0;
+        const uint32_t rounds = 50;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < rounds; i++)
+        {
+            Snapshot::restore(&TFT::tft, currentKey());
+        }
+        double decodeUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+        Host::pixelNs = PIXEL_NS;
+        Host::commandNs = COMMAND_NS;
+
+        char line[200];
+        snprintf(line, sizeof(line), "%s: primitives %u us (%llu px), snapshot %u us (%llu px, %u bytes), host decode %.0f us",
+                 names[s], primitiveUs, (unsigned long long)primitivePixels, snapshotUs, (unsigned long long)snapshotPixels,
+                 Snapshot::find(currentKey())->size, decodeUs);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_LESS_THAN(primitiveUs, snapshotUs);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rle_round_trip);
+    RUN_TEST(test_restore_matches_primitives);
+    RUN_TEST(test_snapshots_survive_restart);
+    RUN_TEST(test_nothing_written_without_filesystem);
+    RUN_TEST(test_key_follows_contents);
+    RUN_TEST(test_benchmark_switch_latency);
+    return UNITY_END();
+}
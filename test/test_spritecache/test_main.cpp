@@ -0,0 +1,152 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Widget sprite cache (spritecache.h): LRU order, RAM budget, per frame protection and the reported saving
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <unity.h>
+#include "tfthelper.h"
+
+// 100 x 92 pixels, about the size of an IDLE widget with its tooltip
+const int16_t W = 100;
+const int16_t H = 92;
+const uint32_t SPRITE_BYTES = W * H * 2;
+
+void setUp()
+{
+    SpriteCache::clear();
+    SpriteCache::setBudget(64 * 1024);
+    SpriteCache::report();
+    Host::pixelNs = 0;
+    Host::commandNs = 0;
+}
+
+void tearDown()
+{
+    Host::pixelNs = 0;
+}
+
+bool cached(uint32_t key)
+{
+    for (uint8_t i = 0; i < SpriteCache::count; i++)
+    {
+        if (SpriteCache::entries[i].key == key)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void test_least_recently_used_is_evicted()
+{
+    SpriteCache::beginFrame();
+    TEST_ASSERT_NOT_NULL(SpriteCache::create(&TFT::tft, 1, 0, 0, W, H));
+    TEST_ASSERT_NOT_NULL(SpriteCache::create(&TFT::tft, 2, 0, 0, W, H));
+    TEST_ASSERT_NOT_NULL(SpriteCache::create(&TFT::tft, 3, 0, 0, W, H));
+    TEST_ASSERT_EQUAL_UINT32(3 * SPRITE_BYTES, SpriteCache::used);
+    // Next frame uses 1 and 3, then needs room for 4: 2 goes
+    SpriteCache::beginFrame();
+    TEST_ASSERT_NOT_NULL(SpriteCache::get(1));
+    TEST_ASSERT_NOT_NULL(SpriteCache::get(3));
+    TEST_ASSERT_NOT_NULL(SpriteCache::create(&TFT::tft, 4, 0, 0, W, H));
+    TEST_ASSERT_FALSE(cached(2));
+    TEST_ASSERT_TRUE(cached(1) && cached(3) && cached(4));
+    TEST_ASSERT_EQUAL_UINT32(1, SpriteCache::evictions);
+    // And then 1, the oldest of the rest
+    SpriteCache::beginFrame();
+    TEST_ASSERT_NOT_NULL(SpriteCache::create(&TFT::tft, 5, 0, 0, W, H));
+    TEST_ASSERT_FALSE(cached(1));
+    TEST_ASSERT_NULL(SpriteCache::get(2));
+    TEST_ASSERT_LESS_OR_EQUAL(SpriteCache::budget, SpriteCache::used);
+}
+
+void test_frame_does_not_evict_its_own_sprites()
+{
+    // Seven widgets of a screen, only three fit in 64 KB
+    SpriteCache::beginFrame();
+    uint8_t created = 0;
+    for (uint32_t key = 1; key <= 7; key++)
+    {
+        created += SpriteCache::create(&TFT::tft, key, 0, 0, W, H) != nullptr;
+    }
+    TEST_ASSERT_EQUAL_UINT8(3, created);
+    TEST_ASSERT_EQUAL_UINT32(0, SpriteCache::evictions);
+    // Every later frame hits the same three and draws the others directly, without churn
+    for (uint8_t frame = 0; frame < 5; frame++)
+    {
+        SpriteCache::beginFrame();
+        for (uint32_t key = 1; key <= 7; key++)
+        {
+            if (SpriteCache::get(key) == nullptr)
+            {
+                TEST_ASSERT_NULL(SpriteCache::create(&TFT::tft, key, 0, 0, W, H));
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, SpriteCache::evictions);
+    TEST_ASSERT_EQUAL_UINT32(15, SpriteCache::hits);
+    TEST_ASSERT_TRUE(cached(1) && cached(2) && cached(3));
+    TEST_ASSERT_LESS_OR_EQUAL(SpriteCache::budget, SpriteCache::used);
+}
+
+void test_idle_screen_within_budget()
+{
+    for (uint8_t frame = 0; frame < 3; frame++)
+    {
+        SpriteCache::beginFrame();
+        for (const ButtonWidget::Spec &spec : Layout::IDLE)
+        {
+            TFT::drawWidget(spec, Layout::IDLE_BACKGROUND);
+        }
+        TEST_ASSERT_LESS_OR_EQUAL(SpriteCache::budget, SpriteCache::used);
+    }
+    char line[96];
+    snprintf(line, sizeof(line), "IDLE: %u sprites, %u bytes, %u hits, %u misses, %u evictions",
+             SpriteCache::count, SpriteCache::used, SpriteCache::hits, SpriteCache::misses, SpriteCache::evictions);
+    TEST_MESSAGE(line);
+    // The screen doesn't fit: what does is kept and hit in every later frame, the rest drawn directly
+    TEST_ASSERT_LESS_THAN(sizeof(Layout::IDLE) / sizeof(Layout::IDLE[0]), SpriteCache::count);
+    TEST_ASSERT_EQUAL_UINT32(2 * SpriteCache::count, SpriteCache::hits);
+    TEST_ASSERT_EQUAL_UINT32(0, SpriteCache::evictions);
+}
+
+void test_saving_is_render_minus_push_per_frame()
+{
+    // 1 us a pixel on the bus, so a push of W x H costs 9200 us
+    Host::pixelNs = 1000;
+    SpriteCache::beginFrame();
+    SpriteCache::Entry_s *entry = SpriteCache::create(&TFT::tft, 1, 0, 0, W, H);
+    entry->renderUs = 12000;
+    // The push that completes the miss saves nothing
+    SpriteCache::push(entry);
+    TEST_ASSERT_EQUAL_INT32(0, (int32_t)SpriteCache::savedUs);
+    for (uint8_t frame = 0; frame < 4; frame++)
+    {
+        SpriteCache::beginFrame();
+        SpriteCache::push(SpriteCache::get(1));
+    }
+    TEST_ASSERT_EQUAL_INT32(4 * (12000 - W * H), (int32_t)SpriteCache::savedUs);
+    // 5 frames, the first one the miss
+    TEST_ASSERT_EQUAL_INT32(4 * (12000 - W * H) / 5, SpriteCache::savedPerFrameUs());
+    // A sprite cheaper to render than to push shows as a loss
+    entry->renderUs = 1000;
+    SpriteCache::push(SpriteCache::get(1));
+    TEST_ASSERT_LESS_THAN(4 * (12000 - W * H), (int32_t)SpriteCache::savedUs);
+    SpriteCache::report();
+    TEST_ASSERT_EQUAL_INT32(0, SpriteCache::savedPerFrameUs());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_least_recently_used_is_evicted);
+    RUN_TEST(test_frame_does_not_evict_its_own_sprites);
+    RUN_TEST(test_idle_screen_within_budget);
+    RUN_TEST(test_saving_is_render_minus_push_per_frame);
+    return UNITY_END();
+}
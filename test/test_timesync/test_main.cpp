@@ -0,0 +1,126 @@
+/**
+ * @file test_main.cpp
+ * @author Riccardo Iacob
+ * @brief Slave clock model (timesync.h): timestamp error against the truth of a simulated slave
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * A slave whose crystal runs 40 ppm fast answers a beacon every 5 s for 3 hours. Each way takes
+ * 2 to 11 ms, one reply in 20 is held up 150 ms more, readings are taken up to 500 ms before the
+ * reply. Every reading is converted back to the master clock and compared with the time it was
+ * really taken, with the clock offset from seconds up to days and across the 32 bit wrap.
+ */
+#include <unity.h>
+#include "timesync.h"
+
+struct Result_s
+{
+    uint32_t worstMs;
+    uint32_t violations;
+    uint32_t samples;
+    float driftPpm;
+};
+
+const double PPM = 40;
+
+Result_s simulate(double offsetMs)
+{
+    memset(TimeSync::slaves, 0, sizeof(TimeSync::slaves));
+    randomSeed(11);
+    auto slaveClock = [&](double masterMs) {
+        return (uint32_t)(uint64_t)llround(masterMs + offsetMs + masterMs * PPM / 1e6);
+    };
+    Result_s r = {0, 0, 0, 0};
+    for (uint32_t t1 = 1000; t1 < 3 * 3600000; t1 += 5000)
+    {
+        uint32_t up = random(2, 12);
+        uint32_t down = random(2, 12) + (random(20) == 0 ? 150 : 0);
+        double sampled = t1 + up - random(0, 501);
+        Greenhouse::Stamp_s stamp = {0, t1, slaveClock(t1 + up), slaveClock(t1 + up + 3), slaveClock(sampled)};
+        TimeSync::exchange(stamp, t1 + up + 3 + down);
+        uint16_t errorMs;
+        uint32_t masterMs = TimeSync::toMaster(0, stamp.sampled, errorMs);
+        // Once the first exchanges settled the round trip
+        if (t1 < 60000)
+        {
+            continue;
+        }
+        uint32_t error = (uint32_t)llabs((int64_t)masterMs - llround(sampled));
+        r.worstMs = max(r.worstMs, error);
+        r.violations += error > errorMs;
+        r.samples++;
+    }
+    r.driftPpm = TimeSync::slaves[0].driftPpm;
+    return r;
+}
+
+void check(const char *name, double offsetMs)
+{
+    Result_s r = simulate(offsetMs);
+    char line[128];
+    snprintf(line, sizeof(line), "%s: worst %u ms, %u/%u outside the bound, drift %.2f ppm",
+             name, r.worstMs, r.violations, r.samples, r.driftPpm);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_OR_EQUAL(5, r.worstMs);
+    TEST_ASSERT_EQUAL_UINT32(0, r.violations);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, PPM, r.driftPpm);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_offset_of_seconds()
+{
+    check("5 s offset", 5000);
+}
+
+void test_offset_of_a_day()
+{
+    check("1 day offset", 86400000);
+}
+
+void test_offset_of_weeks()
+{
+    check("1e9 ms offset", 1e9);
+}
+
+void test_bound_covers_master_drift_from_rtc()
+{
+    simulate(5000);
+    uint32_t slaveMs = TimeSync::slaves[0].baseMs + 3 * 3600000;
+    uint16_t unanchored;
+    uint32_t masterMs = TimeSync::toMaster(0, slaveMs, unanchored);
+    RTC::present = true;
+    // Anchored 3 hours ago and not checked since: 10800 s at 52 ppm
+    RTC::syncMs = masterMs - 3 * 3600000;
+    RTC::lastResyncMs = RTC::syncMs;
+    uint16_t errorMs;
+    TEST_ASSERT_EQUAL_UINT32(masterMs, TimeSync::toMaster(0, slaveMs, errorMs));
+    TEST_ASSERT_EQUAL_UINT16(unanchored + 561, errorMs);
+    // Anchored 10 hours ago, checked within a second half an hour ago
+    RTC::syncMs = masterMs - 10 * 3600000;
+    RTC::lastResyncMs = masterMs - 1800000;
+    TimeSync::toMaster(0, slaveMs, errorMs);
+    TEST_ASSERT_EQUAL_UINT16(unanchored + RTC::MAX_ERROR_MS + 93, errorMs);
+    RTC::present = false;
+}
+
+void test_slave_clock_wraps()
+{
+    // The slave clock wraps an hour into the run
+    check("wrapping slave clock", 4294967296.0 - 3600000);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_offset_of_seconds);
+    RUN_TEST(test_offset_of_a_day);
+    RUN_TEST(test_offset_of_weeks);
+    RUN_TEST(test_slave_clock_wraps);
+    RUN_TEST(test_bound_covers_master_drift_from_rtc);
+    return UNITY_END();
+}